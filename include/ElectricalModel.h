@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Consumer load and source impedance of one generator
+ */
+struct ElectricalSpec {
+    double power_factor;          // Of the consumer load, lagging
+    double phase_a_load;          // Relative share of the load on each phase
+    double phase_b_load;
+    double phase_c_load;
+    double source_resistance;     // Per unit of the rated impedance
+    double source_reactance;      // Per unit, negative sequence
+};
+
+// An ElectricalSpec worked out against the unit's ratings
+struct ElectricalCoefficients {
+    double share[3];          // Fraction of the active power on each phase, summing to 1
+    double reactive_ratio;    // kvar per kW, tan(acos(power_factor))
+    double resistance;        // Ohms
+    double reactance;
+    double rated_power;       // W at 100% load
+
+    static ElectricalCoefficients from(const ElectricalSpec& spec, double rated_power, double rated_voltage);
+};
+
+// Terminal quantities of one generator
+struct ElectricalReadings {
+    double line_voltage[3];   // V, AB, BC and CA
+    double current[3];        // A, phases A, B and C
+    double active_power;      // kW
+    double reactive_power;    // kvar, positive lagging
+    double apparent_power;    // kVA
+    double power_factor;      // Active over apparent, 1 with no load
+};
+
+/**
+ * @brief Three-phase terminal voltages, currents and power of many
+ * generators at once
+ *
+ * Each phase of the consumer load is a constant admittance drawing its
+ * share of the unit's active power at the load's power factor, star
+ * connected with an isolated neutral as on a ship's three-wire network.
+ * The machine is a balanced EMF behind its source impedance, and the
+ * network is solved with complex phasors:
+ *
+ *   Y'  = Y / (1 + Z * Y)                   load behind the source impedance
+ *   Vn  = sum(Y' * E) / sum(Y')             neutral shift of the load
+ *   I   = Y' * (E - Vn),  U = E - Z * I     line currents, terminal voltages
+ *
+ * The result is scaled so the positive-sequence line voltage is the
+ * generator's regulated voltage. A balanced load then draws exactly the
+ * rated power times the load fraction; an unbalanced one also produces
+ * negative-sequence voltage and unequal line currents.
+ *
+ * Coefficients and results are stored per column across generators and
+ * solve() is one branch-free pass with the complex arithmetic written out
+ * on real and imaginary parts, which the compiler vectorizes. A single
+ * generator goes through the same arithmetic with one-element columns.
+ */
+class ElectricalModel {
+public:
+    // Returns the generator's index
+    size_t add(const ElectricalCoefficients& coefficients);
+    void set(size_t unit, const ElectricalCoefficients& coefficients);
+    size_t size() const { return reactive_ratio_.size(); }
+
+    // Solves every generator for its line voltage (V) and load (%)
+    void solve(const double* voltage, const double* load);
+    ElectricalReadings readings(size_t unit) const;
+
+    // One generator, with the same arithmetic
+    static ElectricalReadings solve(const ElectricalCoefficients& coefficients, double voltage, double load);
+
+private:
+    struct Columns {
+        const double* share[3];
+        const double* reactive_ratio;
+        const double* resistance;
+        const double* reactance;
+        const double* rated_power;
+    };
+
+    struct Results {
+        double* line_voltage[3];
+        double* current[3];
+        double* active_power;
+        double* reactive_power;
+        double* apparent_power;
+        double* power_factor;
+    };
+
+    static void solve(const Columns& columns, size_t count, const double* voltage, const double* load,
+                      const Results& results);
+
+    std::vector<double> share_[3];
+    std::vector<double> reactive_ratio_;
+    std::vector<double> resistance_;
+    std::vector<double> reactance_;
+    std::vector<double> rated_power_;
+
+    std::vector<double> line_voltage_[3];
+    std::vector<double> current_[3];
+    std::vector<double> active_power_;
+    std::vector<double> reactive_power_;
+    std::vector<double> apparent_power_;
+    std::vector<double> power_factor_;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Engine families, as compile-time policies for BasicGenerator and
+ * BasicSensors
+ *
+ * Each family supplies its ramp rates, sequence times, load acceptance,
+ * governor response, fuel curve, heat rejection and sensor
+ * characteristics as static constants.
+ * They are the defaults of the family's GeneratorSpec, which a spec file
+ * can override per unit. Fleet groups units by family, so stepping one
+ * family never dispatches through the others.
+ */
+enum class EngineType {
+    DIESEL,
+    GAS,
+    DUAL_FUEL
+};
+
+static constexpr size_t ENGINE_TYPE_COUNT = 3;
+
+const char* engine_type_name(EngineType type);
+bool parse_engine_type(const std::string& name, EngineType& type);
+
+// Medium-speed diesel: the original engine of the simulator
+struct DieselEngine {
+    static constexpr EngineType TYPE = EngineType::DIESEL;
+
+    // Sequences
+    static constexpr double RPM_ACCELERATION_RATE = 100.0;  // RPM per second
+    static constexpr double VOLTAGE_RAMP_RATE = 50.0;       // Volts per second
+    static constexpr double FREQUENCY_RAMP_RATE = 2.0;      // Hz per second
+    static constexpr double STARTUP_TIME = 30.0;            // seconds
+    static constexpr double SHUTDOWN_TIME = 15.0;           // seconds
+
+    // Governor
+    static constexpr double INERTIA = 1.5;                  // H, seconds
+    static constexpr double ACTUATOR_TIME = 0.3;            // Fuel rack and combustion, seconds
+
+    // Sensors
+    static constexpr double OIL_PRESSURE_RAMP = 2.0;          // Bar per second
+    static constexpr double OIL_PRESSURE_BASE = 3.0;          // Bar at idle
+    static constexpr double OIL_PRESSURE_LOAD_FACTOR = 0.02;  // Bar per % load
+    static constexpr double VIBRATION_RAMP = 1.0;             // mm/s per second
+    static constexpr double VIBRATION_BASE = 2.0;             // mm/s at idle
+    static constexpr double VIBRATION_LOAD_FACTOR = 0.05;     // mm/s per % load
+
+    // Load acceptance, % per second below and above HIGH_LOAD %
+    static constexpr double LOAD_RAMP_RATE = 10.0;
+    static constexpr double HIGH_LOAD_RAMP_RATE = 10.0;
+    static constexpr double HIGH_LOAD = 100.0;
+
+    // Fuel: specific consumption in g/kWh against % load, from the day tank
+    static constexpr double TANK_VOLUME = 5.0;                // m³
+    static constexpr double FUEL_DENSITY = 850.0;             // kg/m³, marine gas oil
+    static constexpr size_t SFOC_POINTS = 6;
+    static constexpr double SFOC_LOAD[SFOC_POINTS] = {10.0, 25.0, 50.0, 75.0, 85.0, 100.0};
+    static constexpr double SFOC[SFOC_POINTS] = {260.0, 215.0, 200.0, 190.0, 188.0, 192.0};
+
+    // Heat rejected at rated load, kW
+    static constexpr double JACKET_HEAT = 350.0;
+    static constexpr double OIL_HEAT = 150.0;
+    static constexpr double EXHAUST_HEAT = 650.0;             // 350 Celsius exhaust at rated load
+};
+
+// Lean-burn gas engine: purged and pre-lubricated before it fires, slow
+// throttle response, and load taken in small steps near full load where
+// the knock margin is thin
+struct GasEngine {
+    static constexpr EngineType TYPE = EngineType::GAS;
+
+    static constexpr double RPM_ACCELERATION_RATE = 60.0;
+    static constexpr double VOLTAGE_RAMP_RATE = 50.0;
+    static constexpr double FREQUENCY_RAMP_RATE = 1.0;
+    static constexpr double STARTUP_TIME = 60.0;
+    static constexpr double SHUTDOWN_TIME = 20.0;
+
+    static constexpr double INERTIA = 1.5;
+    static constexpr double ACTUATOR_TIME = 0.8;            // Throttle and mixture transport
+
+    static constexpr double OIL_PRESSURE_RAMP = 2.0;
+    static constexpr double OIL_PRESSURE_BASE = 4.0;
+    static constexpr double OIL_PRESSURE_LOAD_FACTOR = 0.015;
+    static constexpr double VIBRATION_RAMP = 1.0;
+    static constexpr double VIBRATION_BASE = 1.5;
+    static constexpr double VIBRATION_LOAD_FACTOR = 0.04;
+
+    static constexpr double LOAD_RAMP_RATE = 3.0;
+    static constexpr double HIGH_LOAD_RAMP_RATE = 1.5;
+    static constexpr double HIGH_LOAD = 50.0;
+
+    static constexpr double TANK_VOLUME = 10.0;
+    static constexpr double FUEL_DENSITY = 450.0;             // LNG
+    static constexpr size_t SFOC_POINTS = 6;
+    static constexpr double SFOC_LOAD[SFOC_POINTS] = {10.0, 25.0, 50.0, 75.0, 85.0, 100.0};
+    static constexpr double SFOC[SFOC_POINTS] = {260.0, 195.0, 162.0, 152.0, 150.0, 151.0};
+
+    static constexpr double JACKET_HEAT = 380.0;
+    static constexpr double OIL_HEAT = 120.0;
+    static constexpr double EXHAUST_HEAT = 700.0;
+};
+
+// Dual-fuel engine: diesel-like at low load, where it runs on liquid fuel,
+// and gas-like above the load where it switches over to gas
+struct DualFuelEngine {
+    static constexpr EngineType TYPE = EngineType::DUAL_FUEL;
+
+    static constexpr double RPM_ACCELERATION_RATE = 80.0;
+    static constexpr double VOLTAGE_RAMP_RATE = 50.0;
+    static constexpr double FREQUENCY_RAMP_RATE = 1.5;
+    static constexpr double STARTUP_TIME = 45.0;
+    static constexpr double SHUTDOWN_TIME = 15.0;
+
+    static constexpr double INERTIA = 1.5;
+    static constexpr double ACTUATOR_TIME = 0.5;
+
+    static constexpr double OIL_PRESSURE_RAMP = 2.0;
+    static constexpr double OIL_PRESSURE_BASE = 3.5;
+    static constexpr double OIL_PRESSURE_LOAD_FACTOR = 0.02;
+    static constexpr double VIBRATION_RAMP = 1.0;
+    static constexpr double VIBRATION_BASE = 2.0;
+    static constexpr double VIBRATION_LOAD_FACTOR = 0.05;
+
+    static constexpr double LOAD_RAMP_RATE = 10.0;
+    static constexpr double HIGH_LOAD_RAMP_RATE = 5.0;
+    static constexpr double HIGH_LOAD = 30.0;               // Switch-over to gas
+
+    // Liquid fuel up to HIGH_LOAD, gas with a pilot injection above it;
+    // both drawn from the LNG-equivalent tank
+    static constexpr double TANK_VOLUME = 10.0;
+    static constexpr double FUEL_DENSITY = 450.0;
+    static constexpr size_t SFOC_POINTS = 7;
+    static constexpr double SFOC_LOAD[SFOC_POINTS] = {10.0, 30.0, 35.0, 50.0, 75.0, 85.0, 100.0};
+    static constexpr double SFOC[SFOC_POINTS] = {265.0, 208.0, 172.0, 165.0, 155.0, 153.0, 155.0};
+
+    static constexpr double JACKET_HEAT = 360.0;
+    static constexpr double OIL_HEAT = 140.0;
+    static constexpr double EXHAUST_HEAT = 680.0;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "EngineModels.h"
+#include "Generator.h"
+#include "GeneratorSpec.h"
+
+/**
+ * @brief Generators of mixed engine families, grouped by family
+ *
+ * Units of one family are stored together in a plain vector of
+ * BasicGenerator<Model>, so update() is one virtual call per family and
+ * a direct, inlinable loop over its units; the family is only looked up
+ * through the type-erased group for per-unit commands and queries.
+ *
+ * A family's update works out for all its units in one pass what each
+ * would otherwise work out on its own: the SFOC and thermal network
+ * state of a due slow step (see MultiRate.h), the electrical readings at
+ * the end of the step and the spectra of vibration frames due. It hands
+ * them in through update() and the setters, after setting every unit's
+ * load disturbance; a unit stepped on its own has none.
+ *
+ * Units are numbered in the order they were added and never removed.
+ * Each carries its own GeneratorSpec, so units of one family may be
+ * rated differently, and its unit number picks the random stream of its
+ * load disturbance.
+ */
+class Fleet {
+public:
+    using State = GeneratorTypes::State;
+    using AlarmType = GeneratorTypes::AlarmType;
+    using GeneratorStatus = GeneratorTypes::GeneratorStatus;
+
+    Fleet();
+    ~Fleet();
+    Fleet(const Fleet&) = delete;
+    Fleet& operator=(const Fleet&) = delete;
+
+    // Returns the new unit's number; the spec's engine picks the family
+    size_t add(EngineType type) { return add(GeneratorSpec::defaults(type)); }
+    size_t add(const GeneratorSpec& spec);
+    size_t size() const { return units_.size(); }
+    EngineType engine(size_t unit) const { return units_[unit].type; }
+
+    // Batched by family
+    void update(double delta_time);
+    double time_to_next_event() const;   // Earliest of all units
+
+    // Per unit, as on Generator
+    bool start(size_t unit) { return group(unit).start(index(unit)); }
+    bool stop(size_t unit) { return group(unit).stop(index(unit)); }
+    bool emergency_stop(size_t unit) { return group(unit).emergency_stop(index(unit)); }
+    bool set_load(size_t unit, double percentage) { return group(unit).set_load(index(unit), percentage); }
+    bool follow_share(size_t unit, double percentage) { return group(unit).follow_share(index(unit), percentage); }
+    void set_parameters(size_t unit, double max_rpm, double max_voltage, double max_frequency) {
+        group(unit).set_parameters(index(unit), max_rpm, max_voltage, max_frequency);
+    }
+    void set_spec(size_t unit, const GeneratorSpec& spec) { group(unit).set_spec(index(unit), spec); }
+    const GeneratorSpec& spec(size_t unit) const { return group(unit).spec(index(unit)); }
+    void acknowledge_alarm(size_t unit, AlarmType type) { group(unit).acknowledge_alarm(index(unit), type); }
+    void reset_alarms(size_t unit) { group(unit).reset_alarms(index(unit)); }
+
+    GeneratorStatus get_status(size_t unit) const { return group(unit).get_status(index(unit)); }
+    State get_state(size_t unit) const { return group(unit).get_state(index(unit)); }
+    double get_target_load(size_t unit) const { return group(unit).get_target_load(index(unit)); }
+    double get_ramp_load(size_t unit) const { return group(unit).get_ramp_load(index(unit)); }
+    const VibrationSpectrum& vibration_spectrum(size_t unit) const {
+        return group(unit).vibration_spectrum(index(unit));
+    }
+
+    std::string save_state(size_t unit) const { return group(unit).save_state(index(unit)); }
+    bool restore_state(size_t unit, const std::string& state) { return group(unit).restore_state(index(unit), state); }
+
+private:
+    // One per engine family in use; the only virtual interface
+    class Group {
+    public:
+        virtual ~Group() = default;
+        virtual size_t add(const GeneratorSpec& spec, size_t unit) = 0;
+        virtual void update(double delta_time) = 0;
+        virtual double time_to_next_event() const = 0;
+        virtual bool start(size_t index) = 0;
+        virtual bool stop(size_t index) = 0;
+        virtual bool emergency_stop(size_t index) = 0;
+        virtual bool set_load(size_t index, double percentage) = 0;
+        virtual bool follow_share(size_t index, double percentage) = 0;
+        virtual void set_parameters(size_t index, double max_rpm, double max_voltage, double max_frequency) = 0;
+        virtual void set_spec(size_t index, const GeneratorSpec& spec) = 0;
+        virtual const GeneratorSpec& spec(size_t index) const = 0;
+        virtual void acknowledge_alarm(size_t index, AlarmType type) = 0;
+        virtual void reset_alarms(size_t index) = 0;
+        virtual GeneratorStatus get_status(size_t index) const = 0;
+        virtual State get_state(size_t index) const = 0;
+        virtual double get_target_load(size_t index) const = 0;
+        virtual double get_ramp_load(size_t index) const = 0;
+        virtual const VibrationSpectrum& vibration_spectrum(size_t index) const = 0;
+        virtual std::string save_state(size_t index) const = 0;
+        virtual bool restore_state(size_t index, const std::string& state) = 0;
+    };
+
+    template <typename Model>
+    class ModelGroup;
+
+    struct Unit {
+        EngineType type;
+        size_t index;    // Within its group
+    };
+
+    std::unique_ptr<Group> groups_[ENGINE_TYPE_COUNT];
+    std::vector<Unit> units_;
+
+    Group& group(size_t unit) { return *groups_[static_cast<size_t>(units_[unit].type)]; }
+    const Group& group(size_t unit) const { return *groups_[static_cast<size_t>(units_[unit].type)]; }
+    size_t index(size_t unit) const { return units_[unit].index; }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Specific fuel oil consumption against load, g/kWh
+ *
+ * Piecewise linear between the points, which are in ascending load, and
+ * flat beyond the first and last. Written as a sum of clamped segments,
+ *
+ *   sfoc(x) = sfoc[0] + sum_k clamp((x - load[k]) / (load[k+1] - load[k]), 0, 1) * (sfoc[k+1] - sfoc[k])
+ *
+ * so SfocTable can evaluate any number of curves without a search or a
+ * branch.
+ */
+struct SfocCurve {
+    static constexpr size_t MAX_POINTS = 8;
+
+    size_t points;
+    double load[MAX_POINTS];   // %
+    double sfoc[MAX_POINTS];   // g/kWh
+
+    double at(double load_percentage) const {
+        double value = sfoc[0];
+        for (size_t k = 0; k + 1 < points; ++k) {
+            double t = (load_percentage - load[k]) * (1.0 / (load[k + 1] - load[k]));
+            value += std::min(std::max(t, 0.0), 1.0) * (sfoc[k + 1] - sfoc[k]);
+        }
+        return value;
+    }
+};
+
+/**
+ * @brief SFOC curves of many units, evaluated together
+ *
+ * Each segment is stored across units as its start, inverse width and
+ * rise, worked out when a curve is set; curves with fewer points are
+ * padded with flat segments. evaluate() is then one pass per segment in
+ * use over contiguous arrays, which the compiler vectorizes.
+ */
+class SfocTable {
+public:
+    // Returns the unit's index
+    size_t add(const SfocCurve& curve);
+    void set(size_t unit, const SfocCurve& curve);
+    size_t size() const { return base_.size(); }
+
+    // sfoc[i] for load[i], for every unit
+    void evaluate(const double* load, double* sfoc) const;
+
+private:
+    static constexpr size_t SEGMENTS = SfocCurve::MAX_POINTS - 1;
+    static constexpr size_t BLOCK = 256;    // Units per block of evaluate()
+
+    size_t segments_ = 0;                   // Most of any curve
+
+    std::vector<double> base_;              // sfoc[0]
+    std::vector<double> start_[SEGMENTS];   // load[k]
+    std::vector<double> scale_[SEGMENTS];   // 1 / (load[k+1] - load[k]), 0 when padded
+    std::vector<double> rise_[SEGMENTS];    // sfoc[k+1] - sfoc[k]
+};
@@ -3,20 +3,13 @@
 #include <string>
 #include <vector>
 #include <chrono>
-#include <memory>
+#include "GeneratorSpec.h"
+#include "MachineDynamics.h"
+#include "MultiRate.h"
 #include "Sensors.h"
 
-/**
- * @brief Marine Generator Simulation Engine
- * 
- * This class models the behavior of a marine generator including:
- * - Engine startup/shutdown sequences
- * - Load management and power generation
- * - Sensor monitoring and alarm management
- * - Fuel consumption and efficiency calculations
- */
-class Generator {
-public:
+// Types shared by the generators of every engine family
+struct GeneratorTypes {
     enum class State {
         STOPPED,
         STARTING,
@@ -33,11 +26,12 @@ public:
         HIGH_VIBRATION,
         OVERSPEED
     };
+    static constexpr size_t ALARM_TYPE_COUNT = 6;
 
     struct Alarm {
         AlarmType type;
         std::string message;
-        std::chrono::system_clock::time_point timestamp;
+        std::chrono::system_clock::time_point timestamp;  // When the threshold was crossed, in simulated time
         bool active;
     };
 
@@ -50,32 +44,101 @@ public:
         double fuel_level;
         double oil_pressure;
         double cooling_temp;
+        ElectricalReadings electrical;    // Per-phase voltages and currents, power and power factor
         std::vector<Alarm> active_alarms;
     };
+};
+
+// As clients name alarm types, e.g. "high_temperature"
+const char* alarm_type_name(GeneratorTypes::AlarmType type);
 
-    Generator();
-    ~Generator() = default;
+/**
+ * @brief Marine Generator Simulation Engine
+ * 
+ * This class models the behavior of a marine generator including:
+ * - Engine startup/shutdown sequences
+ * - Load management and power generation
+ * - Sensor monitoring and alarm management
+ * - Fuel consumption and efficiency calculations
+ *
+ * The engine family is a compile-time policy (see EngineModels.h) that
+ * supplies the default spec; ratings, rates and thresholds are read from
+ * the unit's own GeneratorSpec. Generator is the diesel engine, and Fleet
+ * steps mixed families.
+ */
+template <typename Model>
+class BasicGenerator : public GeneratorTypes {
+public:
+    explicit BasicGenerator(const GeneratorSpec& spec = GeneratorSpec::defaults(Model::TYPE));
+    ~BasicGenerator() = default;
 
     // Control methods
     bool start();
     bool stop();
     bool emergency_stop();
-    void set_load(double percentage);
+    bool set_load(double percentage);    // False while stopped or faulted
+    bool follow_share(double percentage);   // Switchboard share: no 20% minimum, and not logged
     
     // Status methods
     GeneratorStatus get_status() const;
+    State get_state() const { return current_state_; }
     std::vector<Alarm> get_alarms() const;
+    double get_target_load() const;
+    double get_load() const { return current_load_; }
+    double get_ramp_load() const { return ramp_load_; }   // The load without its disturbance
+    double get_voltage() const { return current_voltage_; }
     
-    // Simulation update
+    // Simulation update: advances the unit by delta_time, working out
+    // its slow step, electrical readings and vibration spectrum itself
     void update(double delta_time);
+    // As stepped by Fleet (see Fleet.h), with the SFOC and thermal state
+    // of a due slow step and the time into it at which the jacket water
+    // crossed its alarm threshold; ignored while no slow step is due
+    void update(double delta_time, double sfoc, const ThermalNetwork::State& thermal, double temp_crossing);
+    double advance_slow_clock(double delta_time);   // Ahead of update(), see MultiRate.h
+    const SlowClock& slow_clock() const { return slow_clock_; }
+    const ElectricalCoefficients& electrical_coefficients() const { return electrical_coefficients_; }
+    void set_electrical(const ElectricalReadings& readings) { electrical_ = readings; }   // For the end of the step
+    bool vibration_frame_due() const { return sensors_.vibration_frame_due(); }
+    void vibration_frame(double* frame) const { sensors_.vibration_frame(frame); }
+    double vibration_sample_rate() const { return spec_.sensors.vibration_sample_rate; }
+    double shaft_speed() const { return current_rpm_ / 60.0; }   // Hz
+    void set_vibration_spectrum(const VibrationSpectrum& spectrum);   // Also checks the vibration alarm
+    const VibrationSpectrum& vibration_spectrum() const { return sensors_.vibration_spectrum(); }
+    void set_disturbance(double percentage) { disturbance_ = percentage; }   // Ahead of each update
+
+    // Fraction of rated heat into the thermal network: idle heat plus load
+    // while the engine turns, nothing when it is stopped
+    double heat_fraction() const;
+    const ThermalCoefficients& thermal_coefficients() const { return sensors_.thermal_coefficients(); }
+    const ThermalNetwork::State& thermal_state() const { return sensors_.thermal_state(); }
+    double ambient_temp() const { return sensors_.ambient_temp(); }
+
+    // Longest delta_time update() can take in one call without stepping
+    // over a state transition, the end of a load change or an alarm
+    // threshold; infinite when nothing is on its way
+    double time_to_next_event() const;
     
     // Configuration
     void set_parameters(double max_rpm, double max_voltage, double max_frequency);
+
+    // Replaces ratings, rates, thresholds and sensor characteristics between
+    // updates, keeping the present operating point; values derived from
+    // the spec are worked out here rather than on every update
+    void set_spec(const GeneratorSpec& spec);
+    const GeneratorSpec& spec() const { return spec_; }
     
     // Alarm management
     void acknowledge_alarm(AlarmType type);
     void reset_alarms();
 
+    // State transfer for hot restart: versioned "key value" lines,
+    // unknown keys are ignored so older snapshots still load
+    std::string save_state() const;
+    bool restore_state(const std::string& state);
+
+    static constexpr int STATE_VERSION = 1;
+
 private:
     // Generator state
     State current_state_;
@@ -87,40 +150,54 @@ private:
     double current_frequency_;
     double target_load_;
     double current_load_;
+    double disturbance_;      // % added to the target while running, see LoadDisturbance.h
+    double ramp_load_;        // Where the load ramp to the target alone has got to
     
-    // Physical parameters
-    double max_rpm_;
-    double max_voltage_;
-    double max_frequency_;
-    double max_load_;
+    // Physical parameters, and what is derived from them
+    GeneratorSpec spec_;
+    SensorTypes::AlarmLimits limits_;
+    double overload_load_;    // %
+    double overspeed_rpm_;
+    ElectricalCoefficients electrical_coefficients_;
     
+    // Governor and AVR dynamics while running
+    Governor governor_;
+    Exciter exciter_;
+    double overspeed_time_;   // Seconds into the last update, negative if the trip speed was not crossed
+
+    // Thermal network and fuel burn
+    SlowClock slow_clock_;
+
     // Sensor data
-    std::unique_ptr<Sensors> sensors_;
+    BasicSensors<Model> sensors_;
+    ElectricalReadings electrical_;
+    double vibration_crossing_;   // Seconds before the end of the last update, 0 if not crossed in it
     
     // Alarms
     std::vector<Alarm> alarms_;
     
-    // Timing
+    // Timing; the clock advances by each update's delta_time, so it keeps
+    // to wall time in real time and runs ahead of it when fast-forwarding
     std::chrono::system_clock::time_point last_update_;
     double startup_time_;
     double shutdown_time_;
     
     // Internal methods
+    double load_demand() const;   // Target the load ramps to
     void update_startup_sequence(double delta_time);
     void update_running_state(double delta_time);
+    void advance_dynamics(double delta_time);
+    void reset_dynamics();
     void update_shutdown_sequence(double delta_time);
-    void check_alarm_conditions();
-    void add_alarm(AlarmType type, const std::string& message);
+    void check_alarm_conditions(double delta_time, const double* crossing_times);
+    void add_alarm(AlarmType type, const std::string& message, double offset);  // Seconds into the step
     void remove_alarm(AlarmType type);
     
     // Smooth transitions
     double smooth_transition(double current, double target, double rate, double delta_time);
     
-    // Constants
-    static constexpr double RPM_ACCELERATION_RATE = 100.0;  // RPM per second
-    static constexpr double VOLTAGE_RAMP_RATE = 50.0;       // Volts per second
-    static constexpr double FREQUENCY_RAMP_RATE = 2.0;      // Hz per second
-    static constexpr double LOAD_RAMP_RATE = 10.0;          // % per second
-    static constexpr double STARTUP_TIME = 30.0;            // seconds
-    static constexpr double SHUTDOWN_TIME = 15.0;           // seconds
+    // Constants; ramp rates, sequence times and thresholds come from the spec
+    static constexpr double DYNAMIC_STEP = 0.005;           // Event step while governor or AVR move, seconds
 };
+
+using Generator = BasicGenerator<DieselEngine>;
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Fleet.h"
+#include "Generator.h"
+#include "HotRestart.h"
+#include "LoadDisturbance.h"
+#include "LoadProfile.h"
+#include "ModbusServer.h"
+#include "NmeaOutput.h"
+#include "PowerManagement.h"
+#include "RateLimiter.h"
+#include "ServerShard.h"
+#include "Switchboard.h"
+
+/**
+ * @brief Network front end for the generator simulation
+ *
+ * Owns the Fleet holding the simulated generator, of the engine family
+ * chosen at construction, and the simulation thread, which is the only
+ * thread that touches it. Clients are served by one or more ServerShard
+ * reactor threads; with more than one, each shard has its own
+ * SO_REUSEPORT listener and the kernel spreads new connections across
+ * them. After every tick the simulation thread publishes an immutable
+ * StatusSnapshot and applies the commands the shards queued since the
+ * previous pass; the operations of one command (several for a batch) are
+ * always applied back to back, with no update in between. Commands sent
+ * with `wait` stay in a small pending-completion table that is checked
+ * once per tick until the transition finishes or fails.
+ * Optional ModbusServer and NmeaOutput front ends run on their own
+ * threads. With a main switchboard the simulated generator is unit 0 of
+ * a bus shared with further gensets; its load then follows its share of
+ * the bus demand, solved once per tick, which a sea-state disturbance
+ * may perturb like that of each unit. The power management system on
+ * that bus may start and stop the generator like any other unit.
+ * A recorded LoadProfile can drive the generator's load or, with the
+ * switchboard, the bus demand; it plays at simulated time, so it runs
+ * as fast as a fast-forward does.
+ *
+ * With a hot restart path, initialize() first asks a running process on
+ * that path for its sockets and Generator state, and the simulation
+ * thread later watches the same path for a successor. Handing over stops
+ * every thread, settles outstanding commands and passes everything on;
+ * if the successor never acknowledges, service simply resumes.
+ */
+class GeneratorServer {
+public:
+    explicit GeneratorServer(const GeneratorSpec& spec = GeneratorSpec::defaults(EngineType::DIESEL));
+    ~GeneratorServer();
+
+    void set_limits(const RateLimits& limits) { limits_ = limits; }  // Before initialize()
+    void set_hot_restart_path(const std::string& path) { hot_restart_path_ = path; }  // Before initialize()
+    void set_spec_path(const std::string& path) { spec_path_ = path; }  // Read again by the reload command
+    bool set_bus_units(int units);  // Before initialize(); 0 disables the switchboard
+    bool set_bus_disturbance(const DisturbanceSpec& spec);  // After set_bus_units()
+    // The sections of a spec file rate bus units 0, 1, ...; after
+    // set_bus_units(), and false with nothing changed if there are more
+    // than the bus has
+    bool set_unit_specs(const std::vector<GeneratorSpec>& specs, std::string& error);
+    bool set_profile(ProfileTarget target, const std::string& path, std::string& error);  // Before initialize()
+    bool initialize(int thread_count = 1, int modbus_port = 0,
+                    const NmeaOutput::Config& nmea = NmeaOutput::Config());
+    void run();
+    void stop();
+
+    // Shard side
+    bool running() const { return running_; }
+    std::shared_ptr<const StatusSnapshot> snapshot() const;
+    const RateLimits& limits() const { return limits_; }
+    const std::string& profile_file(ProfileTarget target) const {  // JSON-escaped, fixed at startup
+        return profile_files_[static_cast<size_t>(target)];
+    }
+
+    // Admission control shared by all shards
+    bool admit_connection(bool adopted = false);  // Adopted connections are always admitted
+    void release_connection();
+    void count_throttled() { throttled_commands_.fetch_add(1, std::memory_order_relaxed); }
+    int active_connections() const { return active_connections_.load(std::memory_order_relaxed); }
+    uint64_t rejected_connections() const { return rejected_connections_.load(std::memory_order_relaxed); }
+    uint64_t throttled_commands() const { return throttled_commands_.load(std::memory_order_relaxed); }
+
+    static constexpr int PORT = 8081;
+    static constexpr double UPDATE_RATE = 200.0;  // Simulation ticks per second
+    static constexpr int MAX_THREADS = 64;
+    static constexpr double COMPLETION_TIMEOUT = 120.0;  // Simulated seconds
+    static constexpr double LOAD_TOLERANCE = 0.5;        // % load counted as reached
+    static constexpr int MAX_COMMANDS_PER_PASS = 64;     // Per shard, keeps ticks on time
+    static constexpr int MAX_HANDOFF_PASSES = 1000;      // Command passes to settle before a handoff
+    static constexpr double BUS_LOAD_DEADBAND = 0.1;     // % share change passed on to the generator
+    static constexpr double BUS_FREQUENCY = 60.0;        // Switchboard nominal values
+    static constexpr double BUS_VOLTAGE = 440.0;
+    static constexpr size_t GENERATOR = 0;               // The simulated generator in fleet_
+    static constexpr double EVENT_MARGIN = 1e-3;         // Seconds past an event a fast-forward step lands
+    static constexpr uint64_t MAX_FAST_FORWARD_STEPS = 1000000;
+    static constexpr double PROFILE_POWER_FACTOR = 0.8;  // Bus profiles without a kvar column
+
+private:
+    struct PendingCompletion {
+        size_t shard;
+        uint64_t connection_id;
+        ServerShard::RequestTag tag;
+        ServerShard::Operation::Type type;
+        double target_load;   // SET_LOAD: target after the generator's own limits
+        double elapsed;       // Simulated seconds since the command was applied
+    };
+
+    enum class Completion {
+        PENDING,
+        DONE,
+        FAILED
+    };
+
+    Fleet fleet_;               // Holds the simulated generator, whatever its family
+    std::atomic<bool> running_;
+    RateLimits limits_;
+    std::atomic<int> active_connections_;
+    std::atomic<uint64_t> rejected_connections_;
+    std::atomic<uint64_t> throttled_commands_;
+    std::shared_ptr<const StatusSnapshot> snapshot_;  // Accessed with std::atomic_load/atomic_store
+    std::vector<std::unique_ptr<ServerShard>> shards_;
+    std::thread simulation_thread_;
+    std::vector<std::thread> shard_threads_;
+    std::unique_ptr<ModbusServer> modbus_;
+    std::thread modbus_thread_;
+    std::unique_ptr<NmeaOutput> nmea_;
+    std::thread nmea_thread_;
+    std::vector<PendingCompletion> pending_completions_;
+    uint64_t tick_;
+    Switchboard switchboard_;   // Bus 0 when enabled; simulation thread only
+    double bus_share_;          // Load % last passed to the generator
+    PowerManagement power_management_;
+    LoadDisturbance bus_disturbance_;   // Of bus 0, when set
+    Generator::State bus_generator_state_;  // Changes are reported to power management
+    double simulated_time_;     // Seconds, power management timers
+    std::string spec_path_;     // Spec file the generator was loaded from, if any
+    LoadProfile profiles_[PROFILE_TARGET_COUNT];     // Simulation thread only
+    std::string profile_files_[PROFILE_TARGET_COUNT];
+    bool profile_generator_running_;    // Whether the generator profile's last look found it running
+
+    // Hot restart
+    std::string hot_restart_path_;
+    int control_socket_;    // Where a successor asks to take over
+    int handoff_socket_;    // Set by the simulation thread when one did
+
+    void join_threads();
+
+    // Hot restart
+    int take_over(HotRestart::Handoff& handoff);
+    void adopt(HotRestart::Handoff& handoff, int modbus_port, const NmeaOutput::Config& nmea);
+    void accept_takeover();
+    bool hand_off();
+
+    // Simulation
+    void simulation_loop();
+    void process_commands();
+    void publish_snapshot(uint64_t tick);
+    void update_switchboard(double delta_time);
+    void update_profiles(double delta_time);
+    std::string save_switchboard() const;
+    void restore_switchboard(const std::string& state);
+    std::string execute(const ServerShard::Command& command);
+    std::string apply(const ServerShard::Operation& operation);
+    std::string apply_bus(const ServerShard::Operation& operation);
+    std::string apply_power_management(const ServerShard::Operation& operation);
+    std::string apply_profile(const ServerShard::Operation& operation);
+    std::string fast_forward(double duration);
+    std::string reload_spec();
+
+    // Completion tracking
+    void check_completions(double delta_time);
+    Completion evaluate(const PendingCompletion& pending, const Generator::GeneratorStatus& status,
+                        std::string& message) const;
+    void complete(const PendingCompletion& pending, Completion result, const std::string& message);
+};
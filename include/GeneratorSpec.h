@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ElectricalModel.h"
+#include "EngineModels.h"
+#include "FuelModel.h"
+#include "LoadDisturbance.h"
+#include "ThermalNetwork.h"
+
+/**
+ * @brief Sensor characteristics of one generator
+ */
+struct SensorSpec {
+    double tank_volume;               // m³
+    double fuel_density;              // kg/m³
+    SfocCurve sfoc;
+    double oil_pressure_ramp;         // Bar per second
+    double oil_pressure_base;         // Bar at idle
+    double oil_pressure_load_factor;  // Bar per % load
+    double vibration_ramp;            // mm/s per second
+    double vibration_base;            // mm/s at idle
+    double vibration_load_factor;     // mm/s per % load
+    double noise;                     // Fraction of the reading
+    double fuel_sample_rate;          // Hz, per channel; see SensorChannel.h
+    double oil_pressure_sample_rate;
+    double temp_sample_rate;          // Cooling, oil and exhaust temperatures
+    double vibration_sample_rate;
+    double vibration_2x;              // 2x order relative to 1x; see VibrationSpectrum.h
+    double bpfo_order;                // Bearing defect frequencies, outer and inner race, in orders
+    double bpfi_order;
+    double outer_race_fault;          // mm/s RMS of each defect at rated speed, 0 for a sound bearing
+    double inner_race_fault;
+    ThermalSpec thermal;
+};
+
+/**
+ * @brief Ratings, ramp rates, sequence times, alarm thresholds, consumer
+ * load and sensor characteristics of one generator
+ *
+ * Every unit carries its own copy, so units of one engine family can be
+ * rated differently. defaults() gives the values of a family's policy in
+ * EngineModels.h; a spec file overrides any of them per unit. The file is
+ * a list of units, each a `[name]` line followed by `key value` lines:
+ *
+ *   # Emergency set
+ *   [emergency]
+ *   engine diesel
+ *   max_rpm 1500
+ *   startup_time 10
+ *   sfoc 25:220 50:204 75:195 100:198
+ *
+ * `engine` picks the family whose defaults the other keys override, and
+ * `sfoc` takes up to SfocCurve::MAX_POINTS load:g/kWh pairs in ascending
+ * load; `#` starts a comment. Values are checked when the file is parsed, and a
+ * file with any error is rejected as a whole.
+ */
+struct GeneratorSpec {
+    std::string name;
+    EngineType engine;
+
+    // Ratings
+    double max_rpm;
+    double max_voltage;
+    double max_frequency;
+    double max_load;                  // %
+    double rated_power;               // kW at 100% load
+
+    // Sequences
+    double rpm_acceleration_rate;     // RPM per second
+    double voltage_ramp_rate;         // Volts per second
+    double frequency_ramp_rate;       // Hz per second
+    double startup_time;              // Seconds
+    double shutdown_time;
+
+    // Load acceptance: load_ramp_rate below high_load, high_load_ramp_rate above
+    double load_ramp_rate;            // % per second
+    double high_load_ramp_rate;
+    double high_load;                 // %
+
+    // Governor
+    double inertia;                   // H, seconds
+    double actuator_time;             // Seconds
+
+    // Multi-rate integration, see MultiRate.h
+    double fast_step;                 // Seconds, substep of governor and AVR in a transient
+    double slow_step;                 // Seconds between steps of the thermal network and fuel burn
+    double transient_rate;            // Per unit per second, governor or AVR rate that counts as a transient
+
+    // Alarm thresholds
+    double low_fuel_level;            // %
+    double low_oil_pressure;          // Bar
+    double high_cooling_temp;         // Celsius
+    double high_vibration;            // mm/s
+    double overload;                  // Fraction of max load
+    double overspeed;                 // Fraction of max RPM
+
+    // Sea-state variation of the consumer load, % of rated load
+    DisturbanceSpec disturbance;
+
+    ElectricalSpec electrical;
+    SensorSpec sensors;
+
+    double load_ramp_rate_at(double load_percentage) const {
+        return load_percentage < high_load ? load_ramp_rate : high_load_ramp_rate;
+    }
+
+    static GeneratorSpec defaults(EngineType engine);
+
+    // Returns false with a message naming the line when the text is not a valid spec file
+    static bool parse(const std::string& text, std::vector<GeneratorSpec>& specs, std::string& error);
+    static bool load(const std::string& path, std::vector<GeneratorSpec>& specs, std::string& error);
+
+    // Overrides from a `key=value,...` list of the disturbance keys of a spec file
+    static bool parse_disturbance(const std::string& text, DisturbanceSpec& disturbance, std::string& error);
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Socket and state handoff between an old and a new server process
+ *
+ * The running process listens on a Unix socket. A new process started
+ * with the same path connects, asks to take over, and receives:
+ *
+ *   - the serialized Generator state
+ *   - every listening and client socket, passed with SCM_RIGHTS, each
+ *     with a one-line description telling the new process who owns it
+ *
+ * The old process exits once the new one acknowledges; if anything goes
+ * wrong before that it resumes serving with nothing lost. POSIX only.
+ */
+class HotRestart {
+public:
+    struct Descriptor {
+        std::string description;  // "<component> <kind> [details]"
+        int fd;
+    };
+
+    struct Handoff {
+        std::string state;
+        std::vector<Descriptor> descriptors;
+
+        void add(const std::string& description, int fd) { descriptors.push_back({description, fd}); }
+
+        // Removes and returns the descriptors whose description starts with prefix
+        std::vector<Descriptor> take(const std::string& prefix);
+
+        // Closes whatever no component claimed
+        void close_remaining();
+    };
+
+    // Old process side
+    static int listen(const std::string& path);
+    static int accept_request(int control_socket);
+    static bool send(int socket, const Handoff& handoff);
+    static bool wait_acknowledgement(int socket);
+
+    // New process side; connect() returns -1 when nobody is listening
+    static int connect(const std::string& path);
+    static bool receive(int socket, Handoff& handoff);
+    static bool acknowledge(int socket);
+
+    static void close_socket(int socket);
+    static int duplicate(int socket);
+    static bool supported();
+
+    // Buffered bytes travel inside descriptions as hex, "-" when empty
+    static std::string encode_bytes(const std::string& bytes);
+    static std::string decode_bytes(const std::string& text);
+
+    static constexpr int TIMEOUT_SECONDS = 5;
+    static constexpr size_t MAX_FDS_PER_MESSAGE = 64;
+    static constexpr uint32_t MAGIC = 0x31524847;  // "GHR1"
+};
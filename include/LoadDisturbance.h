@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief Random and wave-induced variation of one consumer load
+ *
+ * In % of what it perturbs: rated load for a generator, the demand for a
+ * bus. Both parts are off at 0.
+ */
+struct DisturbanceSpec {
+    double variation;          // %, standard deviation of the random load
+    double correlation_time;   // Seconds over which the random load forgets itself
+    double wave_amplitude;     // %, as strong as one sine of this amplitude
+    double wave_period;        // Seconds, peak period of the waves as encountered
+    uint64_t seed;             // Same seed, same disturbance
+
+    bool active() const { return variation > 0.0 || wave_amplitude > 0.0; }
+};
+
+/**
+ * @brief Sea-state load disturbances of many consumers, advanced together
+ *
+ * Each disturbance is the sum of
+ *
+ *   - an Ornstein-Uhlenbeck process for cranes, thrusters and hotel load,
+ *     taken over a step h with its exact discretization
+ *
+ *       x <- a * x + variation * sqrt(1 - a²) * n,   a = exp(-h / correlation_time)
+ *
+ *     so its statistics do not depend on the step
+ *   - the propulsion load swinging with the waves: WAVE_COMPONENTS sines
+ *     spread around the peak period, with phases drawn from the seed
+ *
+ * Random numbers are counter based: draw n of a disturbance is a hash of
+ * n and its key, itself a hash of the seed and the stream it was added
+ * with (a unit number, or BUS_STREAMS + a bus), so no disturbance's
+ * draws depend on the others in the batch. A normal is the sum of the four
+ * 16-bit uniforms of one draw scaled to unit variance; it stops at
+ * ±3.46, which spares a load outliers it would not have.
+ *
+ * Columns hold one value per disturbance, the waves as phasors that are
+ * rotated rather than evaluated. advance() takes every disturbance
+ * through the same whole steps of STEP_FRACTION of the shortest
+ * correlation time or wave period in use, holding the values in between,
+ * so the same seeds replay the same disturbance at the same simulated
+ * time however the ticks fall. Decay and rotation are polynomials, so a
+ * pass is multiplies, adds and a square root per column, which the
+ * compiler vectorizes.
+ */
+class LoadDisturbance {
+public:
+    static constexpr size_t WAVE_COMPONENTS = 4;
+    static constexpr uint64_t BUS_STREAMS = uint64_t(1) << 63;
+    static constexpr double STEP_FRACTION = 0.125;
+
+    // Returns the disturbance's index; it starts at 0 with the waves at
+    // their seeded phases
+    size_t add(const DisturbanceSpec& spec, uint64_t stream);
+    // Keeps the present state unless the seed changed, which starts over
+    void set(size_t index, const DisturbanceSpec& spec);
+    size_t size() const { return ou_.size(); }
+
+    // Advances every disturbance over delta_time and writes its value in %
+    void advance(double delta_time, double* value);
+
+    // Step of every disturbance; infinite with none active
+    double max_step() const { return max_step_; }
+
+private:
+    void seed(size_t index);
+    void update_max_step();
+
+    std::vector<DisturbanceSpec> specs_;
+    std::vector<uint64_t> streams_;
+    double max_step_ = std::numeric_limits<double>::infinity();
+    double pending_ = 0.0;        // Time advanced short of a whole step
+
+    // Coefficients
+    std::vector<double> variation_;
+    std::vector<double> inverse_time_;           // 1 / correlation_time
+    std::vector<double> amplitude_;              // Of each wave component
+    std::vector<double> omega_[WAVE_COMPONENTS]; // rad/s
+
+    // State
+    std::vector<uint64_t> key_;
+    std::vector<uint64_t> counter_;
+    std::vector<double> ou_;
+    std::vector<double> re_[WAVE_COMPONENTS];
+    std::vector<double> im_[WAVE_COMPONENTS];
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// What a profile drives: the generator's load, or the bus demand
+enum class ProfileTarget {
+    GENERATOR,
+    BUS
+};
+constexpr size_t PROFILE_TARGET_COUNT = 2;
+
+const char* profile_target_name(ProfileTarget target);
+bool parse_profile_target(const std::string& name, ProfileTarget& target);
+
+/**
+ * @brief Recorded consumer demand, played back from a memory-mapped file
+ *
+ * A profile is a series of time-stamped samples, each in effect until the
+ * next: the generator's load in %, or the bus demand in kW with an
+ * optional kvar. Sample times are seconds and must not go backwards; the
+ * first sample is the start of the recording, so epoch timestamps work as
+ * well as times from zero. Two formats are read, told apart by the first
+ * bytes:
+ *
+ *   CSV      one `time,value[,value]` line per sample; blank lines, `#`
+ *            comments and a header line before the first sample are
+ *            skipped
+ *   Binary   the magic "LPRF", then little-endian uint32 version (1),
+ *            column count (1 or 2) and a reserved 0, followed by records
+ *            of little-endian doubles: time, then the values
+ *
+ * The file is mapped, never read in whole. Playback parses one sample
+ * ahead of the position and moves through the mapping front to back, and
+ * the pages it has left behind are handed back every RELEASE_SPAN bytes,
+ * so a recording of many gigabytes plays in a small resident set.
+ * Seeking a binary file is a binary search over its fixed-size records;
+ * a CSV file is scanned from the start.
+ */
+class LoadProfile {
+public:
+    static constexpr size_t MAX_COLUMNS = 2;
+
+    enum class State {
+        EMPTY,      // No file
+        IDLE,       // Not playing
+        PLAYING,
+        FINISHED,   // Past the last sample, which stays in effect
+        FAILED      // Stopped at a malformed sample; see error()
+    };
+
+    struct Sample {
+        double time;                  // Seconds
+        double values[MAX_COLUMNS];
+    };
+
+    // What the status snapshot carries of a profile
+    struct Status {
+        State state;
+        double position;              // Seconds into the recording
+        uint64_t samples;             // Applied since playback started
+        Sample sample;                // In effect, time into the recording
+    };
+
+    LoadProfile();
+    ~LoadProfile();
+    LoadProfile(const LoadProfile&) = delete;
+    LoadProfile& operator=(const LoadProfile&) = delete;
+
+    // Maps the file and checks its header or first sample
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const std::string& path() const { return path_; }
+    size_t columns() const { return columns_; }
+    State state() const { return state_; }
+    const std::string& error() const { return error_; }
+    Status status() const { return {state_, position_, samples_, current_}; }
+    static const char* state_name(State state);
+
+    // Starts playing from seconds into the recording; the sample in
+    // effect there is returned by the next advance()
+    void play(double from);
+    void stop();
+
+    // Moves the position on by delta_time and returns true with the last
+    // sample passed, if any, which is then in effect
+    bool advance(double delta_time, Sample& sample);
+
+    // Seconds until the next sample takes effect; infinite when not playing
+    double time_to_next_sample() const;
+
+    static constexpr size_t RELEASE_SPAN = 64 << 20;   // Bytes
+    static constexpr size_t MAX_LINE = 256;
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t columns;
+        uint32_t reserved;
+    };
+
+    bool map(const std::string& path, std::string& error);
+    void unmap();
+    void release_behind();
+
+    bool read_sample(Sample& sample);    // False at the end or on a malformed sample
+    bool read_record(Sample& sample);
+    bool read_line(Sample& sample);
+    size_t parse_line(const char* line, Sample& sample) const;   // Fields parsed, 0 if malformed
+    void seek(double time);
+
+    std::string path_;
+    const char* data_;
+    size_t size_;
+#ifdef _WIN32
+    void* file_;
+    void* mapping_;
+#endif
+
+    bool binary_;
+    size_t columns_;
+    size_t start_;        // Offset of the first sample
+    double base_;         // Time of the first sample
+    size_t cursor_;       // Offset of the next unread sample
+    size_t released_;     // Offset up to which pages have been handed back
+    size_t line_;         // CSV line of the cursor, for errors
+    size_t start_line_;
+
+    State state_;
+    std::string error_;
+    double position_;
+    uint64_t samples_;
+    Sample current_;
+    Sample next_;
+    bool has_next_;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "StateSpace.h"
+
+/**
+ * @brief Speed governor with engine and generator inertia
+ *
+ * Second-order model in per unit of rated speed and power:
+ *
+ *   speed'  = (mechanical - electrical - DAMPING * speed) / (2 * inertia)
+ *   mechanical' = (-speed / DROOP - mechanical) / actuator_time
+ *
+ * where speed is the deviation from rated, and the inertia and actuator
+ * time are those of the unit's spec. The reference is fixed at
+ * rated speed with no load, so the speed settles DROOP below rated at
+ * full load after a damped dip whenever the load changes.
+ */
+class Governor {
+public:
+    Governor(double inertia, double actuator_time);   // H and fuel or throttle response, seconds
+
+    // Replaces the inertia and actuator time, keeping the present state
+    void configure(double inertia, double actuator_time);
+
+    // Places the model at the given speed and load with no transient
+    void reset(double speed, double power);
+    void update(double electrical_power, double delta_time);
+    bool settled(double electrical_power) const { return model_.settled({electrical_power}, SETTLED_TOLERANCE); }
+    void settle(double electrical_power);
+
+    // Fastest state's rate of change, per unit per second
+    double rate(double electrical_power) const { return model_.rate({electrical_power}); }
+
+    // Seconds into the last update() at which the speed first rose above
+    // the trip speed, between RK4 steps included; negative if it did not
+    void set_trip_speed(double speed) { trip_speed_ = speed; }
+    double trip_time() const { return trip_time_; }
+
+    double speed() const { return 1.0 + model_.x[0]; }   // Per unit of rated
+    double mechanical_power() const { return model_.x[1]; }
+
+    static constexpr double DAMPING = 1.0;
+    static constexpr double DROOP = 0.0278;        // 50 rpm at 1800 rpm
+    static constexpr double MAX_POWER = 1.1;       // Fuel limit, per unit
+    static constexpr double MAX_STEP = 0.05;       // Longest RK4 step, seconds
+    static constexpr double SETTLED_TOLERANCE = 1e-6;
+
+private:
+    StateSpace<2, 1> model_;   // x: speed deviation, mechanical power; u: electrical power
+    double trip_speed_;
+    double trip_time_;
+};
+
+/**
+ * @brief Automatic voltage regulator, exciter and field
+ *
+ * Second-order model in per unit of rated voltage, with the field flux
+ * behind the transient reactance:
+ *
+ *   field_voltage' = (GAIN * (reference - terminal) - field_voltage) / EXCITER_TIME
+ *   internal'      = (field_voltage - internal - (SYNCHRONOUS_REACTANCE - TRANSIENT_REACTANCE) * current)
+ *                    / FIELD_TIME
+ *   terminal       = internal - TRANSIENT_REACTANCE * current
+ *
+ * The reference gives rated voltage at no load. A load step first dips
+ * the voltage across the transient reactance, then the regulator pulls
+ * it back with some overshoot, leaving the small steady droop of a
+ * proportional regulator.
+ */
+class Exciter {
+public:
+    Exciter();
+
+    void reset(double voltage, double current);
+    void update(double current, double delta_time);
+    bool settled(double current) const { return model_.settled(input(current), SETTLED_TOLERANCE); }
+    void settle(double current);
+    double rate(double current) const { return model_.rate(input(current)); }
+
+    double voltage() const { return model_.x[1] - TRANSIENT_REACTANCE * current_; }   // Per unit of rated
+
+    static constexpr double GAIN = 20.0;
+    static constexpr double EXCITER_TIME = 0.2;           // Seconds
+    static constexpr double FIELD_TIME = 1.5;             // Open-circuit transient time constant, seconds
+    static constexpr double SYNCHRONOUS_REACTANCE = 0.48; // Per unit; 10 V steady droop at 440 V, full load
+    static constexpr double TRANSIENT_REACTANCE = 0.15;
+    static constexpr double MAX_STEP = 0.05;
+    static constexpr double SETTLED_TOLERANCE = 1e-6;
+
+private:
+    StateSpace<2, 2> model_;   // x: field voltage, internal voltage; u: reference, current
+    double current_;
+
+    // Reference chosen so the terminal voltage is rated with no load
+    static Vector<2> input(double current) { return {(1.0 + GAIN) / GAIN, current}; }
+};
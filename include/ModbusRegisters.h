@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Generator.h"
+
+/**
+ * @brief Modbus register image of one simulation tick
+ *
+ * Built once per tick by the simulation thread and published with the
+ * status snapshot. Registers are stored big-endian, exactly as they go on
+ * the wire, so a register read is a single bounded memcpy no matter how
+ * many masters are polling. Scaled values are rounded and clamped to the
+ * unsigned 16-bit range. The register map is documented in PROTOCOL.md.
+ */
+struct ModbusRegisters {
+    // Input registers (function 04), read-only
+    enum class Input : uint16_t {
+        STATE,          // Generator::State
+        RPM,            // rpm
+        VOLTAGE,        // 0.1 V
+        FREQUENCY,      // 0.01 Hz
+        LOAD,           // 0.1 %
+        FUEL_LEVEL,     // 0.1 %
+        OIL_PRESSURE,   // 0.1 bar
+        COOLING_TEMP,   // 0.1 °C
+        ALARMS,         // Bit i set => AlarmType i active
+        TICK_HIGH,      // Simulation tick, high word
+        TICK_LOW,       // Simulation tick, low word
+        VOLTAGE_AB,     // 0.1 V, line voltages
+        VOLTAGE_BC,
+        VOLTAGE_CA,
+        CURRENT_A,      // 0.1 A, line currents
+        CURRENT_B,
+        CURRENT_C,
+        ACTIVE_POWER,   // kW
+        REACTIVE_POWER, // kvar, lagging
+        APPARENT_POWER, // kVA
+        POWER_FACTOR,   // 0.001
+        COUNT
+    };
+
+    // Holding registers (functions 03, 06, 16)
+    enum class Holding : uint16_t {
+        LOAD_SETPOINT,  // 0.1 %; writing it sends set_load
+        COUNT
+    };
+
+    // Discrete inputs (function 02): AlarmType bits followed by state flags
+    enum class Discrete : uint16_t {
+        RUNNING = 6,
+        FAULT,
+        COUNT
+    };
+
+    // Coils (functions 01, 05, 15): momentary, writing ON issues the command
+    enum class Coil : uint16_t {
+        START,
+        STOP,
+        EMERGENCY_STOP,
+        COUNT
+    };
+
+    static constexpr size_t INPUT_COUNT = static_cast<size_t>(Input::COUNT);
+    static constexpr size_t HOLDING_COUNT = static_cast<size_t>(Holding::COUNT);
+    static constexpr size_t DISCRETE_COUNT = static_cast<size_t>(Discrete::COUNT);
+    static constexpr size_t COIL_COUNT = static_cast<size_t>(Coil::COUNT);
+
+    uint8_t input[INPUT_COUNT * 2];
+    uint8_t holding[HOLDING_COUNT * 2];
+    uint16_t discrete;  // Bit i => discrete input i
+
+    static ModbusRegisters build(const Generator::GeneratorStatus& status, double target_load, uint64_t tick);
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "HotRestart.h"
+#include "ServerShard.h"
+#include "SpscQueue.h"
+
+class GeneratorServer;
+
+/**
+ * @brief Modbus TCP front end for PLCs and SCADA masters
+ *
+ * Runs its own poll() reactor on a separate port. Reads are served from
+ * the ModbusRegisters image published with each StatusSnapshot, so any
+ * number of masters can poll without touching the simulation. Coil and
+ * holding register writes become generator operations that the
+ * simulation thread applies between two ticks, exactly like commands
+ * from ServerShard clients; the write is acknowledged once it has been
+ * queued. Supported functions: 01, 02, 03, 04, 05, 06, 15 and 16.
+ * Masters stay connected across a hot restart.
+ */
+class ModbusServer {
+public:
+    explicit ModbusServer(GeneratorServer& server);
+    ~ModbusServer();
+
+    bool initialize(int port);
+    void run();
+    void shutdown();
+
+    // Hot restart; adopt before initialize(), hand over once run() has returned
+    void adopt(HotRestart::Handoff& handoff, int port);
+    void hand_over(HotRestart::Handoff& handoff);
+
+    // Simulation thread side
+    bool next_command(ServerShard::Command& command) { return commands_.try_pop(command); }
+
+    static constexpr size_t COMMAND_QUEUE_SIZE = 256;
+
+private:
+    struct Connection {
+        int socket;
+        bool closed;
+        std::string input;
+        std::string output;
+    };
+
+    // Modbus exception codes
+    enum class Exception : uint8_t {
+        NONE = 0x00,
+        ILLEGAL_FUNCTION = 0x01,
+        ILLEGAL_DATA_ADDRESS = 0x02,
+        ILLEGAL_DATA_VALUE = 0x03,
+        SERVER_DEVICE_BUSY = 0x06
+    };
+
+    GeneratorServer& server_;
+    int port_;
+    int server_socket_;
+    std::vector<Connection> connections_;
+    SpscQueue<ServerShard::Command> commands_;
+
+    // Reactor
+    bool open_listener(int port);
+    void accept_clients();
+    void read_from(Connection& connection);
+    void flush(Connection& connection);
+    void close_connection(Connection& connection);
+
+    // Protocol handling
+    void process_input(Connection& connection);
+    void handle_request(Connection& connection, const uint8_t* adu, size_t length,
+                        const ModbusRegisters& image);
+    Exception read_bits(const uint8_t* pdu, size_t length, uint16_t bits, size_t count,
+                        uint8_t* response, size_t& response_length) const;
+    Exception read_registers(const uint8_t* pdu, size_t length, const uint8_t* registers, size_t count,
+                             uint8_t* response, size_t& response_length) const;
+    Exception write_coils(const uint8_t* pdu, size_t length);
+    Exception write_registers(const uint8_t* pdu, size_t length);
+    Exception submit(std::vector<ServerShard::Operation> operations);
+
+    static constexpr int BUFFER_SIZE = 1024;
+    static constexpr int LISTEN_BACKLOG = 16;
+    static constexpr int POLL_TIMEOUT_MS = 100;
+    static constexpr size_t MBAP_HEADER_SIZE = 7;
+    static constexpr size_t MAX_ADU_SIZE = 260;
+    static constexpr size_t MAX_OUTPUT_SIZE = 64 * 1024;  // Masters that stop reading are dropped
+    static constexpr size_t MAX_READ_BITS = 2000;
+    static constexpr size_t MAX_READ_REGISTERS = 125;
+};
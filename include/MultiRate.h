@@ -0,0 +1,58 @@
+#pragma once
+
+/**
+ * @brief Time built up for the slow subsystems of one generator
+ *
+ * A generator's subsystems run at different rates. The load ramp,
+ * governor and AVR are stepped on every update, and split into fast_step
+ * substeps while the unit is in a transient. The thermal network and the
+ * fuel burn change over minutes, so they run only once slow_step seconds
+ * have built up, over all of that time at once and at the mean heat and
+ * load of it. A SlowClock keeps those sums between their steps.
+ *
+ * A generator's advance_slow_clock() adds delta_time to its clock ahead
+ * of each update and returns the interval the slow step takes in it,
+ * 0 until slow_step has built up. Fuel is then burned at the SFOC of the
+ * interval's mean load and the network taken through it at its mean
+ * heat.
+ */
+class SlowClock {
+public:
+    // Adds one update at the load and heat fraction it starts from and
+    // returns the interval the slow subsystems are to take in it, 0 until
+    // a whole period has built up. The sums start over on the next call
+    // after a step falls due
+    double advance(double delta_time, double period, bool running, double load, double heat) {
+        if (interval_ > 0.0) {
+            *this = SlowClock();
+        }
+        elapsed_ += delta_time;
+        heat_time_ += heat * delta_time;
+        if (running) {
+            running_time_ += delta_time;
+            load_time_ += load * delta_time;
+        }
+        if (elapsed_ >= period) {
+            interval_ = elapsed_;
+        }
+        return interval_;
+    }
+
+    // Of the step due, 0 if none is
+    double interval() const { return interval_; }
+
+    // Seconds until a step falls due
+    double remaining(double period) const { return interval_ > 0.0 ? period : period - elapsed_; }
+
+    // Over the time built up; the load only over the time spent running
+    double running_time() const { return running_time_; }
+    double mean_load() const { return running_time_ > 0.0 ? load_time_ / running_time_ : 0.0; }
+    double mean_heat() const { return elapsed_ > 0.0 ? heat_time_ / elapsed_ : 0.0; }
+
+private:
+    double elapsed_ = 0.0;
+    double running_time_ = 0.0;
+    double load_time_ = 0.0;    // % seconds
+    double heat_time_ = 0.0;
+    double interval_ = 0.0;
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Generator.h"
+#include "HotRestart.h"
+
+class GeneratorServer;
+
+/**
+ * @brief NMEA 0183 sentence output for bridge integration systems
+ *
+ * Emits generator data as `ER` (engine room) talker sentences:
+ *
+ *   $ERRPM  engine speed
+ *   $ERXDR  electrical: voltage, frequency, load
+ *   $ERXDR  engine: coolant temperature, oil pressure, fuel level
+ *   $ERALR  one per alarm type, set or cleared
+ *
+ * Each group has its own rate. When a group is due the sentences for the
+ * latest tick are formatted once into a shared buffer and the same bytes
+ * go to every sink: TCP clients, a UDP destination and/or a
+ * pseudo-terminal. Runs on its own thread and only reads the published
+ * StatusSnapshot. TCP listeners and the pseudo-terminal survive a hot
+ * restart; the UDP socket is simply opened again.
+ */
+class NmeaOutput {
+public:
+    enum class Sentence {
+        RPM,
+        ELECTRICAL,
+        ENGINE,
+        ALARMS,
+        COUNT
+    };
+
+    struct Config {
+        int tcp_port;            // 0 = no TCP listener
+        std::string udp_host;    // Empty = no UDP output
+        int udp_port;
+        bool pty;                // Create a pseudo-terminal (POSIX only)
+        double rates[static_cast<size_t>(Sentence::COUNT)];  // Hz, 0 disables a group
+
+        Config();
+        bool enabled() const { return tcp_port > 0 || !udp_host.empty() || pty; }
+    };
+
+    explicit NmeaOutput(GeneratorServer& server);
+    ~NmeaOutput();
+
+    bool initialize(const Config& config);
+    void run();
+    void shutdown();
+
+    // Hot restart; adopt before initialize(), hand over once run() has returned
+    void adopt(HotRestart::Handoff& handoff, const Config& config);
+    void hand_over(HotRestart::Handoff& handoff);
+
+    // Sentence formatting
+    static std::string format_sentence(const std::string& body);
+    static uint8_t checksum(const char* body, size_t length);
+    static const char* sentence_name(Sentence sentence);
+    static bool parse_sentence(const std::string& name, Sentence& sentence);
+
+    static constexpr double MAX_RATE = 50.0;  // Hz per sentence group
+
+private:
+    struct Client {
+        int socket;
+        bool closed;
+        std::string output;
+        uint64_t dropped;   // Sentences skipped because the client fell behind
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    GeneratorServer& server_;
+    Config config_;
+    int tcp_socket_;
+    int udp_socket_;
+    std::vector<uint8_t> udp_address_;  // sockaddr of the UDP destination
+    int pty_fd_;
+    int pty_slave_fd_;  // Held open so the terminal settings stick
+    std::vector<Client> clients_;
+    Clock::time_point next_due_[static_cast<size_t>(Sentence::COUNT)];
+
+    // Sentences for the last formatted tick, one range per group
+    uint64_t buffer_tick_;
+    std::string buffer_;
+    std::string due_;   // Sentences going out in this pass
+    size_t offsets_[static_cast<size_t>(Sentence::COUNT) + 1];
+
+    bool open_tcp(int port);
+    bool open_udp(const std::string& host, int port);
+    bool open_pty();
+    void accept_clients();
+    void service_client(Client& client, short revents);
+    void flush(Client& client);
+    void close_client(Client& client);
+
+    void emit_due();
+    void format_tick(const Generator::GeneratorStatus& status, uint64_t tick);
+    void write_all(const std::string& data);
+    int poll_timeout_ms() const;
+
+    static constexpr int LISTEN_BACKLOG = 16;
+    static constexpr int IDLE_POLL_TIMEOUT_MS = 100;
+    static constexpr size_t MAX_CLIENT_OUTPUT = 16 * 1024;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Bounded per-connection output queue
+ *
+ * Holds frames waiting for a non-blocking socket to become writable so a
+ * stalled consumer never blocks the reactor. When the queue is full the
+ * configured policy decides what happens: status frames can be conflated
+ * to the most recent one, the oldest frames can be dropped, or the
+ * connection can be dropped. Frames are shared pointers so one encoded
+ * status frame can sit in many queues at once.
+ */
+class OutputQueue {
+public:
+    enum class Policy {
+        CONFLATE,     // Keep only the latest pending status frame
+        DROP_OLDEST,  // Discard the oldest unsent frames on overflow
+        DISCONNECT    // Overflow closes the connection
+    };
+
+    enum class Kind {
+        CONTROL,  // Handshake, close and pong frames; never dropped
+        REPLY,    // Command replies
+        STATUS    // Pushed status frames
+    };
+
+    using Frame = std::shared_ptr<const std::string>;
+
+    OutputQueue();
+
+    // Queue a frame; returns false if the connection must be closed
+    bool push(const Frame& frame, Kind kind);
+
+    // Socket side
+    bool empty() const;
+    bool has_pending_status() const;
+    const char* pending_data() const;
+    size_t pending_size() const;
+    void consume(size_t bytes);
+    void clear();
+    std::string unsent() const;  // Everything not yet written, in order
+
+    // Configuration
+    void set_policy(Policy policy);
+    void set_limits(size_t max_frames, size_t max_bytes);
+    Policy policy() const { return policy_; }
+    size_t max_frames() const { return max_frames_; }
+
+    // Statistics
+    size_t depth() const { return entries_.size(); }
+    size_t bytes() const { return bytes_; }
+    size_t high_watermark() const { return high_watermark_; }
+    uint64_t dropped() const { return dropped_; }
+    uint64_t conflated() const { return conflated_; }
+
+    static const char* policy_name(Policy policy);
+    static bool parse_policy(const std::string& name, Policy& policy);
+
+    static constexpr size_t DEFAULT_MAX_FRAMES = 64;
+    static constexpr size_t DEFAULT_MAX_BYTES = 256 * 1024;
+
+private:
+    struct Entry {
+        Frame frame;
+        Kind kind;
+    };
+
+    std::deque<Entry> entries_;
+    size_t front_offset_;  // Bytes of the front frame already written
+    size_t bytes_;         // Unsent bytes across all entries
+
+    Policy policy_;
+    size_t max_frames_;
+    size_t max_bytes_;
+
+    size_t high_watermark_;
+    uint64_t dropped_;
+    uint64_t conflated_;
+
+    bool over_limit() const;
+    bool drop_oldest(bool status_only);
+    bool in_flight(size_t index) const { return index == 0 && front_offset_ > 0; }
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Switchboard.h"
+
+/**
+ * @brief Power management system: standby start/stop and load shedding
+ *
+ * Keeps enough units of one Switchboard::Bus online for its demand:
+ *
+ *   - above START_LOAD of the online capacity, the standby unit with the
+ *     lowest priority number is started after START_DELAY, one at a time
+ *   - when the online units would still carry the load below STOP_LOAD
+ *     without the unit with the highest priority number, that unit is
+ *     stopped after STOP_DELAY
+ *   - when demand exceeds the online capacity, for instance after a
+ *     unit trips, non-essential load is shed at once, tier 1 first, and
+ *     a standby unit is started without delay; shed tiers come back,
+ *     most essential first, once they fit under START_LOAD again
+ *
+ * Rules are event driven. Each evaluation works out the band of demand
+ * within which none of its decisions could change and the time of its
+ * next timer, so due() is a handful of comparisons per tick; evaluate()
+ * only runs when demand leaves the band, a timer expires or notify()
+ * reports a change on the bus such as a breaker or a unit dropping out.
+ *
+ * The manager starts and stops ordinary units itself; they join the bus
+ * UNIT_START_TIME after being started. External units (the simulated
+ * Generator) are started and stopped by the caller from the requests
+ * evaluate() returns and report back through Bus::running. A unit that
+ * leaves the bus without being asked, or does not come online within
+ * START_TIMEOUT, is blocked until the manager is switched on again.
+ */
+class PowerManagement {
+public:
+    enum class UnitState {
+        MANUAL,     // Priority 0: left to the operator, capacity still counts
+        STANDBY,
+        STARTING,
+        ONLINE,
+        BLOCKED     // Tripped or failed to start
+    };
+
+    // Start or stop of an external unit, carried out by the caller
+    struct Request {
+        size_t unit;
+        bool start;
+    };
+
+    static constexpr size_t MAX_TIERS = 3;
+
+    PowerManagement();
+
+    // Setup
+    void set_external(size_t unit) { external_[unit] = true; }
+    bool set_priority(size_t unit, int priority);  // 0 leaves the unit to the operator
+    bool set_tier(size_t tier, double kw);          // Non-essential load included in the bus demand
+
+    // Switching on takes the units as they are and clears blocked ones;
+    // switching off reconnects shed load and leaves the units running
+    void enable(Switchboard::Bus& bus);
+    void disable(Switchboard::Bus& bus);
+    bool enabled() const { return enabled_; }
+
+    void notify() { changed_ = true; }
+    bool due(const Switchboard::Bus& bus, double now) const {
+        return enabled_ && (changed_ || now >= deadline_ || bus.load_kw() < band_low_ || bus.load_kw() > band_high_);
+    }
+    // Updates running flags and Bus::shed_kw; returns the number of requests written
+    size_t evaluate(Switchboard::Bus& bus, double now, Request* requests);
+
+    UnitState unit_state(size_t unit) const { return states_[unit]; }
+    int priority(size_t unit) const { return priorities_[unit]; }
+    double tier_kw(size_t tier) const { return tiers_[tier]; }
+    size_t shed_tiers() const { return shed_tiers_; }  // Tiers 1..n are shed
+    uint64_t evaluations() const { return evaluations_; }
+    double deadline() const { return deadline_; }       // Next timer, simulated seconds
+
+    static const char* state_name(UnitState state);
+
+    static constexpr double START_LOAD = 0.85;       // Fraction of online capacity
+    static constexpr double STOP_LOAD = 0.6;
+    static constexpr double START_DELAY = 10.0;      // Simulated seconds
+    static constexpr double STOP_DELAY = 30.0;
+    static constexpr double RESTORE_DELAY = 5.0;
+    static constexpr double UNIT_START_TIME = 15.0;
+    static constexpr double START_TIMEOUT = 60.0;
+    static constexpr int MAX_PRIORITY = 99;
+
+private:
+    enum class Action {
+        NONE,
+        START,
+        STOP,
+        RESTORE
+    };
+
+    bool enabled_;
+    bool changed_;
+    bool external_[Switchboard::MAX_UNITS];
+    int priorities_[Switchboard::MAX_UNITS];
+    UnitState states_[Switchboard::MAX_UNITS];
+    double start_deadlines_[Switchboard::MAX_UNITS];
+    double tiers_[MAX_TIERS];
+    size_t shed_tiers_;
+    Action action_;
+    double action_deadline_;
+    double deadline_;       // Earliest timer
+    double band_low_;       // Demand band with nothing to decide
+    double band_high_;
+    uint64_t evaluations_;
+
+    void update_units(Switchboard::Bus& bus, double now, Request* requests, size_t& count);
+    double shed_kw() const;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Token bucket used to rate limit one class of client commands
+ *
+ * Holds up to `burst` tokens and refills at `rate` tokens per second;
+ * each command takes one. A rate of zero means unlimited.
+ */
+class TokenBucket {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket()
+        : rate_(0.0)
+        , burst_(0.0)
+        , tokens_(0.0)
+        , last_refill_(Clock::now())
+    {
+    }
+
+    void configure(double rate, double burst) {
+        rate_ = rate;
+        burst_ = std::max(burst, 1.0);
+        tokens_ = burst_;
+        last_refill_ = Clock::now();
+    }
+
+    bool try_take(Clock::time_point now) {
+        if (rate_ <= 0.0) {
+            return true;
+        }
+        double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+        last_refill_ = now;
+        tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+        if (tokens_ < 1.0) {
+            return false;
+        }
+        tokens_ -= 1.0;
+        return true;
+    }
+
+    double rate() const { return rate_; }
+    double burst() const { return burst_; }
+    double tokens() const { return tokens_; }
+
+private:
+    double rate_;
+    double burst_;
+    double tokens_;
+    Clock::time_point last_refill_;
+};
+
+/**
+ * @brief Admission limits applied by every reactor thread
+ *
+ * Commands are grouped into classes so a client polling `status` in a
+ * loop cannot starve its own control commands, and vice versa.
+ */
+struct RateLimits {
+    enum class Class {
+        QUERY,    // status, spectrum, clients, limits and unknown commands
+        CONTROL,  // Generator commands and batches
+        CONFIG,   // stream, deadband, queue
+        COUNT
+    };
+
+    static constexpr size_t CLASS_COUNT = static_cast<size_t>(Class::COUNT);
+
+    double rate[CLASS_COUNT];   // Commands per second, 0 = unlimited
+    double burst[CLASS_COUNT];
+    int max_connections;        // Across all reactor threads, 0 = unlimited
+
+    RateLimits()
+        : rate{50.0, 10.0, 5.0}
+        , burst{100.0, 20.0, 10.0}
+        , max_connections(256)
+    {
+    }
+
+    static const char* class_name(Class command_class) {
+        switch (command_class) {
+            case Class::QUERY: return "query";
+            case Class::CONTROL: return "control";
+            case Class::CONFIG: return "config";
+            case Class::COUNT: break;
+        }
+        return "unknown";
+    }
+
+    static bool parse_class(const std::string& name, Class& command_class) {
+        for (size_t i = 0; i < CLASS_COUNT; ++i) {
+            if (name == class_name(static_cast<Class>(i))) {
+                command_class = static_cast<Class>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cmath>
+
+/**
+ * @brief Sampling and decimation of one sensor channel
+ *
+ * A channel samples its process value at its own rate, whatever the
+ * update rate: a vibration pickup at a kilohertz, a tank gauge once a
+ * second. The sampling phase carries over from one update to the next,
+ * so a slow channel takes a sample only on the updates where one falls
+ * due and holds its reading on the others, drawing no noise at all.
+ *
+ * The samples that fall within one update are averaged into the reading,
+ * a first-order CIC decimator down to the update rate. Its sinc response
+ * has nulls at every multiple of the update rate, where the noise of a
+ * fast channel would otherwise fold back onto the reading. Over a long
+ * step only the last MAX_SAMPLES samples are taken, which is all the
+ * reading at its end depends on; for vibration, one spectrum frame.
+ */
+class SensorChannel {
+public:
+    explicit SensorChannel(double reading = 0.0) : rate_(1.0), since_(0.0), reading_(reading) {}
+
+    void set_rate(double sample_rate) { rate_ = sample_rate; }
+    double rate() const { return rate_; }
+
+    // Samples falling due over delta_time, at most MAX_SAMPLES
+    int advance(double delta_time) {
+        since_ += delta_time;
+        double due = std::floor(since_ * rate_);
+        since_ -= due / rate_;
+        return due < MAX_SAMPLES ? static_cast<int>(due) : MAX_SAMPLES;
+    }
+
+    // Averages count samples drawn from sample() into the reading; with
+    // none due the reading is held
+    template <typename Sample>
+    void decimate(int count, Sample&& sample) {
+        if (count == 0) {
+            return;
+        }
+        double sum = 0.0;
+        for (int i = 0; i < count; ++i) {
+            sum += sample();
+        }
+        reading_ = sum / count;
+    }
+
+    // Samples falling due over delta_time, decimated into the reading
+    template <typename Sample>
+    void update(double delta_time, Sample&& sample) {
+        decimate(advance(delta_time), sample);
+    }
+
+    double reading() const { return reading_; }
+    void set_reading(double reading) { reading_ = reading; }
+
+    static constexpr int MAX_SAMPLES = 256;
+
+private:
+    double rate_;      // Hz
+    double since_;     // Seconds since the last sample
+    double reading_;
+};
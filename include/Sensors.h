@@ -1,33 +1,108 @@
 #pragma once
 
 #include <chrono>
+#include <string>
+#include "EngineModels.h"
+#include "GeneratorSpec.h"
+#include "SensorChannel.h"
+#include "ThermalNetwork.h"
+#include "VibrationSpectrum.h"
 
-/**
- * @brief Sensor monitoring system for the marine generator
- * 
- * This class simulates various sensors and provides realistic
- * sensor readings with noise and drift characteristics
- */
-class Sensors {
-public:
+// Types shared by the sensors of every engine family
+struct SensorTypes {
     struct SensorReadings {
         double fuel_level;      // Percentage (0-100)
         double oil_pressure;    // Bar
-        double cooling_temp;    // Celsius
+        double cooling_temp;    // Celsius, jacket water
+        double oil_temp;        // Celsius, lube oil
         double vibration;       // mm/s RMS
         double exhaust_temp;    // Celsius
         double ambient_temp;    // Celsius
         double humidity;        // Percentage
     };
 
-    Sensors();
-    ~Sensors() = default;
+    // Alarm thresholds, for working out when a reading will cross one
+    struct AlarmLimits {
+        double low_fuel_level;
+        double low_oil_pressure;
+        double high_vibration;
+    };
+
+    // Seconds until each reading crosses its limit
+    struct AlarmTimes {
+        double fuel_level;
+        double oil_pressure;
+        double vibration;
+    };
+};
+
+/**
+ * @brief Sensor monitoring system for the marine generator
+ * 
+ * This class simulates various sensors and provides realistic
+ * sensor readings with noise and drift characteristics. Targets, ramp
+ * rates and noise come from a SensorSpec, by default that of the engine
+ * family (see EngineModels.h). Temperatures are read off a thermal
+ * network, which the generator integrates before each update.
+ *
+ * Each reading is a SensorChannel sampling the value behind it at the
+ * channel's own rate and decimating the samples to the update rate;
+ * noise is in the samples only. The alarm logic and telemetry see the
+ * decimated readings, and alarm crossings follow the values behind them.
+ *
+ * Vibration is the exception: its channel sets the pace of a synthesized
+ * velocity waveform (see VibrationSpectrum.h) with the 1x and 2x orders
+ * of the shaft speed, the bearing defect tones and broadband noise. The
+ * reading is the overall RMS of the waveform's latest spectrum, which the
+ * generator works out once a frame is due and hands in.
+ */
+template <typename Model>
+class BasicSensors : public SensorTypes {
+public:
+    BasicSensors();
+    ~BasicSensors() = default;
+
+    void set_spec(const GeneratorSpec& spec);
+
+    // Thermal network of this engine; set_thermal_state() takes it over
+    // the generator's slow step, ahead of update()
+    const ThermalCoefficients& thermal_coefficients() const { return thermal_coefficients_; }
+    const ThermalNetwork::State& thermal_state() const { return thermal_; }
+    void set_thermal_state(const ThermalNetwork::State& state) { thermal_ = state; }
+    double ambient_temp() const { return current_readings_.ambient_temp; }
 
     // Get current sensor readings
     SensorReadings get_readings() const;
     
-    // Update sensor values based on generator state
-    void update(double delta_time, bool generator_running, double load_percentage);
+    // Update sensor values based on generator state, with the shaft
+    // turning at shaft_speed Hz
+    void update(double delta_time, bool generator_running, double load_percentage, double shaft_speed);
+
+    // Vibration frame and its spectrum; set_vibration_spectrum() takes the
+    // spectrum of the frame due and makes its overall RMS the reading
+    bool vibration_frame_due() const { return waveform_.frame_due(); }
+    void vibration_frame(double* frame) const { waveform_.frame(frame); }
+    const VibrationSpectrum& vibration_spectrum() const { return spectrum_; }
+    void set_vibration_spectrum(const VibrationSpectrum& spectrum);
+
+    // Burns fuel over the running time of the generator's slow step, at
+    // the mean load of it and the SFOC of that load, in g/kWh
+    void burn_fuel(double running_time, double load_percentage, double sfoc);
+
+    // Seconds until a reading crosses one of the limits, following the
+    // ramps update() makes toward constant targets and leaving out noise,
+    // and no sooner than fuel_due, when fuel is next burned. Within that
+    // time update() is exact for any delta_time, apart from noise being
+    // drawn once per call; 0 when calibration drift rules that out
+    double time_to_crossing(bool generator_running, double load_percentage, const AlarmLimits& limits,
+                            double fuel_due) const;
+
+    // Per reading, following the same ramps; infinite when a ramp does not
+    // cross, and always so for failed sensors. Drift is left out, and so
+    // are temperatures, whose crossing the thermal network reports. The
+    // vibration limit is taken on the overall RMS, bearing defects and
+    // noise included
+    AlarmTimes crossing_times(bool generator_running, double load_percentage, const AlarmLimits& limits) const;
     
     // Simulate sensor failures or calibration drift
     void set_sensor_failure(bool fuel_failed, bool oil_failed, bool temp_failed);
@@ -36,9 +111,38 @@ public:
     // Reset sensors to normal operation
     void reset_sensors();
 
+    // State transfer, as "sensors.<key> value" lines inside the Generator state
+    std::string save_state() const;
+    void restore_state(const std::string& state);
+
 private:
-    // Current sensor values
+    SensorSpec spec_;
+    double fuel_factor_;   // % of the tank per second, per % load and g/kWh
+    ThermalCoefficients thermal_coefficients_;
+    ThermalNetwork::State thermal_;
+
+    // % of the tank per second
+    double fuel_rate(double load_percentage, double sfoc) const { return load_percentage * sfoc * fuel_factor_; }
+
+    // Current sensor values, as decimated by the channels
     SensorReadings current_readings_;
+
+    // Values behind the readings, and the channels sampling them
+    double fuel_level_;
+    double oil_pressure_;
+    double vibration_;
+    SensorChannel fuel_channel_;
+    SensorChannel oil_pressure_channel_;
+    SensorChannel cooling_temp_channel_;
+    SensorChannel oil_temp_channel_;
+    SensorChannel exhaust_temp_channel_;
+    SensorChannel vibration_channel_;
+    void reset_channels();   // Channels restart from the readings
+
+    // Vibration waveform and the spectrum of its latest frame
+    VibrationWaveform waveform_;
+    VibrationSpectrum spectrum_;
+    double rated_shaft_speed_;   // Hz, at which the bearing defects have their spec level
     
     // Sensor failure flags
     bool fuel_sensor_failed_;
@@ -49,6 +153,7 @@ private:
     double fuel_calibration_drift_;
     double oil_calibration_drift_;
     double temp_calibration_drift_;
+    double temp_offset_;    // Drift accumulated so far
     
     // Noise and drift simulation
     double add_noise(double value, double noise_level) const;
@@ -58,19 +163,14 @@ private:
     double smooth_transition(double current, double target, double rate, double delta_time) const;
     
     // Sensor-specific update methods
-    void update_fuel_sensor(double delta_time, bool generator_running, double load_percentage);
+    void update_fuel_sensor(double delta_time);
     void update_oil_pressure_sensor(double delta_time, bool generator_running, double load_percentage);
     void update_temperature_sensors(double delta_time, bool generator_running, double load_percentage);
-    void update_vibration_sensor(double delta_time, bool generator_running, double load_percentage);
+    void update_vibration_sensor(double delta_time, bool generator_running, double load_percentage,
+                                 double shaft_speed);
     
     // Constants for realistic sensor behavior
-    static constexpr double FUEL_CONSUMPTION_RATE = 0.1;      // % per second at full load
-    static constexpr double OIL_PRESSURE_BASE = 3.0;          // Bar at idle
-    static constexpr double OIL_PRESSURE_LOAD_FACTOR = 0.02;  // Bar per % load
-    static constexpr double COOLING_TEMP_BASE = 85.0;         // Celsius at normal operation
-    static constexpr double COOLING_TEMP_LOAD_FACTOR = 0.3;   // Celsius per % load
-    static constexpr double VIBRATION_BASE = 2.0;             // mm/s at idle
-    static constexpr double VIBRATION_LOAD_FACTOR = 0.05;     // mm/s per % load
-    static constexpr double SENSOR_NOISE_LEVEL = 0.02;        // 2% noise
     static constexpr double DRIFT_RATE = 0.001;               // Slow drift over time
 };
+
+using Sensors = BasicSensors<DieselEngine>;
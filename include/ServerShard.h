@@ -0,0 +1,261 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Generator.h"
+#include "HotRestart.h"
+#include "LoadProfile.h"
+#include "ModbusRegisters.h"
+#include "OutputQueue.h"
+#include "PowerManagement.h"
+#include "RateLimiter.h"
+#include "SpscQueue.h"
+#include "StatusEncoder.h"
+#include "Switchboard.h"
+#include "VibrationSpectrum.h"
+
+class GeneratorServer;
+
+/**
+ * @brief Generator status published once per simulation tick
+ *
+ * Immutable once published, so every reactor thread can read it without
+ * touching the Generator.
+ */
+struct StatusSnapshot {
+    uint64_t tick;
+    Generator::GeneratorStatus status;
+    ModbusRegisters modbus;
+    bool bus_enabled;
+    Switchboard::Bus bus;   // Main switchboard, when enabled
+    PowerManagement power_management;
+    VibrationSpectrum spectrum;   // Latest vibration frame of the generator
+    LoadProfile::Status profiles[PROFILE_TARGET_COUNT];
+};
+
+/**
+ * @brief One reactor thread of the generator server
+ *
+ * Each shard owns a listening socket on the engine port (shared with the
+ * other shards through SO_REUSEPORT), its connections and their buffers.
+ * Plain TCP clients use the text protocol from PROTOCOL.md; browsers can
+ * upgrade to a WebSocket and subscribe to a pushed status stream.
+ *
+ * Status and stream frames are served from the latest StatusSnapshot.
+ * Commands that change the generator are forwarded to the simulation
+ * thread over a lock-free queue and answered when the reply comes back;
+ * further input from that client waits so replies stay in order. A
+ * `batch` carries several operations that are applied in the same gap
+ * between two ticks, up to the first that fails, and answered with one
+ * combined reply. With
+ * `wait`, a completion event follows once the generator has actually
+ * reached the requested state; other commands are not held up by it.
+ *
+ * Every command takes a token from the connection's bucket for its
+ * RateLimits class before it is even logged; a throttled command gets a
+ * prebuilt rejection reply and never reaches the simulation thread.
+ *
+ * For a hot restart the shard hands its listener and connections over,
+ * together with their protocol, streaming settings and buffered bytes,
+ * and the shards of the new process adopt them before they start.
+ */
+class ServerShard {
+public:
+    // Optional client-chosen request ID echoed in replies and events
+    struct RequestTag {
+        bool present;
+        uint64_t id;
+    };
+
+    // One change to the generator, applied by the simulation thread
+    struct Operation {
+        enum class Type {
+            START,
+            STOP,
+            EMERGENCY_STOP,
+            SET_LOAD,
+            ACKNOWLEDGE_ALARM,
+            RESET_ALARMS,
+            SET_PARAMETERS,
+            SET_BUS_DEMAND,
+            SET_UNIT_MODE,
+            SET_BREAKER,
+            SET_POWER_MANAGEMENT,
+            SET_UNIT_PRIORITY,
+            SET_SHED_TIER,
+            FAST_FORWARD,
+            RELOAD_SPEC,
+            PLAY_PROFILE,
+            STOP_PROFILE
+        };
+
+        Type type;
+        double values[3];  // set_load: %, acknowledge_alarm: AlarmType, set_parameters: rpm, V, Hz,
+                           // set_bus_demand: kW, kvar, set_unit_mode: unit, Mode, droop,
+                           // set_breaker: unit, closed, set_power_management: enabled,
+                           // set_unit_priority: unit, priority, set_shed_tier: tier, kW,
+                           // fast_forward: seconds, play_profile: ProfileTarget, from seconds,
+                           // stop_profile: ProfileTarget
+    };
+
+    struct Command {
+        uint64_t connection_id;
+        std::vector<Operation> operations;  // Applied together between two ticks
+        bool batch;      // Reply with one combined result for all operations
+        RequestTag tag;
+        bool wait;       // Follow the reply with a completion event
+    };
+
+    struct Reply {
+        uint64_t connection_id;
+        RequestTag tag;
+        std::string message;
+        bool event;      // Completion event rather than a command reply
+    };
+
+    ServerShard(GeneratorServer& server, int index, int shard_count);
+    ~ServerShard();
+
+    bool initialize(int port, bool reuse_port);
+    void run();
+    void shutdown();
+    void wake();
+
+    // Hot restart; adopt before initialize(), hand over once run() has returned
+    void adopt_listener(int socket);
+    bool adopt_connection(const std::string& description, int socket);
+    bool quiesce();   // Drains replies and output, true once nothing is owed
+    void hand_over(HotRestart::Handoff& handoff) const;
+
+    // Simulation thread side
+    bool next_command(Command& command) { return commands_.try_pop(command); }
+    void deliver(Reply reply);
+
+    static constexpr size_t COMMAND_QUEUE_SIZE = 1024;
+
+private:
+    enum class Protocol {
+        PENDING,     // No bytes yet, protocol not known
+        TEXT,        // Newline-delimited text commands
+        WEBSOCKET    // RFC 6455 after a successful upgrade
+    };
+
+    enum class StreamEncoding {
+        JSON,
+        BINARY
+    };
+
+    using Frame = std::shared_ptr<const std::string>;
+
+    struct Connection {
+        uint64_t id;
+        int socket;
+        std::string address;
+        Protocol protocol;
+        bool closing;    // Close once queued output has drained
+        bool closed;
+        std::string input;
+        bool input_unterminated;
+        bool newline_framed;   // Client has sent at least one newline
+        std::string ws_message;
+        bool ws_fragmented;    // A message has started and awaits its final fragment
+        OutputQueue output;
+        bool awaiting_reply;
+
+        // Status streaming
+        bool streaming;
+        StreamEncoding encoding;
+        std::chrono::steady_clock::duration stream_interval;
+        std::chrono::steady_clock::time_point next_stream;
+
+        // Delta streaming
+        bool delta;
+        DeltaEncoder delta_encoder;
+        uint64_t delta_drops_seen;
+
+        // Admission control
+        TokenBucket buckets[RateLimits::CLASS_COUNT];
+        uint64_t throttled[RateLimits::CLASS_COUNT];
+    };
+
+    // Shared per-tick status frames
+    struct StatusFrames {
+        std::shared_ptr<const StatusSnapshot> snapshot;
+        Frame text_json;       // TCP: JSON + newline
+        Frame websocket_json;  // WebSocket text frame
+        Frame websocket_binary;// WebSocket binary frame
+    };
+
+    GeneratorServer& server_;
+    int index_;
+    int shard_count_;
+    int server_socket_;
+    int wake_fds_[2];   // Self-pipe the simulation thread writes to after a reply
+    std::vector<Connection> connections_;
+    uint64_t next_connection_id_;
+    StatusFrames status_frames_;
+    Frame throttled_text_;       // Prebuilt rate limit rejections
+    Frame throttled_websocket_;
+
+    SpscQueue<Command> commands_;
+    SpscQueue<Reply> replies_;
+    size_t replies_owed_;   // Replies and events the simulation thread still has to send
+
+    // Reactor
+    bool open_listener(int port, bool reuse_port);
+    void accept_clients();
+    void add_connection(int socket, const std::string& address);
+    void read_from(Connection& connection);
+    void flush(Connection& connection);
+    void send_frame(Connection& connection, const Frame& frame, OutputQueue::Kind kind);
+    void send_reply(Connection& connection, const std::string& reply);
+    void send_reply(Connection& connection, const RequestTag& tag, const std::string& reply);
+    void close_connection(Connection& connection);
+    void drain_replies();
+    Connection* find_connection(uint64_t id);
+    int poll_timeout_ms() const;
+
+    // Protocol handling
+    void process_input(Connection& connection);
+    void process_handshake(Connection& connection);
+    void process_websocket(Connection& connection);
+    void fail_websocket(Connection& connection);   // Closes with 1002, protocol error
+    bool admit_command(Connection& connection, const std::string& command);
+    void handle_command(Connection& connection, const std::string& command);
+    bool parse_operation(const std::vector<std::string>& tokens, Operation& operation, std::string& error) const;
+    bool parse_bus_operation(const std::vector<std::string>& tokens, Operation& operation, std::string& error) const;
+    bool parse_pms_operation(const std::vector<std::string>& tokens, Operation& operation, std::string& error) const;
+    bool parse_profile_operation(const std::vector<std::string>& tokens, Operation& operation,
+                                 std::string& error) const;
+    void submit_batch(Connection& connection, const std::string& command, const RequestTag& tag);
+    void submit(Connection& connection, Command command);
+    std::string status_reply();
+    std::string bus_reply();
+    std::string pms_reply();
+    std::string spectrum_reply();
+    std::string profile_reply();
+    std::string configure_stream(Connection& connection, const std::vector<std::string>& args);
+    std::string configure_queue(Connection& connection, const std::vector<std::string>& args);
+    std::string configure_deadband(Connection& connection, const std::vector<std::string>& args);
+    std::string describe_clients() const;
+    std::string describe_limits(const Connection& connection) const;
+
+    // Status streaming
+    const StatusFrames& current_status_frames();
+    void stream_status();
+    void stream_delta(Connection& connection, const StatusFrames& frames);
+
+    static constexpr int BUFFER_SIZE = 1024;
+    static constexpr int LISTEN_BACKLOG = 16;
+    static constexpr double MAX_STREAM_RATE = 200.0;     // Frames per second per client
+    static constexpr int IDLE_POLL_TIMEOUT_MS = 100;
+    static constexpr int WAKELESS_POLL_TIMEOUT_MS = 5;  // Platforms without a wake pipe
+    static constexpr size_t MAX_QUEUE_FRAMES = 4096;
+    static constexpr size_t MAX_BATCH_OPERATIONS = 64;
+    static constexpr size_t MAX_INPUT_SIZE = 64 * 1024;  // Unprocessed bytes per connection
+    static constexpr double DEFAULT_POWER_FACTOR = 0.8;  // For bus demand given in kW only
+    static constexpr double MAX_FAST_FORWARD = 31536000.0;  // One simulated year
+};
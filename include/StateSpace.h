@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+template <size_t N>
+using Vector = std::array<double, N>;
+
+template <size_t Rows, size_t Columns>
+using Matrix = std::array<std::array<double, Columns>, Rows>;
+
+/**
+ * @brief Linear time-invariant block x' = A x + B u of fixed size
+ *
+ * N states and M inputs, sized at compile time and stored inline, so a
+ * block is a few hundred bytes with no heap and the loops below unroll.
+ * Inputs are held constant over a step (zero-order hold) and integrated
+ * with classic fourth-order Runge-Kutta; steps longer than max_step are
+ * split evenly so a slow or fast-forwarded tick stays stable. An observer
+ * passed to integrate() sees the state after every one of those steps.
+ * equilibrium() solves A x = -B u directly, for jumping over stretches
+ * where the input does not change.
+ */
+template <size_t N, size_t M>
+struct StateSpace {
+    Matrix<N, N> a{};
+    Matrix<N, M> b{};
+    Vector<N> x{};
+
+    Vector<N> derivative(const Vector<N>& state, const Vector<M>& input) const {
+        Vector<N> rate{};
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < N; ++j) {
+                rate[i] += a[i][j] * state[j];
+            }
+            for (size_t j = 0; j < M; ++j) {
+                rate[i] += b[i][j] * input[j];
+            }
+        }
+        return rate;
+    }
+
+    void integrate(const Vector<M>& input, double delta_time, double max_step) {
+        integrate(input, delta_time, max_step, [](double, const Vector<N>&) {});
+    }
+
+    // observe(elapsed, x) is called after each RK4 step
+    template <typename Observer>
+    void integrate(const Vector<M>& input, double delta_time, double max_step, Observer&& observe) {
+        if (!(delta_time > 0.0)) {
+            return;
+        }
+        int steps = static_cast<int>(std::ceil(delta_time / max_step));
+        double h = delta_time / steps;
+        for (int step = 0; step < steps; ++step) {
+            Vector<N> k1 = derivative(x, input);
+            Vector<N> k2 = derivative(offset(k1, h / 2.0), input);
+            Vector<N> k3 = derivative(offset(k2, h / 2.0), input);
+            Vector<N> k4 = derivative(offset(k3, h), input);
+            for (size_t i = 0; i < N; ++i) {
+                x[i] += h / 6.0 * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+            }
+            observe(h * (step + 1), x);
+        }
+    }
+
+    // Steady state for a constant input; A must be non-singular
+    Vector<N> equilibrium(const Vector<M>& input) const {
+        // Gaussian elimination with partial pivoting on [A | -B u]
+        Matrix<N, N> lhs = a;
+        Vector<N> rhs{};
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = 0; j < M; ++j) {
+                rhs[i] -= b[i][j] * input[j];
+            }
+        }
+        for (size_t column = 0; column < N; ++column) {
+            size_t pivot = column;
+            for (size_t row = column + 1; row < N; ++row) {
+                if (std::abs(lhs[row][column]) > std::abs(lhs[pivot][column])) {
+                    pivot = row;
+                }
+            }
+            std::swap(lhs[column], lhs[pivot]);
+            std::swap(rhs[column], rhs[pivot]);
+            for (size_t row = column + 1; row < N; ++row) {
+                double factor = lhs[row][column] / lhs[column][column];
+                for (size_t k = column; k < N; ++k) {
+                    lhs[row][k] -= factor * lhs[column][k];
+                }
+                rhs[row] -= factor * rhs[column];
+            }
+        }
+        Vector<N> state{};
+        for (size_t i = N; i-- > 0;) {
+            double sum = rhs[i];
+            for (size_t k = i + 1; k < N; ++k) {
+                sum -= lhs[i][k] * state[k];
+            }
+            state[i] = sum / lhs[i][i];
+        }
+        return state;
+    }
+
+    // Largest magnitude among the state derivatives, for a constant input
+    double rate(const Vector<M>& input) const {
+        Vector<N> rates = derivative(x, input);
+        double fastest = 0.0;
+        for (size_t i = 0; i < N; ++i) {
+            fastest = std::max(fastest, std::abs(rates[i]));
+        }
+        return fastest;
+    }
+
+    // True once every state is within tolerance of the equilibrium
+    bool settled(const Vector<M>& input, double tolerance) const {
+        Vector<N> target = equilibrium(input);
+        for (size_t i = 0; i < N; ++i) {
+            if (std::abs(x[i] - target[i]) > tolerance) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    Vector<N> offset(const Vector<N>& rate, double h) const {
+        Vector<N> state;
+        for (size_t i = 0; i < N; ++i) {
+            state[i] = x[i] + h * rate[i];
+        }
+        return state;
+    }
+};
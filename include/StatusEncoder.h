@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Generator.h"
+
+/**
+ * @brief Serializes generator status for replies and pushed streams
+ *
+ * JSON matches the `status` reply documented in PROTOCOL.md. The binary
+ * form is a compact little-endian frame intended for WebSocket consoles:
+ *
+ *   u8  frame_type    (1 = full status / keyframe, 2 = delta)
+ *   u8  state         (Generator::State)
+ *   u16 field_mask    (bit i set => field i present, see Field)
+ *   u16 alarm_mask    (bit i set => AlarmType i active)
+ *   u16 reserved
+ *   u32 sequence
+ *   f64 value         (one per bit set in field_mask, in Field order)
+ *
+ * Delta frames carry only the fields selected by a DeltaEncoder; the
+ * state and alarm mask are always present in binary frames.
+ */
+class StatusEncoder {
+public:
+    enum class Field : uint8_t {
+        RPM,
+        VOLTAGE,
+        FREQUENCY,
+        LOAD,
+        FUEL_LEVEL,
+        OIL_PRESSURE,
+        COOLING_TEMP,
+        COUNT
+    };
+
+    static constexpr uint8_t FRAME_FULL = 1;
+    static constexpr uint8_t FRAME_DELTA = 2;
+    static constexpr size_t BINARY_HEADER_SIZE = 12;
+    static constexpr uint16_t ALL_FIELDS = (1u << static_cast<int>(Field::COUNT)) - 1;
+
+    static std::string to_json(const Generator::GeneratorStatus& status);
+    static std::string to_binary(const Generator::GeneratorStatus& status, uint32_t sequence);
+
+    // Streamed keyframes and deltas; JSON carries the alarm list where
+    // binary carries the mask, so only when asked to
+    static std::string to_json_frame(const Generator::GeneratorStatus& status, uint8_t frame_type,
+                                     uint16_t field_mask, bool include_state, bool include_alarms,
+                                     uint32_t sequence);
+    static std::string to_binary_frame(const Generator::GeneratorStatus& status, uint8_t frame_type,
+                                       uint16_t field_mask, uint32_t sequence);
+
+    // Helpers shared by the encoders
+    static double field_value(const Generator::GeneratorStatus& status, Field field);
+    static const char* field_name(Field field);
+    static bool parse_field(const std::string& name, Field& field);
+    static uint16_t alarm_mask(const Generator::GeneratorStatus& status);
+};
+
+/**
+ * @brief Per-subscriber deadband filter for delta status streams
+ *
+ * Tracks the values last sent to one client and selects the fields that
+ * moved beyond their deadband since then. Comparing against the last
+ * sent value, not the previous tick, keeps slow drifts from being lost.
+ * A keyframe with every field is forced periodically so a client that
+ * missed frames can resynchronize.
+ */
+class DeltaEncoder {
+public:
+    DeltaEncoder();
+
+    // Configuration
+    void set_deadband(StatusEncoder::Field field, double deadband);
+    void set_keyframe_interval(uint32_t frames);
+    double deadband(StatusEncoder::Field field) const;
+    uint32_t keyframe_interval() const { return keyframe_interval_; }
+
+    // Choose what the frame for this stream slot carries; returns false
+    // if nothing needs sending
+    bool next_frame(const Generator::GeneratorStatus& status, uint8_t& frame_type,
+                    uint16_t& field_mask, bool& state_changed, bool& alarms_changed);
+
+    // Record the fields of a frame that was queued for the client
+    void commit(const Generator::GeneratorStatus& status, uint8_t frame_type, uint16_t field_mask);
+
+    // Force the next frame to be a keyframe
+    void reset();
+
+    static constexpr uint32_t DEFAULT_KEYFRAME_INTERVAL = 100;  // stream slots
+
+private:
+    double deadbands_[static_cast<int>(StatusEncoder::Field::COUNT)];
+    double last_sent_[static_cast<int>(StatusEncoder::Field::COUNT)];
+    Generator::State last_state_;
+    uint16_t last_alarm_mask_;
+    uint32_t keyframe_interval_;
+    uint32_t slots_since_keyframe_;
+    bool keyframe_pending_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Main switchboard: generator units sharing consumer load on common buses
+ *
+ * Each bus carries up to MAX_UNITS units. A solve distributes the bus's
+ * active (kW) and reactive (kvar) demand across the connected units and
+ * finds the common bus frequency and voltage:
+ *
+ *   - DROOP units follow their speed and voltage droop lines, so their
+ *     output rises as the bus sags below their no-load setpoints
+ *   - ISOCHRONOUS units hold nominal frequency and voltage and share
+ *     whatever the droop units leave, in proportion to their ratings
+ *
+ * Unit limits are respected. Once the isochronous units saturate, the
+ * bus moves off nominal along the droop lines; demand that no connected
+ * unit can carry is reported as unserved. The disturbance and shed load
+ * scale the demand, reactive power in the same proportion.
+ *
+ * Buses are stored by value with fixed-size unit arrays and solved in
+ * one pass over contiguous memory, so a solve never allocates and
+ * thousands of buses can be solved every tick.
+ */
+class Switchboard {
+public:
+    enum class Mode {
+        DROOP,
+        ISOCHRONOUS
+    };
+
+    static constexpr size_t MAX_UNITS = 12;
+
+    struct UnitConfig {
+        double rated_kw;
+        double rated_kvar;
+        Mode mode;
+        double speed_droop;       // Frequency drop from no load to full load, fraction of nominal
+        double voltage_droop;     // Voltage drop from zero to rated kvar, fraction of nominal
+        double speed_setpoint;    // No-load frequency, per unit of nominal
+        double voltage_setpoint;  // Zero-kvar voltage, per unit of nominal
+
+        UnitConfig();
+    };
+
+    struct Bus {
+        // Inputs
+        double nominal_frequency;
+        double nominal_voltage;
+        double demand_kw;
+        double demand_kvar;
+        double disturbance;              // Fraction of the demand added on top, see LoadDisturbance.h
+        double shed_kw;                  // Part of the demand disconnected by load shedding
+        size_t unit_count;
+        UnitConfig units[MAX_UNITS];
+        bool running[MAX_UNITS];         // Machine is up to speed and can take load
+        bool breaker_closed[MAX_UNITS];
+
+        // Outputs of the last solve
+        double frequency;                // 0 on a dead bus
+        double voltage;
+        double unit_kw[MAX_UNITS];
+        double unit_kvar[MAX_UNITS];
+        double unserved_kw;              // Demand beyond the connected units, negative for reverse power
+
+        bool connected(size_t unit) const { return running[unit] && breaker_closed[unit]; }
+        double load_kw() const { return demand_kw * (1.0 + disturbance); }   // Demand with its disturbance
+    };
+
+    // Setup; not meant to be called while solving
+    size_t add_bus(double nominal_frequency, double nominal_voltage);
+    bool add_unit(size_t bus, const UnitConfig& config);
+    static bool configure_unit(Bus& bus, size_t unit, Mode mode, double speed_droop);
+    static bool rate_unit(Bus& bus, size_t unit, double rated_kw, double rated_kvar);
+
+    Bus& bus(size_t index) { return buses_[index]; }
+    const Bus& bus(size_t index) const { return buses_[index]; }
+    size_t bus_count() const { return buses_.size(); }
+
+    // Solves every bus, or just one
+    void solve();
+    static void solve(Bus& bus);
+
+    static const char* mode_name(Mode mode);
+    static bool parse_mode(const std::string& name, Mode& mode);
+
+    static constexpr double MIN_DROOP = 0.001;
+    static constexpr double MAX_DROOP = 0.2;
+    static constexpr int MAX_SOLVER_ITERATIONS = 32;
+
+private:
+    // One quantity (active or reactive power) for the connected units
+    struct Lines {
+        size_t count;
+        double gain[MAX_UNITS];      // Output per unit of bus deviation
+        double setpoint[MAX_UNITS];  // Bus value at zero output
+        double low[MAX_UNITS];
+        double high[MAX_UNITS];
+        bool isochronous[MAX_UNITS];
+    };
+
+    std::vector<Bus> buses_;
+
+    static double share(const Lines& lines, double demand, double guess, double* output, double& unserved);
+};
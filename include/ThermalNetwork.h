@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Heat capacities, heat flows and cooling of one engine
+ */
+struct ThermalSpec {
+    double jacket_capacity;       // kJ/K, block and jacket water
+    double oil_capacity;          // kJ/K, lube oil and sump
+    double exhaust_capacity;      // kJ/K, manifold and turbocharger
+    double jacket_heat;           // kW into each node at rated load
+    double oil_heat;
+    double exhaust_heat;
+    double idle_heat;             // Fraction of rated heat while turning with no load
+    double oil_conductance;       // kW/K, oil cooler into the jacket water
+    double cooler_conductance;    // kW/K, jacket water to sea water with the thermostat fully open
+    double ambient_conductance;   // kW/K, jacket to the engine room
+    double exhaust_conductance;   // kW/K, carried off by the gas flow
+    double sea_temp;              // Celsius
+    double thermostat_open;       // Celsius, where the valve starts to open
+    double thermostat_full;       // Celsius, fully open
+};
+
+// A ThermalSpec divided through by the heat capacities, and the jacket
+// temperature whose crossing integrate() reports
+struct ThermalCoefficients {
+    double jacket_rate;      // K/s at rated heat
+    double oil_rate;
+    double exhaust_rate;
+    double oil_to_jacket;    // 1/s
+    double jacket_to_oil;
+    double cooling;          // Jacket to sea, valve fully open
+    double ambient_loss;
+    double exhaust_loss;
+    double sea_temp;
+    double thermostat_open;
+    double thermostat_scale; // 1 / opening band
+    double alarm_temp;
+
+    static ThermalCoefficients from(const ThermalSpec& spec, double alarm_temp);
+};
+
+/**
+ * @brief Lumped thermal network of jacket water, lube oil and exhaust,
+ * for many engines at once
+ *
+ * Three nodes per engine, with heat from combustion in proportion to the
+ * heat fraction (idle heat plus load, 0 when stopped):
+ *
+ *   jacket'  = jacket_rate * heat + oil_to_jacket * (oil - jacket)
+ *              - valve(jacket) * cooling * (jacket - sea) - ambient_loss * (jacket - ambient)
+ *   oil'     = oil_rate * heat - jacket_to_oil * (oil - jacket)
+ *   exhaust' = exhaust_rate * heat - exhaust_loss * (exhaust - ambient)
+ *
+ * where the thermostat valve opens linearly between its open and full
+ * temperatures. A cold engine warms up with the valve shut, then the
+ * jacket water holds in the band while the cooler takes the heat; when
+ * stopped it cools slowly through the engine room.
+ *
+ * Coefficients are stored per column across engines, and integrate()
+ * takes every engine through the same number of RK4 steps, each of its
+ * own length, with one pass over each column per stage, which the
+ * compiler vectorizes. A single engine goes
+ * through the same arithmetic with one-element columns. Integration
+ * stops early once no temperature still moves, so long fast-forward
+ * steps cost little once the network has settled.
+ */
+class ThermalNetwork {
+public:
+    struct State {
+        double jacket;    // Celsius
+        double oil;
+        double exhaust;
+    };
+
+    // Returns the engine's index
+    size_t add(const ThermalCoefficients& coefficients);
+    void set(size_t engine, const ThermalCoefficients& coefficients);
+    size_t size() const { return jacket_rate_.size(); }
+
+    // Advances each engine over its own delta_time, 0 to leave it as it
+    // is, holding heat and ambient; crossing is set to the seconds into
+    // the step at which the jacket first rose above the alarm temperature,
+    // 0 if it already was and negative if it did not
+    void integrate(const double* delta_time, const double* heat, const double* ambient, double* jacket, double* oil,
+                   double* exhaust, double* crossing) const;
+
+    // One engine, with the same arithmetic
+    static void integrate(const ThermalCoefficients& coefficients, double delta_time, double heat, double ambient,
+                          State& state, double& crossing);
+
+    static constexpr double MAX_STEP = 5.0;              // Longest RK4 step, seconds
+    static constexpr double SETTLED_RATE = 1e-5;         // K/s below which a node has stopped moving
+    static constexpr int SETTLE_CHECK_STEPS = 16;        // RK4 steps between settle checks
+
+private:
+    struct Columns {
+        const double* jacket_rate;
+        const double* oil_rate;
+        const double* exhaust_rate;
+        const double* oil_to_jacket;
+        const double* jacket_to_oil;
+        const double* cooling;
+        const double* ambient_loss;
+        const double* exhaust_loss;
+        const double* sea_temp;
+        const double* thermostat_open;
+        const double* thermostat_scale;
+        const double* alarm_temp;
+    };
+
+    static void integrate(const Columns& columns, size_t count, const double* delta_time, const double* heat,
+                          const double* ambient, double* jacket, double* oil, double* exhaust, double* crossing);
+
+    std::vector<double> jacket_rate_;
+    std::vector<double> oil_rate_;
+    std::vector<double> exhaust_rate_;
+    std::vector<double> oil_to_jacket_;
+    std::vector<double> jacket_to_oil_;
+    std::vector<double> cooling_;
+    std::vector<double> ambient_loss_;
+    std::vector<double> exhaust_loss_;
+    std::vector<double> sea_temp_;
+    std::vector<double> thermostat_open_;
+    std::vector<double> thermostat_scale_;
+    std::vector<double> alarm_temp_;
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+/**
+ * @brief Amplitude spectrum and band values of one frame of vibration
+ *
+ * The frame is FRAME samples of velocity, mm/s, under a Hann window.
+ * amplitude[k] is the RMS of a tone centred on bin k, at k * resolution()
+ * Hz. Band RMS values come from the power of their bins, so they add up
+ * like the signal's own mean square; bands other than OVERALL are in
+ * orders of the shaft speed, so they follow the engine as it slows down
+ * under load.
+ */
+struct VibrationSpectrum {
+    enum Band {
+        OVERALL,   // Everything above DC, the reading the alarm sees
+        ONE_X,     // 0.5 to 1.5 orders: unbalance
+        TWO_X,     // 1.5 to 2.5 orders: misalignment and looseness
+        BEARING,   // 2.5 orders up: rolling-element bearing defects
+        BAND_COUNT
+    };
+
+    struct BandValues {
+        double rms;              // mm/s
+        double peak;             // mm/s RMS of the strongest bin
+        double peak_frequency;   // Hz
+    };
+
+    static constexpr size_t FRAME = 256;          // Samples per frame
+    static constexpr size_t HOP = FRAME / 2;      // New samples between frames
+    static constexpr size_t BINS = FRAME / 2 + 1;
+
+    double sample_rate;      // Hz
+    double shaft_speed;      // Hz, when the frame ended
+    double amplitude[BINS];
+    BandValues bands[BAND_COUNT];
+
+    double resolution() const { return sample_rate / FRAME; }
+    static const char* band_name(Band band);
+
+    // Windows and transforms count frames of FRAME samples each, oldest
+    // first and one after the other, into as many spectra. Frames are
+    // taken BLOCK at a time and laid out sample by frame, so every
+    // butterfly of the radix-2 FFT is one pass across the frames of a
+    // block with its twiddle factor loaded once, which the compiler
+    // vectorizes; a block's working set stays in L1
+    static void analyze(size_t count, const double* frames, const double* sample_rate, const double* shaft_speed,
+                        VibrationSpectrum* spectra);
+
+    static constexpr size_t BLOCK = 8;   // Frames transformed together
+};
+
+// What one engine's vibration is made of at the moment
+struct VibrationSource {
+    double level;          // mm/s RMS of the running-speed orders together
+    double second_order;   // 2x amplitude relative to 1x
+    double outer_race;     // mm/s RMS at the outer race defect frequency
+    double inner_race;     // mm/s RMS at the inner race defect frequency, modulated by 1x
+    double bpfo;           // Defect frequencies, in orders
+    double bpfi;
+    double noise;          // mm/s RMS of broadband noise
+};
+
+/**
+ * @brief Synthesized velocity waveform of one engine and its latest frame
+ *
+ * Each component is a phasor turned on by one rotation per sample, which
+ * is worked out from the shaft speed once per call, so the orders track
+ * the speed without a sine per sample. The samples go into a ring of one
+ * frame; frame_due() once HOP new ones have come in since the last frame.
+ */
+class VibrationWaveform {
+public:
+    VibrationWaveform() : samples_(), next_(0), fresh_(0) { reset(); }
+
+    void reset() {
+        for (auto& phasor : phasors_) {
+            phasor[0] = 1.0;
+            phasor[1] = 0.0;
+        }
+    }
+
+    // Appends count samples at sample_rate with the shaft turning at
+    // shaft_speed Hz; noise() draws from a unit normal distribution
+    template <typename Noise>
+    void synthesize(int count, double sample_rate, double shaft_speed, const VibrationSource& source, Noise&& noise) {
+        if (count == 0) {
+            return;
+        }
+        constexpr double PI = 3.14159265358979323846;
+        const double turn = 2.0 * PI * shaft_speed / sample_rate;
+        const double orders[COMPONENTS] = {1.0, source.bpfo, source.bpfi};
+        double rotation[COMPONENTS][2];
+        for (size_t c = 0; c < COMPONENTS; ++c) {
+            rotation[c][0] = std::cos(orders[c] * turn);
+            rotation[c][1] = std::sin(orders[c] * turn);
+        }
+
+        // Peak amplitudes; 1x and 2x share the level, and the modulated
+        // inner race tone is scaled back to its RMS
+        const double root2 = std::sqrt(2.0);
+        const double norm = root2 * source.level / std::sqrt(1.0 + source.second_order * source.second_order);
+        const double one_x = norm;
+        const double two_x = norm * source.second_order;
+        const double outer = root2 * source.outer_race;
+        const double inner = root2 * source.inner_race / std::sqrt(1.5);
+
+        for (int n = 0; n < count; ++n) {
+            for (size_t c = 0; c < COMPONENTS; ++c) {
+                double re = phasors_[c][0] * rotation[c][0] - phasors_[c][1] * rotation[c][1];
+                double im = phasors_[c][0] * rotation[c][1] + phasors_[c][1] * rotation[c][0];
+                phasors_[c][0] = re;
+                phasors_[c][1] = im;
+            }
+            const double* shaft = phasors_[0];
+            // The 2x a quarter turn behind, -cos(2 phi) = sin(phi)^2 - cos(phi)^2
+            double sample = one_x * shaft[1] - two_x * (shaft[0] * shaft[0] - shaft[1] * shaft[1]) +
+                            outer * phasors_[1][1] + inner * (1.0 + shaft[0]) * phasors_[2][1] +
+                            source.noise * noise();
+            samples_[next_] = sample;
+            next_ = (next_ + 1) % VibrationSpectrum::FRAME;
+        }
+        fresh_ += count;
+
+        // Keep the phasors on the unit circle against rounding
+        for (auto& phasor : phasors_) {
+            double scale = 1.0 / std::sqrt(phasor[0] * phasor[0] + phasor[1] * phasor[1]);
+            phasor[0] *= scale;
+            phasor[1] *= scale;
+        }
+    }
+
+    bool frame_due() const { return fresh_ >= VibrationSpectrum::HOP; }
+
+    // The latest FRAME samples, oldest first
+    void frame(double* out) const {
+        for (size_t n = 0; n < VibrationSpectrum::FRAME; ++n) {
+            out[n] = samples_[(next_ + n) % VibrationSpectrum::FRAME];
+        }
+    }
+    void clear_due() { fresh_ = 0; }
+
+private:
+    static constexpr size_t COMPONENTS = 3;   // Shaft, outer race, inner race
+
+    double samples_[VibrationSpectrum::FRAME];
+    size_t next_;
+    size_t fresh_;   // Samples since the last frame
+    double phasors_[COMPONENTS][2];
+};
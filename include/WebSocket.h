@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Minimal RFC 6455 WebSocket support for the generator server
+ *
+ * Covers the opening handshake and the frame encoding/decoding needed to
+ * serve browser consoles directly on the engine port. Extensions and
+ * subprotocols are not negotiated.
+ */
+class WebSocket {
+public:
+    enum class Opcode : uint8_t {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xA
+    };
+
+    enum class DecodeResult {
+        COMPLETE,
+        INCOMPLETE,
+        INVALID
+    };
+
+    struct Frame {
+        Opcode opcode;
+        bool final;
+        std::string payload;
+    };
+
+    // Opening handshake
+    static bool is_upgrade_request(const std::string& request);
+    static std::string handshake_response(const std::string& request);
+
+    // Framing (server side: outgoing frames are never masked)
+    static std::string encode_frame(Opcode opcode, const std::string& payload);
+    static DecodeResult decode_frame(const std::string& buffer, size_t& consumed, Frame& frame);
+
+    // Limits
+    static constexpr size_t MAX_HANDSHAKE_SIZE = 8192;     // bytes
+    static constexpr size_t MAX_PAYLOAD_SIZE = 65536;      // bytes per message
+    static constexpr size_t MAX_CONTROL_PAYLOAD = 125;     // bytes per control frame
+
+private:
+    static std::string header_value(const std::string& request, const std::string& name);
+    static std::string accept_key(const std::string& client_key);
+    static std::string sha1(const std::string& data);
+    static std::string base64_encode(const std::string& data);
+};
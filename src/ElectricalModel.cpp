@@ -0,0 +1,199 @@
+#include "ElectricalModel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Guards a division of a non-negative value by offsetting it rather than
+// selecting, which the compiler would turn back into a conditional
+// division and so a branch that stops vectorization
+static inline double nonzero(double value) {
+    return value + std::numeric_limits<double>::min();
+}
+
+ElectricalCoefficients ElectricalCoefficients::from(const ElectricalSpec& spec, double rated_power,
+                                                    double rated_voltage) {
+    ElectricalCoefficients coefficients;
+    double total = spec.phase_a_load + spec.phase_b_load + spec.phase_c_load;
+    coefficients.share[0] = spec.phase_a_load / total;
+    coefficients.share[1] = spec.phase_b_load / total;
+    coefficients.share[2] = spec.phase_c_load / total;
+    coefficients.reactive_ratio = std::sqrt(1.0 - spec.power_factor * spec.power_factor) / spec.power_factor;
+
+    // Rated impedance on the rated power as the base
+    double base = rated_voltage * rated_voltage / (rated_power * 1000.0);
+    coefficients.resistance = spec.source_resistance * base;
+    coefficients.reactance = spec.source_reactance * base;
+    coefficients.rated_power = rated_power * 1000.0;
+    return coefficients;
+}
+
+size_t ElectricalModel::add(const ElectricalCoefficients& coefficients) {
+    for (auto* column : {&share_[0], &share_[1], &share_[2], &reactive_ratio_, &resistance_, &reactance_,
+                         &rated_power_, &line_voltage_[0], &line_voltage_[1], &line_voltage_[2], &current_[0],
+                         &current_[1], &current_[2], &active_power_, &reactive_power_, &apparent_power_,
+                         &power_factor_}) {
+        column->push_back(0.0);
+    }
+    power_factor_.back() = 1.0;
+    set(size() - 1, coefficients);
+    return size() - 1;
+}
+
+void ElectricalModel::set(size_t unit, const ElectricalCoefficients& coefficients) {
+    for (size_t k = 0; k < 3; ++k) {
+        share_[k][unit] = coefficients.share[k];
+    }
+    reactive_ratio_[unit] = coefficients.reactive_ratio;
+    resistance_[unit] = coefficients.resistance;
+    reactance_[unit] = coefficients.reactance;
+    rated_power_[unit] = coefficients.rated_power;
+}
+
+void ElectricalModel::solve(const double* voltage, const double* load) {
+    Columns columns = {{share_[0].data(), share_[1].data(), share_[2].data()}, reactive_ratio_.data(),
+                       resistance_.data(), reactance_.data(), rated_power_.data()};
+    Results results = {{line_voltage_[0].data(), line_voltage_[1].data(), line_voltage_[2].data()},
+                       {current_[0].data(), current_[1].data(), current_[2].data()},
+                       active_power_.data(), reactive_power_.data(), apparent_power_.data(), power_factor_.data()};
+    solve(columns, size(), voltage, load, results);
+}
+
+ElectricalReadings ElectricalModel::readings(size_t unit) const {
+    ElectricalReadings readings;
+    for (size_t k = 0; k < 3; ++k) {
+        readings.line_voltage[k] = line_voltage_[k][unit];
+        readings.current[k] = current_[k][unit];
+    }
+    readings.active_power = active_power_[unit];
+    readings.reactive_power = reactive_power_[unit];
+    readings.apparent_power = apparent_power_[unit];
+    readings.power_factor = power_factor_[unit];
+    return readings;
+}
+
+ElectricalReadings ElectricalModel::solve(const ElectricalCoefficients& coefficients, double voltage, double load) {
+    const ElectricalCoefficients& c = coefficients;
+    ElectricalReadings readings;
+    Columns columns = {{&c.share[0], &c.share[1], &c.share[2]}, &c.reactive_ratio, &c.resistance, &c.reactance,
+                       &c.rated_power};
+    Results results = {{&readings.line_voltage[0], &readings.line_voltage[1], &readings.line_voltage[2]},
+                       {&readings.current[0], &readings.current[1], &readings.current[2]},
+                       &readings.active_power, &readings.reactive_power, &readings.apparent_power,
+                       &readings.power_factor};
+    solve(columns, 1, &voltage, &load, results);
+    return readings;
+}
+
+void ElectricalModel::solve(const Columns& c, size_t count, const double* voltage, const double* load,
+                            const Results& results) {
+    // Generators a block at a time into local arrays, which cannot alias
+    // the columns; storing straight into ten result columns would take
+    // more run-time alias checks than the compiler is willing to make
+    constexpr size_t BLOCK = 64;
+
+    // Unit EMF of each phase, and the operator a = 1 at 120 degrees
+    const double half = 0.5;
+    const double root = std::sqrt(3.0) / 2.0;
+    const double e_re[3] = {1.0, -half, -half};
+    const double e_im[3] = {0.0, -root, root};
+
+    for (size_t first = 0; first < count; first += BLOCK) {
+        const size_t n = std::min(BLOCK, count - first);
+        double line_voltage[3][BLOCK];
+        double current[3][BLOCK];
+        double active_power[BLOCK];
+        double reactive_power[BLOCK];
+        double apparent_power[BLOCK];
+        double power_factor[BLOCK];
+
+        for (size_t s = 0; s < n; ++s) {
+            const size_t i = first + s;
+            double p = c.rated_power[i] * load[i] / 100.0;
+            double q = p * c.reactive_ratio[i];
+            // The load draws its power at the regulated phase voltage; the
+            // floor only keeps a dead machine from dividing by zero
+            double phase_voltage2 = voltage[i] * voltage[i] / 3.0;
+            phase_voltage2 = phase_voltage2 > 1.0 ? phase_voltage2 : 1.0;
+            double r = c.resistance[i];
+            double x = c.reactance[i];
+
+            // Load admittance behind the source impedance, Y' = Y / (1 + Z Y)
+            double y_re[3];
+            double y_im[3];
+            double sum_re = 0.0;
+            double sum_im = 0.0;
+            double sum_e_re = 0.0;
+            double sum_e_im = 0.0;
+            for (size_t k = 0; k < 3; ++k) {
+                double g = c.share[k][i] * p / phase_voltage2;
+                double b = -c.share[k][i] * q / phase_voltage2;
+                double d_re = 1.0 + r * g - x * b;
+                double d_im = x * g + r * b;
+                double inv = 1.0 / (d_re * d_re + d_im * d_im);
+                y_re[k] = (g * d_re + b * d_im) * inv;
+                y_im[k] = (b * d_re - g * d_im) * inv;
+                sum_re += y_re[k];
+                sum_im += y_im[k];
+                sum_e_re += y_re[k] * e_re[k] - y_im[k] * e_im[k];
+                sum_e_im += y_re[k] * e_im[k] + y_im[k] * e_re[k];
+            }
+
+            // Neutral shift; with no load both sums are 0 and so is the shift
+            double inv_sum = 1.0 / nonzero(sum_re * sum_re + sum_im * sum_im);
+            double n_re = (sum_e_re * sum_re + sum_e_im * sum_im) * inv_sum;
+            double n_im = (sum_e_im * sum_re - sum_e_re * sum_im) * inv_sum;
+
+            // Line currents, terminal phase voltages and power out
+            double i_re[3];
+            double i_im[3];
+            double u_re[3];
+            double u_im[3];
+            double s_re = 0.0;
+            double s_im = 0.0;
+            for (size_t k = 0; k < 3; ++k) {
+                double v_re = e_re[k] - n_re;
+                double v_im = e_im[k] - n_im;
+                i_re[k] = y_re[k] * v_re - y_im[k] * v_im;
+                i_im[k] = y_re[k] * v_im + y_im[k] * v_re;
+                u_re[k] = e_re[k] - (r * i_re[k] - x * i_im[k]);
+                u_im[k] = e_im[k] - (r * i_im[k] + x * i_re[k]);
+                s_re += u_re[k] * i_re[k] + u_im[k] * i_im[k];
+                s_im += u_im[k] * i_re[k] - u_re[k] * i_im[k];
+            }
+
+            // Line voltages and their positive sequence, (ab + a bc + a^2 ca) / 3
+            double l_re[3];
+            double l_im[3];
+            for (size_t k = 0; k < 3; ++k) {
+                size_t next = (k + 1) % 3;
+                l_re[k] = u_re[k] - u_re[next];
+                l_im[k] = u_im[k] - u_im[next];
+            }
+            double p1_re = (l_re[0] - half * (l_re[1] + l_re[2]) - root * (l_im[1] - l_im[2])) / 3.0;
+            double p1_im = (l_im[0] - half * (l_im[1] + l_im[2]) + root * (l_re[1] - l_re[2])) / 3.0;
+            double scale = voltage[i] / nonzero(std::sqrt(p1_re * p1_re + p1_im * p1_im));
+
+            for (size_t k = 0; k < 3; ++k) {
+                line_voltage[k][s] = scale * std::sqrt(l_re[k] * l_re[k] + l_im[k] * l_im[k]);
+                current[k][s] = scale * std::sqrt(i_re[k] * i_re[k] + i_im[k] * i_im[k]);
+            }
+            double active = scale * scale * s_re / 1000.0;
+            double reactive = scale * scale * s_im / 1000.0;
+            double apparent = std::sqrt(active * active + reactive * reactive);
+            active_power[s] = active;
+            reactive_power[s] = reactive;
+            apparent_power[s] = apparent;
+            // 1 with no load, when both are 0
+            power_factor[s] = nonzero(active) / nonzero(apparent);
+        }
+
+        for (size_t k = 0; k < 3; ++k) {
+            std::copy(line_voltage[k], line_voltage[k] + n, results.line_voltage[k] + first);
+            std::copy(current[k], current[k] + n, results.current[k] + first);
+        }
+        std::copy(active_power, active_power + n, results.active_power + first);
+        std::copy(reactive_power, reactive_power + n, results.reactive_power + first);
+        std::copy(apparent_power, apparent_power + n, results.apparent_power + first);
+        std::copy(power_factor, power_factor + n, results.power_factor + first);
+    }
+}
@@ -0,0 +1,20 @@
+#include "EngineModels.h"
+
+const char* engine_type_name(EngineType type) {
+    switch (type) {
+        case EngineType::DIESEL: return "diesel";
+        case EngineType::GAS: return "gas";
+        case EngineType::DUAL_FUEL: return "dual-fuel";
+    }
+    return "unknown";
+}
+
+bool parse_engine_type(const std::string& name, EngineType& type) {
+    for (size_t i = 0; i < ENGINE_TYPE_COUNT; ++i) {
+        if (name == engine_type_name(static_cast<EngineType>(i))) {
+            type = static_cast<EngineType>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,190 @@
+#include "Fleet.h"
+#include <algorithm>
+#include <limits>
+
+template <typename Model>
+class Fleet::ModelGroup : public Fleet::Group {
+public:
+    size_t add(const GeneratorSpec& spec, size_t unit) override {
+        units_.emplace_back(spec);
+        disturbance_.add(spec.disturbance, unit);
+        sfoc_table_.add(spec.sensors.sfoc);
+        thermal_.add(units_.back().thermal_coefficients());
+        electrical_.add(units_.back().electrical_coefficients());
+        for (auto* scratch : {&intervals_, &loads_, &sfoc_, &heat_, &ambient_, &jacket_, &oil_, &exhaust_, &crossing_,
+                              &voltages_, &sample_rates_, &shaft_speeds_, &disturbances_}) {
+            scratch->push_back(0.0);
+        }
+        frames_.resize(units_.size() * VibrationSpectrum::FRAME);
+        frame_units_.push_back(0);
+        spectra_.emplace_back();
+        return units_.size() - 1;
+    }
+
+    void update(double delta_time) override {
+        // Load disturbances of the whole group in one vectorized pass
+        disturbance_.advance(delta_time, disturbances_.data());
+
+        // Fuel curves and thermal networks of the whole group in vectorized
+        // passes, on the updates where a unit's slow step falls due
+        bool due = false;
+        for (size_t i = 0; i < units_.size(); ++i) {
+            units_[i].set_disturbance(disturbances_[i]);
+            intervals_[i] = units_[i].advance_slow_clock(delta_time);
+            due = due || intervals_[i] > 0.0;
+        }
+        if (due) {
+            for (size_t i = 0; i < units_.size(); ++i) {
+                const auto& clock = units_[i].slow_clock();
+                const auto& thermal = units_[i].thermal_state();
+                loads_[i] = clock.mean_load();
+                heat_[i] = clock.mean_heat();
+                ambient_[i] = units_[i].ambient_temp();
+                jacket_[i] = thermal.jacket;
+                oil_[i] = thermal.oil;
+                exhaust_[i] = thermal.exhaust;
+            }
+            sfoc_table_.evaluate(loads_.data(), sfoc_.data());
+            thermal_.integrate(intervals_.data(), heat_.data(), ambient_.data(), jacket_.data(), oil_.data(),
+                               exhaust_.data(), crossing_.data());
+        }
+        for (size_t i = 0; i < units_.size(); ++i) {
+            units_[i].update(delta_time, sfoc_[i], {jacket_[i], oil_[i], exhaust_[i]}, crossing_[i]);
+        }
+
+        // Three-phase solve of the whole group at the end of the step
+        for (size_t i = 0; i < units_.size(); ++i) {
+            loads_[i] = units_[i].get_load();
+            voltages_[i] = units_[i].get_voltage();
+        }
+        electrical_.solve(voltages_.data(), loads_.data());
+        for (size_t i = 0; i < units_.size(); ++i) {
+            units_[i].set_electrical(electrical_.readings(i));
+        }
+
+        // Vibration frames due anywhere in the group, transformed together
+        size_t frames = 0;
+        for (size_t i = 0; i < units_.size(); ++i) {
+            if (units_[i].vibration_frame_due()) {
+                units_[i].vibration_frame(&frames_[frames * VibrationSpectrum::FRAME]);
+                frame_units_[frames] = i;
+                sample_rates_[frames] = units_[i].vibration_sample_rate();
+                shaft_speeds_[frames] = units_[i].shaft_speed();
+                ++frames;
+            }
+        }
+        if (frames > 0) {
+            VibrationSpectrum::analyze(frames, frames_.data(), sample_rates_.data(), shaft_speeds_.data(),
+                                       spectra_.data());
+            for (size_t k = 0; k < frames; ++k) {
+                units_[frame_units_[k]].set_vibration_spectrum(spectra_[k]);
+            }
+        }
+    }
+
+    double time_to_next_event() const override {
+        double time = disturbance_.max_step();
+        for (const auto& unit : units_) {
+            time = std::min(time, unit.time_to_next_event());
+        }
+        return time;
+    }
+
+    bool start(size_t index) override { return units_[index].start(); }
+    bool stop(size_t index) override { return units_[index].stop(); }
+    bool emergency_stop(size_t index) override { return units_[index].emergency_stop(); }
+    bool set_load(size_t index, double percentage) override { return units_[index].set_load(percentage); }
+    bool follow_share(size_t index, double percentage) override { return units_[index].follow_share(percentage); }
+    void set_parameters(size_t index, double max_rpm, double max_voltage, double max_frequency) override {
+        units_[index].set_parameters(max_rpm, max_voltage, max_frequency);
+        refresh(index);
+    }
+    void set_spec(size_t index, const GeneratorSpec& spec) override {
+        units_[index].set_spec(spec);
+        refresh(index);
+    }
+    const GeneratorSpec& spec(size_t index) const override { return units_[index].spec(); }
+    void acknowledge_alarm(size_t index, AlarmType type) override { units_[index].acknowledge_alarm(type); }
+    void reset_alarms(size_t index) override { units_[index].reset_alarms(); }
+
+    GeneratorStatus get_status(size_t index) const override { return units_[index].get_status(); }
+    State get_state(size_t index) const override { return units_[index].get_state(); }
+    double get_target_load(size_t index) const override { return units_[index].get_target_load(); }
+    double get_ramp_load(size_t index) const override { return units_[index].get_ramp_load(); }
+    const VibrationSpectrum& vibration_spectrum(size_t index) const override {
+        return units_[index].vibration_spectrum();
+    }
+
+    std::string save_state(size_t index) const override { return units_[index].save_state(); }
+    bool restore_state(size_t index, const std::string& state) override {
+        bool restored = units_[index].restore_state(state);
+        refresh(index);
+        return restored;
+    }
+
+private:
+    // Picks up a unit's spec after anything that may have replaced it
+    void refresh(size_t index) {
+        sfoc_table_.set(index, units_[index].spec().sensors.sfoc);
+        thermal_.set(index, units_[index].thermal_coefficients());
+        electrical_.set(index, units_[index].electrical_coefficients());
+        disturbance_.set(index, units_[index].spec().disturbance);
+    }
+
+    std::vector<BasicGenerator<Model>> units_;
+    SfocTable sfoc_table_;
+    std::vector<double> intervals_;   // Scratch for update()
+    std::vector<double> loads_;
+    std::vector<double> sfoc_;
+    ThermalNetwork thermal_;
+    std::vector<double> heat_;
+    std::vector<double> ambient_;
+    std::vector<double> jacket_;
+    std::vector<double> oil_;
+    std::vector<double> exhaust_;
+    std::vector<double> crossing_;
+    ElectricalModel electrical_;
+    std::vector<double> voltages_;
+    std::vector<double> frames_;         // One frame after the other, for the units with one due
+    std::vector<size_t> frame_units_;
+    std::vector<double> sample_rates_;
+    std::vector<double> shaft_speeds_;
+    std::vector<VibrationSpectrum> spectra_;
+    LoadDisturbance disturbance_;
+    std::vector<double> disturbances_;   // %
+};
+
+Fleet::Fleet() = default;
+Fleet::~Fleet() = default;
+
+size_t Fleet::add(const GeneratorSpec& spec) {
+    EngineType type = spec.engine;
+    auto& slot = groups_[static_cast<size_t>(type)];
+    if (!slot) {
+        switch (type) {
+            case EngineType::DIESEL: slot = std::make_unique<ModelGroup<DieselEngine>>(); break;
+            case EngineType::GAS: slot = std::make_unique<ModelGroup<GasEngine>>(); break;
+            case EngineType::DUAL_FUEL: slot = std::make_unique<ModelGroup<DualFuelEngine>>(); break;
+        }
+    }
+    units_.push_back({type, slot->add(spec, units_.size())});
+    return units_.size() - 1;
+}
+
+void Fleet::update(double delta_time) {
+    for (auto& group : groups_) {
+        if (group) {
+            group->update(delta_time);
+        }
+    }
+}
+
+double Fleet::time_to_next_event() const {
+    double time = std::numeric_limits<double>::infinity();
+    for (const auto& group : groups_) {
+        if (group) {
+            time = std::min(time, group->time_to_next_event());
+        }
+    }
+    return time;
+}
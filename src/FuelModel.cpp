@@ -0,0 +1,48 @@
+#include "FuelModel.h"
+#include <algorithm>
+
+size_t SfocTable::add(const SfocCurve& curve) {
+    base_.push_back(0.0);
+    for (size_t k = 0; k < SEGMENTS; ++k) {
+        start_[k].push_back(0.0);
+        scale_[k].push_back(0.0);
+        rise_[k].push_back(0.0);
+    }
+    set(base_.size() - 1, curve);
+    return base_.size() - 1;
+}
+
+void SfocTable::set(size_t unit, const SfocCurve& curve) {
+    segments_ = std::max(segments_, curve.points - 1);
+    base_[unit] = curve.sfoc[0];
+    for (size_t k = 0; k < SEGMENTS; ++k) {
+        if (k + 1 < curve.points) {
+            start_[k][unit] = curve.load[k];
+            scale_[k][unit] = 1.0 / (curve.load[k + 1] - curve.load[k]);
+            rise_[k][unit] = curve.sfoc[k + 1] - curve.sfoc[k];
+        } else {
+            start_[k][unit] = 0.0;
+            scale_[k][unit] = 0.0;
+            rise_[k][unit] = 0.0;
+        }
+    }
+}
+
+void SfocTable::evaluate(const double* load, double* sfoc) const {
+    // Block by block, so a block's loads and results stay in L1 across
+    // the segment passes
+    const size_t count = base_.size();
+    std::copy(base_.begin(), base_.end(), sfoc);
+    for (size_t first = 0; first < count; first += BLOCK) {
+        const size_t last = std::min(first + BLOCK, count);
+        for (size_t k = 0; k < segments_; ++k) {
+            const double* start = start_[k].data();
+            const double* scale = scale_[k].data();
+            const double* rise = rise_[k].data();
+            for (size_t i = first; i < last; ++i) {
+                double t = (load[i] - start[i]) * scale[i];
+                sfoc[i] += std::min(std::max(t, 0.0), 1.0) * rise[i];
+            }
+        }
+    }
+}
@@ -1,9 +1,25 @@
 #include "Generator.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <iostream>
+#include <limits>
+#include <sstream>
 
-Generator::Generator()
+const char* alarm_type_name(GeneratorTypes::AlarmType type) {
+    switch (type) {
+        case GeneratorTypes::AlarmType::OVERLOAD: return "overload";
+        case GeneratorTypes::AlarmType::HIGH_TEMPERATURE: return "high_temperature";
+        case GeneratorTypes::AlarmType::LOW_OIL_PRESSURE: return "low_oil_pressure";
+        case GeneratorTypes::AlarmType::LOW_FUEL_LEVEL: return "low_fuel_level";
+        case GeneratorTypes::AlarmType::HIGH_VIBRATION: return "high_vibration";
+        case GeneratorTypes::AlarmType::OVERSPEED: return "overspeed";
+    }
+    return "unknown";
+}
+
+template <typename Model>
+BasicGenerator<Model>::BasicGenerator(const GeneratorSpec& spec)
     : current_state_(State::STOPPED)
     , target_rpm_(0.0)
     , current_rpm_(0.0)
@@ -13,31 +29,36 @@ Generator::Generator()
     , current_frequency_(0.0)
     , target_load_(0.0)
     , current_load_(0.0)
-    , max_rpm_(1800.0)
-    , max_voltage_(440.0)
-    , max_frequency_(60.0)
-    , max_load_(100.0)
-    , sensors_(std::make_unique<Sensors>())
+    , disturbance_(0.0)
+    , ramp_load_(0.0)
+    , spec_(spec)
+    , governor_(spec.inertia, spec.actuator_time)
+    , overspeed_time_(-1.0)
+    , vibration_crossing_(0.0)
     , startup_time_(0.0)
     , shutdown_time_(0.0)
 {
     last_update_ = std::chrono::system_clock::now();
+    set_spec(spec);
+    electrical_ = ElectricalModel::solve(electrical_coefficients_, 0.0, 0.0);
 }
 
-bool Generator::start() {
+template <typename Model>
+bool BasicGenerator<Model>::start() {
     if (current_state_ == State::STOPPED || current_state_ == State::FAULT) {
         current_state_ = State::STARTING;
         startup_time_ = 0.0;
-        target_rpm_ = max_rpm_;
-        target_voltage_ = max_voltage_;
-        target_frequency_ = max_frequency_;
+        target_rpm_ = spec_.max_rpm;
+        target_voltage_ = spec_.max_voltage;
+        target_frequency_ = spec_.max_frequency;
         std::cout << "Generator starting..." << std::endl;
         return true;
     }
     return false;
 }
 
-bool Generator::stop() {
+template <typename Model>
+bool BasicGenerator<Model>::stop() {
     if (current_state_ == State::RUNNING || current_state_ == State::STARTING) {
         current_state_ = State::STOPPING;
         shutdown_time_ = 0.0;
@@ -51,13 +72,15 @@ bool Generator::stop() {
     return false;
 }
 
-bool Generator::emergency_stop() {
+template <typename Model>
+bool BasicGenerator<Model>::emergency_stop() {
     if (current_state_ != State::STOPPED && current_state_ != State::FAULT) {
         current_state_ = State::STOPPED;
         current_rpm_ = 0.0;
         current_voltage_ = 0.0;
         current_frequency_ = 0.0;
         current_load_ = 0.0;
+        ramp_load_ = 0.0;
         target_load_ = 0.0;
         std::cout << "EMERGENCY STOP ACTIVATED!" << std::endl;
         return true;
@@ -65,11 +88,21 @@ bool Generator::emergency_stop() {
     return false;
 }
 
-void Generator::set_load(double percentage) {
+template <typename Model>
+bool BasicGenerator<Model>::follow_share(double percentage) {
+    if (current_state_ == State::STOPPED || current_state_ == State::FAULT) {
+        return false;
+    }
+    target_load_ = std::max(0.0, std::min(percentage, spec_.max_load));
+    return true;
+}
+
+template <typename Model>
+bool BasicGenerator<Model>::set_load(double percentage) {
     // Cannot change load when generator is stopped
     if (current_state_ == State::STOPPED || current_state_ == State::FAULT) {
         std::cout << "Cannot change load - generator is stopped" << std::endl;
-        return;
+        return false;
     }
     
     // Enforce minimum 20% load when running
@@ -79,15 +112,17 @@ void Generator::set_load(double percentage) {
     }
     
     if (percentage < 0.0) percentage = 0.0;
-    if (percentage > max_load_) percentage = max_load_;
+    if (percentage > spec_.max_load) percentage = spec_.max_load;
     
     target_load_ = percentage;
     if (current_state_ == State::RUNNING) {
         std::cout << "Load set to " << percentage << "%" << std::endl;
     }
+    return true;
 }
 
-Generator::GeneratorStatus Generator::get_status() const {
+template <typename Model>
+GeneratorTypes::GeneratorStatus BasicGenerator<Model>::get_status() const {
     GeneratorStatus status;
     status.state = current_state_;
     status.rpm = current_rpm_;
@@ -95,10 +130,11 @@ Generator::GeneratorStatus Generator::get_status() const {
     status.frequency = current_frequency_;
     status.load_percentage = current_load_;
     
-    auto sensor_readings = sensors_->get_readings();
+    auto sensor_readings = sensors_.get_readings();
     status.fuel_level = sensor_readings.fuel_level;
     status.oil_pressure = sensor_readings.oil_pressure;
     status.cooling_temp = sensor_readings.cooling_temp;
+    status.electrical = electrical_;
     
     // Get only active alarms
     status.active_alarms.clear();
@@ -111,13 +147,69 @@ Generator::GeneratorStatus Generator::get_status() const {
     return status;
 }
 
-std::vector<Generator::Alarm> Generator::get_alarms() const {
+template <typename Model>
+std::vector<GeneratorTypes::Alarm> BasicGenerator<Model>::get_alarms() const {
     return alarms_;
 }
 
-void Generator::update(double delta_time) {
-    auto now = std::chrono::system_clock::now();
-    
+template <typename Model>
+double BasicGenerator<Model>::get_target_load() const {
+    return target_load_;
+}
+
+template <typename Model>
+double BasicGenerator<Model>::load_demand() const {
+    if (current_state_ != State::RUNNING) {
+        return target_load_;
+    }
+    return std::min(std::max(target_load_ + disturbance_, 0.0), spec_.max_load);
+}
+
+template <typename Model>
+void BasicGenerator<Model>::update(double delta_time) {
+    double interval = advance_slow_clock(delta_time);
+    ThermalNetwork::State thermal = sensors_.thermal_state();
+    double temp_crossing = -1.0;
+    double sfoc = 0.0;
+    if (interval > 0.0) {
+        ThermalNetwork::integrate(sensors_.thermal_coefficients(), interval, slow_clock_.mean_heat(), ambient_temp(),
+                                  thermal, temp_crossing);
+        sfoc = spec_.sensors.sfoc.at(slow_clock_.mean_load());
+    }
+    update(delta_time, sfoc, thermal, temp_crossing);
+    electrical_ = ElectricalModel::solve(electrical_coefficients_, current_voltage_, current_load_);
+    if (vibration_frame_due()) {
+        double frame[VibrationSpectrum::FRAME];
+        double sample_rate = vibration_sample_rate();
+        double speed = shaft_speed();
+        VibrationSpectrum spectrum;
+        vibration_frame(frame);
+        VibrationSpectrum::analyze(1, frame, &sample_rate, &speed, &spectrum);
+        set_vibration_spectrum(spectrum);
+    }
+}
+
+template <typename Model>
+double BasicGenerator<Model>::advance_slow_clock(double delta_time) {
+    return slow_clock_.advance(delta_time, spec_.slow_step, current_state_ == State::RUNNING, current_load_,
+                               heat_fraction());
+}
+
+template <typename Model>
+double BasicGenerator<Model>::heat_fraction() const {
+    if (current_state_ == State::STOPPED || current_state_ == State::FAULT) {
+        return 0.0;
+    }
+    double idle = spec_.sensors.thermal.idle_heat;
+    return idle + (1.0 - idle) * current_load_ / 100.0;
+}
+
+template <typename Model>
+void BasicGenerator<Model>::update(double delta_time, double sfoc, const ThermalNetwork::State& thermal,
+                                   double temp_crossing) {
+    const double never = std::numeric_limits<double>::infinity();
+    double start_load = current_load_;
+
     switch (current_state_) {
         case State::STARTING:
             update_startup_sequence(delta_time);
@@ -134,22 +226,106 @@ void Generator::update(double delta_time) {
             break;
     }
     
+    // Where in this step each ramp crossed its alarm threshold, so alarms
+    // keep exact timestamps however long the step
+    double crossing_times[ALARM_TYPE_COUNT];
+    std::fill(crossing_times, crossing_times + ALARM_TYPE_COUNT, never);
+    bool running = current_state_ == State::RUNNING;
+    SensorTypes::AlarmTimes sensor_times = sensors_.crossing_times(running, current_load_, limits_);
+    crossing_times[static_cast<size_t>(AlarmType::LOW_OIL_PRESSURE)] = sensor_times.oil_pressure;
+    if (start_load <= overload_load_ && current_load_ > overload_load_) {
+        crossing_times[static_cast<size_t>(AlarmType::OVERLOAD)] =
+            (overload_load_ - start_load) / spec_.load_ramp_rate_at(start_load);
+    }
+    if (running && overspeed_time_ >= 0.0) {
+        crossing_times[static_cast<size_t>(AlarmType::OVERSPEED)] = overspeed_time_;
+    }
+
+    // Slow subsystems over the interval built up, which reaches back
+    // before this step; their crossings are stamped that far back
+    double interval = slow_clock_.interval();
+    if (interval > 0.0) {
+        double back = interval - delta_time;
+        if (slow_clock_.running_time() > 0.0) {
+            double load = slow_clock_.mean_load();
+            crossing_times[static_cast<size_t>(AlarmType::LOW_FUEL_LEVEL)] =
+                sensors_.crossing_times(true, load, limits_).fuel_level - back;
+            sensors_.burn_fuel(slow_clock_.running_time(), load, sfoc);
+        }
+        if (temp_crossing >= 0.0) {
+            crossing_times[static_cast<size_t>(AlarmType::HIGH_TEMPERATURE)] = temp_crossing - back;
+        }
+        sensors_.set_thermal_state(thermal);
+    }
+
     // Update sensors
-    sensors_->update(delta_time, current_state_ == State::RUNNING, current_load_);
+    sensors_.update(delta_time, running, current_load_, shaft_speed());
+    vibration_crossing_ = delta_time - std::min(sensor_times.vibration, delta_time);
     
     // Check for alarm conditions
-    check_alarm_conditions();
+    check_alarm_conditions(delta_time, crossing_times);
     
-    last_update_ = now;
+    last_update_ += std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::duration<double>(delta_time));
 }
 
-void Generator::set_parameters(double max_rpm, double max_voltage, double max_frequency) {
-    max_rpm_ = max_rpm;
-    max_voltage_ = max_voltage;
-    max_frequency_ = max_frequency;
+template <typename Model>
+double BasicGenerator<Model>::time_to_next_event() const {
+    const double never = std::numeric_limits<double>::infinity();
+
+    // Ramps toward fixed targets are exact for any step; the transitions
+    // they lead to are not
+    switch (current_state_) {
+        case State::STARTING: {
+            double rpm = (std::abs(target_rpm_ - current_rpm_) - 10.0) / spec_.rpm_acceleration_rate;
+            double voltage = (std::abs(target_voltage_ - current_voltage_) - 5.0) / spec_.voltage_ramp_rate;
+            double frequency = (std::abs(target_frequency_ - current_frequency_) - 0.5) / spec_.frequency_ramp_rate;
+            return std::max({spec_.startup_time - startup_time_, rpm, voltage, frequency, 0.0});
+        }
+        case State::STOPPING: {
+            double rpm = (current_rpm_ - 50.0) / spec_.rpm_acceleration_rate;
+            double voltage = (current_voltage_ - 10.0) / spec_.voltage_ramp_rate;
+            return std::max(std::min(spec_.shutdown_time - shutdown_time_, std::max(rpm, voltage)), 0.0);
+        }
+        case State::RUNNING: {
+            double load_factor = current_load_ / spec_.max_load;
+            if (current_load_ != load_demand() || ramp_load_ != target_load_ || !governor_.settled(load_factor) ||
+                !exciter_.settled(load_factor)) {
+                return DYNAMIC_STEP;
+            }
+            return sensors_.time_to_crossing(true, current_load_, limits_, slow_clock_.remaining(spec_.slow_step));
+        }
+        case State::STOPPED:
+        case State::FAULT:
+            break;
+    }
+    return never;
+}
+
+template <typename Model>
+void BasicGenerator<Model>::set_parameters(double max_rpm, double max_voltage, double max_frequency) {
+    GeneratorSpec spec = spec_;
+    spec.max_rpm = max_rpm;
+    spec.max_voltage = max_voltage;
+    spec.max_frequency = max_frequency;
+    set_spec(spec);
+}
+
+template <typename Model>
+void BasicGenerator<Model>::set_spec(const GeneratorSpec& spec) {
+    spec_ = spec;
+    limits_ = {spec.low_fuel_level, spec.low_oil_pressure, spec.high_vibration};
+    overload_load_ = spec.max_load * spec.overload;
+    overspeed_rpm_ = spec.max_rpm * spec.overspeed;
+    governor_.configure(spec.inertia, spec.actuator_time);
+    governor_.set_trip_speed(spec.overspeed);
+    sensors_.set_spec(spec);
+    electrical_coefficients_ = ElectricalCoefficients::from(spec.electrical, spec.rated_power, spec.max_voltage);
+    target_load_ = std::min(target_load_, spec.max_load);
 }
 
-void Generator::acknowledge_alarm(AlarmType type) {
+template <typename Model>
+void BasicGenerator<Model>::acknowledge_alarm(AlarmType type) {
     for (auto& alarm : alarms_) {
         if (alarm.type == type && alarm.active) {
             alarm.active = false;
@@ -158,60 +334,101 @@ void Generator::acknowledge_alarm(AlarmType type) {
     }
 }
 
-void Generator::reset_alarms() {
+template <typename Model>
+void BasicGenerator<Model>::reset_alarms() {
     for (auto& alarm : alarms_) {
         alarm.active = false;
     }
     std::cout << "All alarms reset" << std::endl;
 }
 
-void Generator::update_startup_sequence(double delta_time) {
+template <typename Model>
+void BasicGenerator<Model>::update_startup_sequence(double delta_time) {
     startup_time_ += delta_time;
     
     // Smooth transitions during startup
-    current_rpm_ = smooth_transition(current_rpm_, target_rpm_, RPM_ACCELERATION_RATE, delta_time);
-    current_voltage_ = smooth_transition(current_voltage_, target_voltage_, VOLTAGE_RAMP_RATE, delta_time);
-    current_frequency_ = smooth_transition(current_frequency_, target_frequency_, FREQUENCY_RAMP_RATE, delta_time);
+    current_rpm_ = smooth_transition(current_rpm_, target_rpm_, spec_.rpm_acceleration_rate, delta_time);
+    current_voltage_ = smooth_transition(current_voltage_, target_voltage_, spec_.voltage_ramp_rate, delta_time);
+    current_frequency_ = smooth_transition(current_frequency_, target_frequency_, spec_.frequency_ramp_rate, delta_time);
     
     // Check if startup is complete
-    if (startup_time_ >= STARTUP_TIME && 
+    if (startup_time_ >= spec_.startup_time && 
         std::abs(current_rpm_ - target_rpm_) < 10.0 &&
         std::abs(current_voltage_ - target_voltage_) < 5.0 &&
         std::abs(current_frequency_ - target_frequency_) < 0.5) {
         
         current_state_ = State::RUNNING;
+        reset_dynamics();
         std::cout << "Generator startup complete - now running" << std::endl;
     }
 }
 
-void Generator::update_running_state(double delta_time) {
-    // Smooth load transitions
-    current_load_ = smooth_transition(current_load_, target_load_, LOAD_RAMP_RATE, delta_time);
-    
-    // Adjust RPM based on load (governor behavior)
-    double load_factor = current_load_ / max_load_;
-    double target_rpm_at_load = max_rpm_ - (load_factor * 50.0); // Slight droop
-    current_rpm_ = smooth_transition(current_rpm_, target_rpm_at_load, RPM_ACCELERATION_RATE, delta_time);
-    
-    // Adjust voltage based on load (AVR behavior)
-    double target_voltage_at_load = max_voltage_ - (load_factor * 10.0); // Slight droop
-    current_voltage_ = smooth_transition(current_voltage_, target_voltage_at_load, VOLTAGE_RAMP_RATE, delta_time);
-    
+template <typename Model>
+void BasicGenerator<Model>::update_running_state(double delta_time) {
+    // Governor and AVR respond to the electrical load, in per unit; once
+    // they have settled under a steady load they stay put for any step.
+    // In a transient, while the load ramps or either moves faster than
+    // transient_rate, they advance with the ramp in fast_step substeps
+    double load_factor = current_load_ / spec_.max_load;
+    bool steady = current_load_ == load_demand() && ramp_load_ == target_load_;
+    if (steady && governor_.settled(load_factor) && exciter_.settled(load_factor)) {
+        governor_.settle(load_factor);
+        exciter_.settle(load_factor);
+        overspeed_time_ = governor_.trip_time();
+    } else if (!steady || governor_.rate(load_factor) > spec_.transient_rate ||
+               exciter_.rate(load_factor) > spec_.transient_rate) {
+        const int steps = static_cast<int>(std::ceil(delta_time / spec_.fast_step));
+        const double step = delta_time / steps;
+        overspeed_time_ = -1.0;
+        for (int i = 0; i < steps; ++i) {
+            advance_dynamics(step);
+            if (overspeed_time_ < 0.0 && governor_.trip_time() >= 0.0) {
+                overspeed_time_ = i * step + governor_.trip_time();
+            }
+        }
+    } else {
+        advance_dynamics(delta_time);
+        overspeed_time_ = governor_.trip_time();
+    }
+    current_rpm_ = governor_.speed() * spec_.max_rpm;
+    current_voltage_ = exciter_.voltage() * spec_.max_voltage;
+
     // Frequency follows RPM
-    current_frequency_ = (current_rpm_ / max_rpm_) * max_frequency_;
+    current_frequency_ = (current_rpm_ / spec_.max_rpm) * spec_.max_frequency;
 }
 
-void Generator::update_shutdown_sequence(double delta_time) {
+template <typename Model>
+void BasicGenerator<Model>::advance_dynamics(double delta_time) {
+    // Load ramp, then governor and AVR at the load it ends on. The same
+    // ramp is taken to the target alone, which is what `wait` judges
+    current_load_ = smooth_transition(current_load_, load_demand(), spec_.load_ramp_rate_at(current_load_), delta_time);
+    ramp_load_ = smooth_transition(ramp_load_, target_load_, spec_.load_ramp_rate_at(ramp_load_), delta_time);
+    double load_factor = current_load_ / spec_.max_load;
+    governor_.update(load_factor, delta_time);
+    exciter_.update(load_factor, delta_time);
+}
+
+template <typename Model>
+void BasicGenerator<Model>::reset_dynamics() {
+    // Continue from the present operating point without a jump
+    double load_factor = current_load_ / spec_.max_load;
+    governor_.reset(current_rpm_ / spec_.max_rpm, load_factor);
+    exciter_.reset(current_voltage_ / spec_.max_voltage, load_factor);
+}
+
+template <typename Model>
+void BasicGenerator<Model>::update_shutdown_sequence(double delta_time) {
     shutdown_time_ += delta_time;
     
     // Smooth shutdown
-    current_rpm_ = smooth_transition(current_rpm_, 0.0, RPM_ACCELERATION_RATE, delta_time);
-    current_voltage_ = smooth_transition(current_voltage_, 0.0, VOLTAGE_RAMP_RATE, delta_time);
-    current_frequency_ = smooth_transition(current_frequency_, 0.0, FREQUENCY_RAMP_RATE, delta_time);
-    current_load_ = smooth_transition(current_load_, 0.0, LOAD_RAMP_RATE, delta_time);
+    current_rpm_ = smooth_transition(current_rpm_, 0.0, spec_.rpm_acceleration_rate, delta_time);
+    current_voltage_ = smooth_transition(current_voltage_, 0.0, spec_.voltage_ramp_rate, delta_time);
+    current_frequency_ = smooth_transition(current_frequency_, 0.0, spec_.frequency_ramp_rate, delta_time);
+    current_load_ = smooth_transition(current_load_, 0.0, spec_.load_ramp_rate_at(current_load_), delta_time);
+    ramp_load_ = smooth_transition(ramp_load_, 0.0, spec_.load_ramp_rate_at(ramp_load_), delta_time);
     
     // Check if shutdown is complete
-    if (shutdown_time_ >= SHUTDOWN_TIME || 
+    if (shutdown_time_ >= spec_.shutdown_time || 
         (current_rpm_ < 50.0 && current_voltage_ < 10.0)) {
         
         current_state_ = State::STOPPED;
@@ -219,54 +436,76 @@ void Generator::update_shutdown_sequence(double delta_time) {
         current_voltage_ = 0.0;
         current_frequency_ = 0.0;
         current_load_ = 0.0;
+        ramp_load_ = 0.0;
         std::cout << "Generator shutdown complete" << std::endl;
     }
 }
 
-void Generator::check_alarm_conditions() {
-    auto sensor_readings = sensors_->get_readings();
+template <typename Model>
+void BasicGenerator<Model>::check_alarm_conditions(double delta_time, const double* crossing_times) {
+    auto sensor_readings = sensors_.get_readings();
+
+    // Noise, clamps and sudden changes take effect at the end of the step
+    auto offset = [&](AlarmType type) {
+        return std::min(crossing_times[static_cast<size_t>(type)], delta_time);
+    };
     
     // Check fuel level
-    if (sensor_readings.fuel_level < 10.0) {
-        add_alarm(AlarmType::LOW_FUEL_LEVEL, "Low fuel level: " + std::to_string(sensor_readings.fuel_level) + "%");
+    if (sensor_readings.fuel_level < spec_.low_fuel_level) {
+        add_alarm(AlarmType::LOW_FUEL_LEVEL, "Low fuel level: " + std::to_string(sensor_readings.fuel_level) + "%",
+                  offset(AlarmType::LOW_FUEL_LEVEL));
     } else {
         remove_alarm(AlarmType::LOW_FUEL_LEVEL);
     }
     
     // Check oil pressure
-    if (sensor_readings.oil_pressure < 1.5) {
-        add_alarm(AlarmType::LOW_OIL_PRESSURE, "Low oil pressure: " + std::to_string(sensor_readings.oil_pressure) + " bar");
+    if (sensor_readings.oil_pressure < spec_.low_oil_pressure) {
+        add_alarm(AlarmType::LOW_OIL_PRESSURE, "Low oil pressure: " + std::to_string(sensor_readings.oil_pressure) + " bar",
+                  offset(AlarmType::LOW_OIL_PRESSURE));
     } else {
         remove_alarm(AlarmType::LOW_OIL_PRESSURE);
     }
     
     // Check temperature
-    if (sensor_readings.cooling_temp > 110.0) {
-        add_alarm(AlarmType::HIGH_TEMPERATURE, "High temperature: " + std::to_string(sensor_readings.cooling_temp) + "°C");
+    if (sensor_readings.cooling_temp > spec_.high_cooling_temp) {
+        add_alarm(AlarmType::HIGH_TEMPERATURE, "High temperature: " + std::to_string(sensor_readings.cooling_temp) + "°C",
+                  offset(AlarmType::HIGH_TEMPERATURE));
     } else {
         remove_alarm(AlarmType::HIGH_TEMPERATURE);
     }
     
     // Check overload
-    if (current_load_ > max_load_ * 0.95) {
-        add_alarm(AlarmType::OVERLOAD, "Generator overload: " + std::to_string(current_load_) + "%");
+    if (current_load_ > overload_load_) {
+        add_alarm(AlarmType::OVERLOAD, "Generator overload: " + std::to_string(current_load_) + "%",
+                  offset(AlarmType::OVERLOAD));
     } else {
         remove_alarm(AlarmType::OVERLOAD);
     }
     
-    // Check overspeed
-    if (current_rpm_ > max_rpm_ * 1.1) {
-        add_alarm(AlarmType::OVERSPEED, "Generator overspeed: " + std::to_string(current_rpm_) + " RPM");
+    // Check overspeed, including a swing above the limit and back within the step
+    double overspeed_time = crossing_times[static_cast<size_t>(AlarmType::OVERSPEED)];
+    if (current_rpm_ > overspeed_rpm_ || overspeed_time <= delta_time) {
+        double rpm = std::max(current_rpm_, overspeed_rpm_);
+        add_alarm(AlarmType::OVERSPEED, "Generator overspeed: " + std::to_string(rpm) + " RPM",
+                  offset(AlarmType::OVERSPEED));
         emergency_stop(); // Critical fault
     }
-    
-    // Check vibration
-    if (sensor_readings.vibration > 15.0) {
-        add_alarm(AlarmType::HIGH_VIBRATION, "High vibration: " + std::to_string(sensor_readings.vibration) + " mm/s");
+}
+
+template <typename Model>
+void BasicGenerator<Model>::set_vibration_spectrum(const VibrationSpectrum& spectrum) {
+    sensors_.set_vibration_spectrum(spectrum);
+
+    // Check vibration, on the frame that ends with the last update
+    double vibration = sensors_.get_readings().vibration;
+    if (vibration > spec_.high_vibration) {
+        add_alarm(AlarmType::HIGH_VIBRATION, "High vibration: " + std::to_string(vibration) + " mm/s",
+                  -vibration_crossing_);
     }
 }
 
-void Generator::add_alarm(AlarmType type, const std::string& message) {
+template <typename Model>
+void BasicGenerator<Model>::add_alarm(AlarmType type, const std::string& message, double offset) {
     // Check if alarm already exists and is active
     for (auto& alarm : alarms_) {
         if (alarm.type == type && alarm.active) {
@@ -274,18 +513,20 @@ void Generator::add_alarm(AlarmType type, const std::string& message) {
         }
     }
     
-    // Create new alarm
+    // Create new alarm, stamped offset seconds into the current step
     Alarm alarm;
     alarm.type = type;
     alarm.message = message;
-    alarm.timestamp = std::chrono::system_clock::now();
+    alarm.timestamp = last_update_ + std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::duration<double>(offset));
     alarm.active = true;
     
     alarms_.push_back(alarm);
     std::cout << "ALARM: " << message << std::endl;
 }
 
-void Generator::remove_alarm(AlarmType type) {
+template <typename Model>
+void BasicGenerator<Model>::remove_alarm(AlarmType type) {
     for (auto& alarm : alarms_) {
         if (alarm.type == type && alarm.active) {
             alarm.active = false;
@@ -293,7 +534,8 @@ void Generator::remove_alarm(AlarmType type) {
     }
 }
 
-double Generator::smooth_transition(double current, double target, double rate, double delta_time) {
+template <typename Model>
+double BasicGenerator<Model>::smooth_transition(double current, double target, double rate, double delta_time) {
     double difference = target - current;
     double max_change = rate * delta_time;
     
@@ -303,3 +545,95 @@ double Generator::smooth_transition(double current, double target, double rate,
         return current + (difference > 0 ? max_change : -max_change);
     }
 }
+
+template <typename Model>
+std::string BasicGenerator<Model>::save_state() const {
+    std::ostringstream state;
+    state.precision(17);
+    state << "version " << STATE_VERSION << "\n"
+          << "state " << static_cast<int>(current_state_) << "\n"
+          << "rpm " << current_rpm_ << " " << target_rpm_ << "\n"
+          << "voltage " << current_voltage_ << " " << target_voltage_ << "\n"
+          << "frequency " << current_frequency_ << " " << target_frequency_ << "\n"
+          << "load " << current_load_ << " " << target_load_ << "\n"
+          << "limits " << spec_.max_rpm << " " << spec_.max_voltage << " " << spec_.max_frequency << " "
+          << spec_.max_load << "\n"
+          << "sequence " << startup_time_ << " " << shutdown_time_ << "\n";
+
+    for (const auto& alarm : alarms_) {
+        auto since_epoch = std::chrono::duration_cast<std::chrono::milliseconds>(alarm.timestamp.time_since_epoch());
+        state << "alarm " << static_cast<int>(alarm.type) << " " << alarm.active << " " << since_epoch.count()
+              << " " << alarm.message << "\n";
+    }
+
+    state << sensors_.save_state();
+    return state.str();
+}
+
+template <typename Model>
+bool BasicGenerator<Model>::restore_state(const std::string& state) {
+    std::istringstream lines(state);
+    std::string line;
+    int version = 0;
+    if (!std::getline(lines, line) || std::sscanf(line.c_str(), "version %d", &version) != 1 ||
+        version < 1 || version > STATE_VERSION) {
+        std::cerr << "Unsupported generator state version" << std::endl;
+        return false;
+    }
+
+    alarms_.clear();
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "state") {
+            int value;
+            if (fields >> value && value >= 0 && value <= static_cast<int>(State::FAULT)) {
+                current_state_ = static_cast<State>(value);
+            }
+        } else if (key == "rpm") {
+            fields >> current_rpm_ >> target_rpm_;
+        } else if (key == "voltage") {
+            fields >> current_voltage_ >> target_voltage_;
+        } else if (key == "frequency") {
+            fields >> current_frequency_ >> target_frequency_;
+        } else if (key == "load") {
+            fields >> current_load_ >> target_load_;
+            // The disturbance starts over, so the ramp goes on from here
+            ramp_load_ = current_load_;
+        } else if (key == "limits") {
+            GeneratorSpec spec = spec_;
+            if (fields >> spec.max_rpm >> spec.max_voltage >> spec.max_frequency >> spec.max_load) {
+                set_spec(spec);
+            }
+        } else if (key == "sequence") {
+            fields >> startup_time_ >> shutdown_time_;
+        } else if (key == "alarm") {
+            int type;
+            long long since_epoch;
+            Alarm alarm;
+            if (!(fields >> type >> alarm.active >> since_epoch) || type < 0 ||
+                type > static_cast<int>(AlarmType::OVERSPEED)) {
+                continue;
+            }
+            alarm.type = static_cast<AlarmType>(type);
+            alarm.timestamp = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(since_epoch)));
+            fields.get();  // Separator before the free-text message
+            std::getline(fields, alarm.message);
+            alarms_.push_back(alarm);
+        }
+    }
+
+    // Governor and AVR transients are not carried over
+    if (current_state_ == State::RUNNING) {
+        reset_dynamics();
+    }
+    sensors_.restore_state(state);
+    last_update_ = std::chrono::system_clock::now();
+    return true;
+}
+
+template class BasicGenerator<DieselEngine>;
+template class BasicGenerator<GasEngine>;
+template class BasicGenerator<DualFuelEngine>;
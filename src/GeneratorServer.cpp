@@ -0,0 +1,962 @@
+#include "GeneratorServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+// Spec and profile file paths, and spec contents, end up in replies
+static std::string json_escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+    }
+    return escaped;
+}
+
+// Every error reply starts the same way
+static bool failed(const std::string& reply) {
+    static const std::string prefix = "{\"status\":\"error\"";
+    return reply.compare(0, prefix.size(), prefix) == 0;
+}
+
+// A set on the switchboard is rated at its spec's power factor, or at
+// 0.8 if that is higher, so its reactive droop line always has a gain
+static const double RATED_POWER_FACTOR = 0.8;
+
+static double rated_kvar(const GeneratorSpec& spec) {
+    return spec.rated_power * std::tan(std::acos(std::min(spec.electrical.power_factor, RATED_POWER_FACTOR)));
+}
+
+GeneratorServer::GeneratorServer(const GeneratorSpec& spec)
+    : running_(false)
+    , active_connections_(0)
+    , rejected_connections_(0)
+    , throttled_commands_(0)
+    , tick_(0)
+    , bus_share_(-1.0)
+    , bus_generator_state_(Generator::State::STOPPED)
+    , simulated_time_(0.0)
+    , profile_generator_running_(false)
+    , control_socket_(-1)
+    , handoff_socket_(-1)
+{
+    fleet_.add(spec);
+    publish_snapshot(0);
+}
+
+GeneratorServer::~GeneratorServer() {
+    stop();
+}
+
+bool GeneratorServer::initialize(int thread_count, int modbus_port, const NmeaOutput::Config& nmea) {
+#ifdef _WIN32
+    // SO_REUSEPORT load balancing is not available on Windows
+    if (thread_count > 1) {
+        std::cout << "Multiple server threads are not supported on this platform, using 1" << std::endl;
+        thread_count = 1;
+    }
+#endif
+    if (thread_count < 1 || thread_count > MAX_THREADS) {
+        std::cerr << "Server thread count must be between 1 and " << MAX_THREADS << std::endl;
+        return false;
+    }
+
+    // A server already running on the hot restart path hands over its
+    // sockets and state; without one this is an ordinary start
+    HotRestart::Handoff handoff;
+    int predecessor = take_over(handoff);
+
+    for (int i = 0; i < thread_count; ++i) {
+        shards_.push_back(std::make_unique<ServerShard>(*this, i, thread_count));
+    }
+    if (modbus_port > 0) {
+        modbus_ = std::make_unique<ModbusServer>(*this);
+    }
+    if (nmea.enabled()) {
+        nmea_ = std::make_unique<NmeaOutput>(*this);
+    }
+    if (predecessor >= 0) {
+        adopt(handoff, modbus_port, nmea);
+    }
+    handoff.close_remaining();
+
+    bool initialized = true;
+    for (size_t i = 0; initialized && i < shards_.size(); ++i) {
+        initialized = shards_[i]->initialize(PORT, thread_count > 1);
+    }
+    if (initialized) {
+        std::cout << "Generator server listening on port " << PORT;
+        if (thread_count > 1) {
+            std::cout << " with " << thread_count << " reactor threads";
+        }
+        std::cout << std::endl;
+    }
+    initialized = initialized && (!modbus_ || modbus_->initialize(modbus_port));
+    initialized = initialized && (!nmea_ || nmea_->initialize(nmea));
+
+    // Once acknowledged the predecessor exits, so nothing may fail after this
+    if (initialized && predecessor >= 0) {
+        initialized = HotRestart::acknowledge(predecessor);
+        if (initialized) {
+            std::cout << "Took over from the previous server" << std::endl;
+        }
+    }
+    HotRestart::close_socket(predecessor);
+
+    if (!initialized) {
+        // Without an acknowledgement the predecessor resumes serving
+        nmea_.reset();
+        modbus_.reset();
+        shards_.clear();
+        return false;
+    }
+
+    if (!hot_restart_path_.empty()) {
+        control_socket_ = HotRestart::listen(hot_restart_path_);
+        if (control_socket_ >= 0) {
+            std::cout << "Hot restart enabled on " << hot_restart_path_ << std::endl;
+        }
+    }
+    return true;
+}
+
+bool GeneratorServer::set_bus_units(int units) {
+    if (units < 0 || units > static_cast<int>(Switchboard::MAX_UNITS)) {
+        return false;
+    }
+    if (units == 0) {
+        return true;
+    }
+
+    // Unit 0 is the simulated generator, at its own rating; the others
+    // are online gensets
+    size_t bus = switchboard_.add_bus(BUS_FREQUENCY, BUS_VOLTAGE);
+    power_management_.set_external(0);
+    for (int i = 0; i < units; ++i) {
+        switchboard_.add_unit(bus, Switchboard::UnitConfig());
+        switchboard_.bus(bus).running[i] = i > 0;
+    }
+    const GeneratorSpec& spec = fleet_.spec(GENERATOR);
+    Switchboard::rate_unit(switchboard_.bus(bus), 0, spec.rated_power, rated_kvar(spec));
+    publish_snapshot(tick_);
+    return true;
+}
+
+bool GeneratorServer::set_profile(ProfileTarget target, const std::string& path, std::string& error) {
+    size_t index = static_cast<size_t>(target);
+    if (!profiles_[index].open(path, error)) {
+        return false;
+    }
+    if (target == ProfileTarget::GENERATOR && profiles_[index].columns() > 1) {
+        error = path + ": a generator profile has one value column, load in %";
+        profiles_[index].close();
+        return false;
+    }
+    profile_files_[index] = json_escape(path);
+    return true;
+}
+
+bool GeneratorServer::set_bus_disturbance(const DisturbanceSpec& spec) {
+    if (switchboard_.bus_count() == 0) {
+        return false;
+    }
+    if (bus_disturbance_.size() == 0) {
+        bus_disturbance_.add(spec, LoadDisturbance::BUS_STREAMS);
+    } else {
+        bus_disturbance_.set(0, spec);
+    }
+    return true;
+}
+
+bool GeneratorServer::set_unit_specs(const std::vector<GeneratorSpec>& specs, std::string& error) {
+    size_t units = switchboard_.bus_count() > 0 ? switchboard_.bus(0).unit_count : 1;
+    if (specs.size() > units) {
+        error = std::to_string(specs.size()) + " units but " +
+                (units > 1 ? "the bus has " + std::to_string(units) : std::string("no switchboard, see --bus-units"));
+        return false;
+    }
+    if (switchboard_.bus_count() == 0) {
+        return true;
+    }
+    // Rated on a copy first, so a section that does not fit changes nothing
+    Switchboard::Bus rated = switchboard_.bus(0);
+    for (size_t i = 0; i < specs.size(); ++i) {
+        if (!Switchboard::rate_unit(rated, i, specs[i].rated_power, rated_kvar(specs[i]))) {
+            error = "unit " + specs[i].name + ": rated_power and power_factor give no switchboard rating";
+            return false;
+        }
+    }
+    switchboard_.bus(0) = rated;
+    power_management_.notify();
+    return true;
+}
+
+void GeneratorServer::run() {
+    // Goes round again when a handoff falls through
+    do {
+        running_ = true;
+
+        // Start simulation thread
+        simulation_thread_ = std::thread([this]() {
+            simulation_loop();
+        });
+
+        if (modbus_) {
+            modbus_thread_ = std::thread([this]() {
+                modbus_->run();
+            });
+        }
+        if (nmea_) {
+            nmea_thread_ = std::thread([this]() {
+                nmea_->run();
+            });
+        }
+
+        // The calling thread serves the first shard
+        for (size_t i = 1; i < shards_.size(); ++i) {
+            shard_threads_.emplace_back([this, i]() {
+                shards_[i]->run();
+            });
+        }
+        if (!shards_.empty()) {
+            shards_[0]->run();
+        }
+        join_threads();
+    } while (handoff_socket_ >= 0 && !hand_off());
+}
+
+void GeneratorServer::stop() {
+    join_threads();
+
+    for (auto& shard : shards_) {
+        shard->shutdown();
+    }
+    if (modbus_) {
+        modbus_->shutdown();
+    }
+    if (nmea_) {
+        nmea_->shutdown();
+    }
+    HotRestart::close_socket(control_socket_);
+    control_socket_ = -1;
+}
+
+void GeneratorServer::join_threads() {
+    running_ = false;
+
+    for (auto& thread : shard_threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    shard_threads_.clear();
+
+    if (modbus_thread_.joinable()) {
+        modbus_thread_.join();
+    }
+    if (nmea_thread_.joinable()) {
+        nmea_thread_.join();
+    }
+
+    if (simulation_thread_.joinable()) {
+        simulation_thread_.join();
+    }
+}
+
+int GeneratorServer::take_over(HotRestart::Handoff& handoff) {
+    if (hot_restart_path_.empty()) {
+        return -1;
+    }
+    if (!HotRestart::supported()) {
+        std::cout << "Hot restart is not supported on this platform" << std::endl;
+        hot_restart_path_.clear();
+        return -1;
+    }
+
+    int predecessor = HotRestart::connect(hot_restart_path_);
+    if (predecessor < 0) {
+        return -1;
+    }
+    std::cout << "Taking over from the server on " << hot_restart_path_ << std::endl;
+    if (!HotRestart::receive(predecessor, handoff)) {
+        std::cerr << "Hot restart handoff failed" << std::endl;
+        HotRestart::close_socket(predecessor);
+        return -1;
+    }
+    return predecessor;
+}
+
+void GeneratorServer::adopt(HotRestart::Handoff& handoff, int modbus_port, const NmeaOutput::Config& nmea) {
+    if (fleet_.restore_state(GENERATOR, handoff.state)) {
+        size_t tick = handoff.state.find("\nserver.tick ");
+        if (tick != std::string::npos) {
+            tick_ = std::strtoull(handoff.state.c_str() + tick + 13, nullptr, 10);
+        }
+        restore_switchboard(handoff.state);
+        publish_snapshot(tick_);
+    }
+
+    // With more shards than before the extra ones share a listener; with
+    // fewer, the surplus listeners are closed
+    auto listeners = handoff.take("shard listener");
+    for (size_t i = 0; i < shards_.size() && !listeners.empty(); ++i) {
+        shards_[i]->adopt_listener(i < listeners.size() ? listeners[i].fd
+                                                        : HotRestart::duplicate(listeners[i % listeners.size()].fd));
+    }
+    for (size_t i = shards_.size(); i < listeners.size(); ++i) {
+        HotRestart::close_socket(listeners[i].fd);
+    }
+
+    auto clients = handoff.take("shard client ");
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (!shards_[i % shards_.size()]->adopt_connection(clients[i].description, clients[i].fd)) {
+            std::cerr << "Dropping inherited client with an unreadable description" << std::endl;
+            HotRestart::close_socket(clients[i].fd);
+        }
+    }
+
+    if (modbus_) {
+        modbus_->adopt(handoff, modbus_port);
+    }
+    if (nmea_) {
+        nmea_->adopt(handoff, nmea);
+    }
+}
+
+void GeneratorServer::accept_takeover() {
+    int successor = HotRestart::accept_request(control_socket_);
+    if (successor < 0) {
+        return;
+    }
+    std::cout << "Hot restart requested, handing over" << std::endl;
+    handoff_socket_ = successor;
+    running_ = false;
+    for (auto& shard : shards_) {
+        shard->wake();
+    }
+}
+
+bool GeneratorServer::hand_off() {
+    // Every thread has stopped, so this one owns the generator and all
+    // shards. Settle what clients are owed before anything moves
+    bool settled = false;
+    for (int pass = 0; pass < MAX_HANDOFF_PASSES && !settled; ++pass) {
+        process_commands();
+        for (const auto& pending : pending_completions_) {
+            complete(pending, Completion::FAILED, "Server restarting");
+        }
+        pending_completions_.clear();
+
+        settled = true;
+        for (auto& shard : shards_) {
+            settled = shard->quiesce() && settled;
+        }
+    }
+    if (!settled) {
+        std::cerr << "Handing over with commands still outstanding" << std::endl;
+    }
+
+    HotRestart::Handoff handoff;
+    handoff.state = fleet_.save_state(GENERATOR) + "server.tick " + std::to_string(tick_) + "\n" + save_switchboard();
+    for (const auto& shard : shards_) {
+        shard->hand_over(handoff);
+    }
+    if (modbus_) {
+        modbus_->hand_over(handoff);
+    }
+    if (nmea_) {
+        nmea_->hand_over(handoff);
+    }
+
+    bool handed_off = HotRestart::send(handoff_socket_, handoff) && HotRestart::wait_acknowledgement(handoff_socket_);
+    HotRestart::close_socket(handoff_socket_);
+    handoff_socket_ = -1;
+    if (!handed_off) {
+        std::cerr << "New server did not take over, resuming service" << std::endl;
+        return false;
+    }
+    std::cout << "Handed " << handoff.descriptors.size() << " sockets over to the new server" << std::endl;
+    return true;
+}
+
+std::shared_ptr<const StatusSnapshot> GeneratorServer::snapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+bool GeneratorServer::admit_connection(bool adopted) {
+    int active = active_connections_.fetch_add(1, std::memory_order_relaxed);
+    if (!adopted && limits_.max_connections > 0 && active >= limits_.max_connections) {
+        active_connections_.fetch_sub(1, std::memory_order_relaxed);
+        rejected_connections_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void GeneratorServer::release_connection() {
+    active_connections_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void GeneratorServer::simulation_loop() {
+    auto last_update = std::chrono::high_resolution_clock::now();
+
+    while (running_) {
+        if (control_socket_ >= 0) {
+            accept_takeover();
+        }
+
+        // Commands land between two updates, never in the middle of one
+        process_commands();
+
+        auto now = std::chrono::high_resolution_clock::now();
+        auto delta_time = std::chrono::duration<double>(now - last_update).count();
+
+        if (delta_time >= 1.0 / UPDATE_RATE) {
+            fleet_.update(delta_time);
+            update_switchboard(delta_time);
+            update_profiles(delta_time);
+            publish_snapshot(++tick_);
+            check_completions(delta_time);
+            last_update = now;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5)); // 5ms sleep
+    }
+}
+
+void GeneratorServer::process_commands() {
+    // A bounded number per shard per pass, so a command flood delays
+    // replies rather than the next tick
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        ServerShard::Command command;
+        for (int budget = MAX_COMMANDS_PER_PASS; budget > 0 && shards_[i]->next_command(command); --budget) {
+            shards_[i]->deliver({command.connection_id, command.tag, execute(command), false});
+            if (!command.wait) {
+                continue;
+            }
+
+            // Transitions that already finished (or cannot start) complete right away
+            PendingCompletion pending{i, command.connection_id, command.tag, command.operations.front().type,
+                                      fleet_.get_target_load(GENERATOR), 0.0};
+            std::string message;
+            Completion result = evaluate(pending, fleet_.get_status(GENERATOR), message);
+            if (result == Completion::PENDING) {
+                pending_completions_.push_back(pending);
+            } else {
+                complete(pending, result, message);
+            }
+        }
+    }
+
+    if (modbus_) {
+        // Modbus writes were acknowledged when they were queued
+        ServerShard::Command command;
+        for (int budget = MAX_COMMANDS_PER_PASS; budget > 0 && modbus_->next_command(command); --budget) {
+            execute(command);
+        }
+    }
+}
+
+void GeneratorServer::publish_snapshot(uint64_t tick) {
+    auto snapshot = std::make_shared<StatusSnapshot>();
+    snapshot->tick = tick;
+    snapshot->status = fleet_.get_status(GENERATOR);
+    snapshot->modbus = ModbusRegisters::build(snapshot->status, fleet_.get_target_load(GENERATOR), tick);
+    snapshot->spectrum = fleet_.vibration_spectrum(GENERATOR);
+    snapshot->bus_enabled = switchboard_.bus_count() > 0;
+    if (snapshot->bus_enabled) {
+        snapshot->bus = switchboard_.bus(0);
+        snapshot->power_management = power_management_;
+    }
+    for (size_t i = 0; i < PROFILE_TARGET_COUNT; ++i) {
+        snapshot->profiles[i] = profiles_[i].status();
+    }
+    std::atomic_store(&snapshot_, std::shared_ptr<const StatusSnapshot>(std::move(snapshot)));
+}
+
+void GeneratorServer::update_switchboard(double delta_time) {
+    if (switchboard_.bus_count() == 0) {
+        return;
+    }
+    simulated_time_ += delta_time;
+
+    // The simulated generator only takes load once it is running
+    Switchboard::Bus& bus = switchboard_.bus(0);
+    Generator::State state = fleet_.get_state(GENERATOR);
+    bus.running[0] = state == Generator::State::RUNNING;
+    if (state != bus_generator_state_) {
+        bus_generator_state_ = state;
+        power_management_.notify();
+    }
+    if (bus_disturbance_.size() > 0) {
+        double disturbance;
+        bus_disturbance_.advance(delta_time, &disturbance);
+        bus.disturbance = std::max(disturbance / 100.0, -1.0);
+    }
+
+    // Power management only looks when demand leaves its band or a timer is due
+    if (power_management_.due(bus, simulated_time_)) {
+        PowerManagement::Request requests[Switchboard::MAX_UNITS];
+        size_t count = power_management_.evaluate(bus, simulated_time_, requests);
+        for (size_t i = 0; i < count; ++i) {
+            // Only the simulated generator is external
+            if (requests[i].start) {
+                fleet_.start(GENERATOR);
+            } else {
+                fleet_.stop(GENERATOR);
+            }
+        }
+    }
+
+    Switchboard::solve(bus);
+    if (!bus.running[0]) {
+        bus_share_ = -1.0;
+        return;
+    }
+
+    // Its own ramp limits still apply; only real changes are passed on
+    double share = bus.unit_kw[0] / bus.units[0].rated_kw * 100.0;
+    if (std::abs(share - bus_share_) >= BUS_LOAD_DEADBAND) {
+        fleet_.follow_share(GENERATOR, share);
+        bus_share_ = share;
+    }
+}
+
+std::string GeneratorServer::save_switchboard() const {
+    if (switchboard_.bus_count() == 0) {
+        return "";
+    }
+    const Switchboard::Bus& bus = switchboard_.bus(0);
+    std::ostringstream state;
+    state.precision(17);
+    state << "bus.demand " << bus.demand_kw << " " << bus.demand_kvar << "\n";
+    for (size_t i = 0; i < bus.unit_count; ++i) {
+        state << "bus.unit " << i << " " << Switchboard::mode_name(bus.units[i].mode) << " "
+              << bus.units[i].speed_droop << " " << bus.breaker_closed[i] << " " << bus.running[i] << "\n";
+        state << "pms.priority " << i << " " << power_management_.priority(i) << "\n";
+    }
+    for (size_t i = 0; i < PowerManagement::MAX_TIERS; ++i) {
+        state << "pms.tier " << i << " " << power_management_.tier_kw(i) << "\n";
+    }
+    state << "pms.enabled " << power_management_.enabled() << "\n";
+    return state.str();
+}
+
+void GeneratorServer::restore_switchboard(const std::string& state) {
+    if (switchboard_.bus_count() == 0) {
+        return;
+    }
+    Switchboard::Bus& bus = switchboard_.bus(0);
+    std::istringstream lines(state);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "bus.demand") {
+            fields >> bus.demand_kw >> bus.demand_kvar;
+        } else if (key == "bus.unit") {
+            size_t unit;
+            std::string mode_name;
+            double droop;
+            bool breaker_closed;
+            bool running;
+            Switchboard::Mode mode;
+            if (fields >> unit >> mode_name >> droop >> breaker_closed && Switchboard::parse_mode(mode_name, mode) &&
+                Switchboard::configure_unit(bus, unit, mode, droop)) {
+                bus.breaker_closed[unit] = breaker_closed;
+                // The simulated generator reports its own state
+                if (unit > 0 && fields >> running) {
+                    bus.running[unit] = running;
+                }
+            }
+        } else if (key == "pms.priority") {
+            size_t unit;
+            int priority;
+            if (fields >> unit >> priority) {
+                power_management_.set_priority(unit, priority);
+            }
+        } else if (key == "pms.tier") {
+            size_t tier;
+            double kw;
+            if (fields >> tier >> kw) {
+                power_management_.set_tier(tier, kw);
+            }
+        } else if (key == "pms.enabled") {
+            bool enabled;
+            if (fields >> enabled && enabled) {
+                power_management_.enable(bus);
+            }
+        }
+    }
+}
+
+std::string GeneratorServer::execute(const ServerShard::Command& command) {
+    if (!command.batch) {
+        return apply(command.operations.front());
+    }
+
+    // One combined reply carrying each operation's own result. The batch
+    // stops at the first operation that fails; those before it stay
+    // applied, and the reply names the one that failed
+    std::string results;
+    for (size_t i = 0; i < command.operations.size(); ++i) {
+        std::string result = apply(command.operations[i]);
+        results += (i > 0 ? "," : "") + result;
+        if (failed(result)) {
+            return "{\"status\":\"error\",\"message\":\"Batch operation " + std::to_string(i + 1) +
+                   " failed, " + std::to_string(i) + " applied before it\",\"operation\":" +
+                   std::to_string(i + 1) + ",\"results\":[" + results + "]}";
+        }
+    }
+    return "{\"status\":\"success\",\"message\":\"Batch of " + std::to_string(command.operations.size()) +
+           " operations applied\",\"results\":[" + results + "]}";
+}
+
+std::string GeneratorServer::apply(const ServerShard::Operation& operation) {
+    switch (operation.type) {
+        case ServerShard::Operation::Type::START:
+            fleet_.start(GENERATOR);
+            return "{\"status\":\"success\",\"message\":\"Generator started\"}";
+        case ServerShard::Operation::Type::STOP:
+            fleet_.stop(GENERATOR);
+            return "{\"status\":\"success\",\"message\":\"Generator stopped\"}";
+        case ServerShard::Operation::Type::EMERGENCY_STOP:
+            fleet_.emergency_stop(GENERATOR);
+            return "{\"status\":\"success\",\"message\":\"Emergency stop activated\"}";
+        case ServerShard::Operation::Type::SET_LOAD:
+            if (switchboard_.bus_count() > 0) {
+                return "{\"status\":\"error\",\"message\":\"Load follows the switchboard, use bus demand\"}";
+            }
+            if (!fleet_.set_load(GENERATOR, operation.values[0])) {
+                return "{\"status\":\"error\",\"message\":\"Cannot change load - generator is stopped\"}";
+            }
+            return "{\"status\":\"success\",\"message\":\"Load set to " +
+                   std::to_string(static_cast<int>(operation.values[0])) + "%\"}";
+        case ServerShard::Operation::Type::ACKNOWLEDGE_ALARM:
+            fleet_.acknowledge_alarm(GENERATOR,
+                                     static_cast<Generator::AlarmType>(static_cast<int>(operation.values[0])));
+            return "{\"status\":\"success\",\"message\":\"Alarm acknowledged\"}";
+        case ServerShard::Operation::Type::RESET_ALARMS:
+            fleet_.reset_alarms(GENERATOR);
+            return "{\"status\":\"success\",\"message\":\"Alarms reset\"}";
+        case ServerShard::Operation::Type::SET_PARAMETERS:
+            fleet_.set_parameters(GENERATOR, operation.values[0], operation.values[1], operation.values[2]);
+            return "{\"status\":\"success\",\"message\":\"Parameters set\"}";
+        case ServerShard::Operation::Type::SET_BUS_DEMAND:
+        case ServerShard::Operation::Type::SET_UNIT_MODE:
+        case ServerShard::Operation::Type::SET_BREAKER:
+            return apply_bus(operation);
+        case ServerShard::Operation::Type::SET_POWER_MANAGEMENT:
+        case ServerShard::Operation::Type::SET_UNIT_PRIORITY:
+        case ServerShard::Operation::Type::SET_SHED_TIER:
+            return apply_power_management(operation);
+        case ServerShard::Operation::Type::FAST_FORWARD:
+            return fast_forward(operation.values[0]);
+        case ServerShard::Operation::Type::RELOAD_SPEC:
+            return reload_spec();
+        case ServerShard::Operation::Type::PLAY_PROFILE:
+        case ServerShard::Operation::Type::STOP_PROFILE:
+            return apply_profile(operation);
+    }
+    return "{\"status\":\"error\",\"message\":\"Unknown command\"}";
+}
+
+void GeneratorServer::check_completions(double delta_time) {
+    if (pending_completions_.empty()) {
+        return;
+    }
+
+    auto snapshot = std::atomic_load(&snapshot_);
+    for (size_t i = 0; i < pending_completions_.size();) {
+        PendingCompletion& pending = pending_completions_[i];
+        pending.elapsed += delta_time;
+
+        std::string message;
+        Completion result = evaluate(pending, snapshot->status, message);
+        if (result == Completion::PENDING && pending.elapsed >= COMPLETION_TIMEOUT) {
+            result = Completion::FAILED;
+            message = "Timed out waiting for completion";
+        }
+        if (result == Completion::PENDING) {
+            ++i;
+            continue;
+        }
+
+        complete(pending, result, message);
+        pending = pending_completions_.back();
+        pending_completions_.pop_back();
+    }
+}
+
+std::string GeneratorServer::apply_bus(const ServerShard::Operation& operation) {
+    if (switchboard_.bus_count() == 0) {
+        return "{\"status\":\"error\",\"message\":\"Switchboard is not enabled\"}";
+    }
+
+    Switchboard::Bus& bus = switchboard_.bus(0);
+    if (operation.type == ServerShard::Operation::Type::SET_BUS_DEMAND) {
+        bus.demand_kw = operation.values[0];
+        bus.demand_kvar = operation.values[1];
+        std::ostringstream message;
+        message << "{\"status\":\"success\",\"message\":\"Bus demand set to " << bus.demand_kw << " kW\"}";
+        return message.str();
+    }
+    // Only now is the value a unit number
+    size_t unit = static_cast<size_t>(operation.values[0]);
+    if (unit >= bus.unit_count) {
+        return "{\"status\":\"error\",\"message\":\"Bus has no unit " + std::to_string(unit) + "\"}";
+    }
+
+    if (operation.type == ServerShard::Operation::Type::SET_BREAKER) {
+        bus.breaker_closed[unit] = operation.values[1] != 0.0;
+        power_management_.notify();
+        return "{\"status\":\"success\",\"message\":\"Unit " + std::to_string(unit) + " breaker " +
+               (bus.breaker_closed[unit] ? "closed" : "opened") + "\"}";
+    }
+
+    // A mode change without a droop keeps the current one
+    auto mode = static_cast<Switchboard::Mode>(static_cast<int>(operation.values[1]));
+    double droop = operation.values[2] > 0.0 ? operation.values[2] : bus.units[unit].speed_droop;
+    if (!Switchboard::configure_unit(bus, unit, mode, droop)) {
+        return "{\"status\":\"error\",\"message\":\"Invalid droop\"}";
+    }
+    return "{\"status\":\"success\",\"message\":\"Unit " + std::to_string(unit) + " set to " +
+           Switchboard::mode_name(mode) + "\"}";
+}
+
+std::string GeneratorServer::apply_power_management(const ServerShard::Operation& operation) {
+    if (switchboard_.bus_count() == 0) {
+        return "{\"status\":\"error\",\"message\":\"Switchboard is not enabled\"}";
+    }
+
+    Switchboard::Bus& bus = switchboard_.bus(0);
+    if (operation.type == ServerShard::Operation::Type::SET_POWER_MANAGEMENT) {
+        if (operation.values[0] != 0.0) {
+            power_management_.enable(bus);
+            return "{\"status\":\"success\",\"message\":\"Power management on\"}";
+        }
+        power_management_.disable(bus);
+        return "{\"status\":\"success\",\"message\":\"Power management off\"}";
+    }
+
+    size_t index = static_cast<size_t>(operation.values[0]);
+    if (operation.type == ServerShard::Operation::Type::SET_SHED_TIER) {
+        power_management_.set_tier(index, operation.values[1]);
+        std::ostringstream message;
+        message << "{\"status\":\"success\",\"message\":\"Tier " << index + 1 << " set to "
+                << operation.values[1] << " kW\"}";
+        return message.str();
+    }
+
+    if (index >= bus.unit_count) {
+        return "{\"status\":\"error\",\"message\":\"Bus has no unit " + std::to_string(index) + "\"}";
+    }
+    int priority = static_cast<int>(operation.values[1]);
+    power_management_.set_priority(index, priority);
+    return "{\"status\":\"success\",\"message\":\"Unit " + std::to_string(index) + " priority set to " +
+           std::to_string(priority) + "\"}";
+}
+
+std::string GeneratorServer::fast_forward(double duration) {
+    // Steps run from one event to the next instead of at UPDATE_RATE:
+    // each lands just past the next generator event, power management
+    // timer or profile sample, where the ramps in between are exact. Bus
+    // demand only changes by command, at a sample or with its disturbance,
+    // which bounds the step itself, so the power management band is not
+    // left unseen on the way.
+    double remaining = duration;
+    uint64_t steps = 0;
+    while (remaining > 0.0 && steps < MAX_FAST_FORWARD_STEPS) {
+        double step = std::min(remaining, fleet_.time_to_next_event() + EVENT_MARGIN);
+        if (switchboard_.bus_count() > 0 && power_management_.enabled()) {
+            step = std::min(step, std::max(power_management_.deadline() - simulated_time_, 0.0) + EVENT_MARGIN);
+        }
+        for (const LoadProfile& profile : profiles_) {
+            step = std::min(step, profile.time_to_next_sample() + EVENT_MARGIN);
+        }
+        step = std::min(step, bus_disturbance_.max_step());
+        fleet_.update(step);
+        update_switchboard(step);
+        update_profiles(step);
+        ++tick_;
+        remaining -= step;
+        ++steps;
+    }
+
+    publish_snapshot(tick_);
+    check_completions(duration - remaining);
+
+    std::ostringstream message;
+    message << "Advanced " << duration - remaining << " s in " << steps << " steps";
+    return "{\"status\":\"success\",\"message\":\"" + message.str() + "\"}";
+}
+
+void GeneratorServer::update_profiles(double delta_time) {
+    // A sample passed during a step takes effect from the next one. The
+    // generator only takes load once running, so samples passed before
+    // then are held, and the one in effect applies when it gets there
+    LoadProfile::Sample sample;
+    LoadProfile& generator_profile = profiles_[static_cast<size_t>(ProfileTarget::GENERATOR)];
+    bool passed = generator_profile.advance(delta_time, sample);
+    bool running = fleet_.get_state(GENERATOR) == Generator::State::RUNNING;
+    bool started = running && !profile_generator_running_;
+    profile_generator_running_ = running;
+    LoadProfile::State state = generator_profile.state();
+    if (running && (passed || (started && (state == LoadProfile::State::PLAYING ||
+                                           state == LoadProfile::State::FINISHED)))) {
+        double load = generator_profile.status().sample.values[0];
+        fleet_.set_load(GENERATOR, std::max(0.0, std::min(load, 100.0)));
+    }
+    LoadProfile& bus_profile = profiles_[static_cast<size_t>(ProfileTarget::BUS)];
+    if (bus_profile.advance(delta_time, sample) && switchboard_.bus_count() > 0) {
+        Switchboard::Bus& bus = switchboard_.bus(0);
+        bus.demand_kw = std::max(sample.values[0], 0.0);
+        bus.demand_kvar = bus_profile.columns() > 1 ? sample.values[1]
+                                                     : bus.demand_kw * std::tan(std::acos(PROFILE_POWER_FACTOR));
+    }
+}
+
+std::string GeneratorServer::apply_profile(const ServerShard::Operation& operation) {
+    auto target = static_cast<ProfileTarget>(static_cast<int>(operation.values[0]));
+    LoadProfile& profile = profiles_[static_cast<size_t>(target)];
+    const std::string name = profile_target_name(target);
+    if (profile.state() == LoadProfile::State::EMPTY) {
+        return "{\"status\":\"error\",\"message\":\"No " + name + " profile, start with --profile " + name +
+               "=<file>\"}";
+    }
+    if (operation.type == ServerShard::Operation::Type::STOP_PROFILE) {
+        profile.stop();
+        return "{\"status\":\"success\",\"message\":\"Stopped the " + name + " profile\"}";
+    }
+
+    if (target == ProfileTarget::GENERATOR && switchboard_.bus_count() > 0) {
+        return "{\"status\":\"error\",\"message\":\"Load follows the switchboard, play a bus profile\"}";
+    }
+    if (target == ProfileTarget::BUS && switchboard_.bus_count() == 0) {
+        return "{\"status\":\"error\",\"message\":\"Switchboard is not enabled\"}";
+    }
+    // The sample in effect at the start applies right away
+    profile.play(operation.values[1]);
+    update_profiles(0.0);
+    if (profile.state() == LoadProfile::State::FAILED) {
+        return "{\"status\":\"error\",\"message\":\"" + json_escape(profile.error()) + "\"}";
+    }
+    std::ostringstream message;
+    message << "Playing the " << name << " profile from " << operation.values[1] << " s";
+    return "{\"status\":\"success\",\"message\":\"" + message.str() + "\"}";
+}
+
+std::string GeneratorServer::reload_spec() {
+    // Read and checked in full before anything changes; applied between
+    // two ticks like any other command, so no update sees half a spec
+    if (spec_path_.empty()) {
+        return "{\"status\":\"error\",\"message\":\"No spec file, start with --spec\"}";
+    }
+    std::vector<GeneratorSpec> specs;
+    std::string error;
+    if (!GeneratorSpec::load(spec_path_, specs, error)) {
+        return "{\"status\":\"error\",\"message\":\"" + json_escape(error) + "\"}";
+    }
+    const GeneratorSpec& spec = specs.front();
+    if (spec.engine != fleet_.engine(GENERATOR)) {
+        return std::string("{\"status\":\"error\",\"message\":\"Engine cannot change from ") +
+               engine_type_name(fleet_.engine(GENERATOR)) + " to " + engine_type_name(spec.engine) +
+               " without a restart\"}";
+    }
+    if (!set_unit_specs(specs, error)) {
+        return "{\"status\":\"error\",\"message\":\"" + json_escape(spec_path_ + ": " + error) + "\"}";
+    }
+    fleet_.set_spec(GENERATOR, spec);
+    std::cout << "Reloaded spec " << spec.name << " from " << spec_path_ << std::endl;
+    return "{\"status\":\"success\",\"message\":\"Reloaded spec " + json_escape(spec.name) + "\"}";
+}
+
+GeneratorServer::Completion GeneratorServer::evaluate(const PendingCompletion& pending,
+                                                      const Generator::GeneratorStatus& status,
+                                                      std::string& message) const {
+    using State = Generator::State;
+
+    switch (pending.type) {
+        case ServerShard::Operation::Type::START:
+            if (status.state == State::RUNNING) {
+                message = "Generator running";
+                return Completion::DONE;
+            }
+            if (status.state != State::STARTING) {
+                message = "Generator did not reach RUNNING";
+                return Completion::FAILED;
+            }
+            return Completion::PENDING;
+
+        case ServerShard::Operation::Type::STOP:
+        case ServerShard::Operation::Type::EMERGENCY_STOP:
+            if (status.state == State::STOPPED) {
+                message = "Generator stopped";
+                return Completion::DONE;
+            }
+            if (status.state != State::STOPPING) {
+                message = "Generator did not reach STOPPED";
+                return Completion::FAILED;
+            }
+            return Completion::PENDING;
+
+        case ServerShard::Operation::Type::SET_LOAD:
+            if (status.state != State::RUNNING && status.state != State::STARTING) {
+                message = "Generator is not running";
+                return Completion::FAILED;
+            }
+            if (fleet_.get_target_load(GENERATOR) != pending.target_load) {
+                message = "Load target changed before it was reached";
+                return Completion::FAILED;
+            }
+            // On the ramp without the disturbance, which wanders around it
+            if (status.state == State::RUNNING &&
+                std::abs(fleet_.get_ramp_load(GENERATOR) - pending.target_load) < LOAD_TOLERANCE) {
+                message = "Load reached " + std::to_string(static_cast<int>(pending.target_load)) + "%";
+                return Completion::DONE;
+            }
+            return Completion::PENDING;
+
+        case ServerShard::Operation::Type::ACKNOWLEDGE_ALARM:
+        case ServerShard::Operation::Type::RESET_ALARMS:
+        case ServerShard::Operation::Type::SET_PARAMETERS:
+        case ServerShard::Operation::Type::SET_BUS_DEMAND:
+        case ServerShard::Operation::Type::SET_UNIT_MODE:
+        case ServerShard::Operation::Type::SET_BREAKER:
+        case ServerShard::Operation::Type::SET_POWER_MANAGEMENT:
+        case ServerShard::Operation::Type::SET_UNIT_PRIORITY:
+        case ServerShard::Operation::Type::SET_SHED_TIER:
+        case ServerShard::Operation::Type::FAST_FORWARD:
+        case ServerShard::Operation::Type::RELOAD_SPEC:
+        case ServerShard::Operation::Type::PLAY_PROFILE:
+        case ServerShard::Operation::Type::STOP_PROFILE:
+            // Take effect as soon as they are applied
+            message = "Applied";
+            return Completion::DONE;
+    }
+
+    message = "Unknown command";
+    return Completion::FAILED;
+}
+
+void GeneratorServer::complete(const PendingCompletion& pending, Completion result, const std::string& message) {
+    static const char* const command_names[] = {
+        "start", "stop", "emergency_stop", "set_load", "acknowledge_alarm", "reset_alarms", "set_parameters",
+        "bus demand", "bus mode", "bus breaker", "pms", "pms priority", "pms tier",
+        "fast_forward", "reload", "profile play", "profile stop"
+    };
+
+    std::string event = "{\"status\":\"";
+    event += result == Completion::DONE ? "success" : "error";
+    event += "\",\"event\":\"complete\",\"command\":\"";
+    event += command_names[static_cast<int>(pending.type)];
+    event += "\",\"message\":\"" + message + "\"}";
+
+    shards_[pending.shard]->deliver({pending.connection_id, pending.tag, event, true});
+}
@@ -0,0 +1,422 @@
+#include "GeneratorSpec.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+template <typename Model>
+static GeneratorSpec model_defaults() {
+    GeneratorSpec spec;
+    spec.name = engine_type_name(Model::TYPE);
+    spec.engine = Model::TYPE;
+
+    spec.max_rpm = 1800.0;
+    spec.max_voltage = 440.0;
+    spec.max_frequency = 60.0;
+    spec.max_load = 100.0;
+    spec.rated_power = 1000.0;
+
+    spec.rpm_acceleration_rate = Model::RPM_ACCELERATION_RATE;
+    spec.voltage_ramp_rate = Model::VOLTAGE_RAMP_RATE;
+    spec.frequency_ramp_rate = Model::FREQUENCY_RAMP_RATE;
+    spec.startup_time = Model::STARTUP_TIME;
+    spec.shutdown_time = Model::SHUTDOWN_TIME;
+
+    spec.load_ramp_rate = Model::LOAD_RAMP_RATE;
+    spec.high_load_ramp_rate = Model::HIGH_LOAD_RAMP_RATE;
+    spec.high_load = Model::HIGH_LOAD;
+
+    spec.inertia = Model::INERTIA;
+    spec.actuator_time = Model::ACTUATOR_TIME;
+
+    spec.fast_step = 0.001;
+    spec.slow_step = 1.0;
+    spec.transient_rate = 0.001;
+
+    spec.low_fuel_level = 10.0;
+    spec.low_oil_pressure = 1.5;
+    spec.high_cooling_temp = 110.0;
+    spec.high_vibration = 15.0;
+    spec.overload = 0.95;
+    spec.overspeed = 1.1;
+
+    spec.disturbance.variation = 0.0;
+    spec.disturbance.correlation_time = 30.0;
+    spec.disturbance.wave_amplitude = 0.0;
+    spec.disturbance.wave_period = 8.0;
+    spec.disturbance.seed = 0;
+
+    spec.electrical.power_factor = 0.8;
+    spec.electrical.phase_a_load = 1.0;
+    spec.electrical.phase_b_load = 1.0;
+    spec.electrical.phase_c_load = 1.0;
+    spec.electrical.source_resistance = 0.01;
+    spec.electrical.source_reactance = 0.15;
+
+    spec.sensors.tank_volume = Model::TANK_VOLUME;
+    spec.sensors.fuel_density = Model::FUEL_DENSITY;
+    spec.sensors.sfoc.points = Model::SFOC_POINTS;
+    std::copy(Model::SFOC_LOAD, Model::SFOC_LOAD + Model::SFOC_POINTS, spec.sensors.sfoc.load);
+    std::copy(Model::SFOC, Model::SFOC + Model::SFOC_POINTS, spec.sensors.sfoc.sfoc);
+    spec.sensors.oil_pressure_ramp = Model::OIL_PRESSURE_RAMP;
+    spec.sensors.oil_pressure_base = Model::OIL_PRESSURE_BASE;
+    spec.sensors.oil_pressure_load_factor = Model::OIL_PRESSURE_LOAD_FACTOR;
+    spec.sensors.vibration_ramp = Model::VIBRATION_RAMP;
+    spec.sensors.vibration_base = Model::VIBRATION_BASE;
+    spec.sensors.vibration_load_factor = Model::VIBRATION_LOAD_FACTOR;
+    spec.sensors.noise = 0.02;
+    spec.sensors.fuel_sample_rate = 1.0;
+    spec.sensors.oil_pressure_sample_rate = 10.0;
+    spec.sensors.temp_sample_rate = 1.0;
+    spec.sensors.vibration_sample_rate = 1000.0;
+    spec.sensors.vibration_2x = 0.5;
+    spec.sensors.bpfo_order = 3.58;
+    spec.sensors.bpfi_order = 5.42;
+    spec.sensors.outer_race_fault = 0.0;
+    spec.sensors.inner_race_fault = 0.0;
+
+    spec.sensors.thermal.jacket_capacity = 6000.0;
+    spec.sensors.thermal.oil_capacity = 1100.0;
+    spec.sensors.thermal.exhaust_capacity = 120.0;
+    spec.sensors.thermal.jacket_heat = Model::JACKET_HEAT;
+    spec.sensors.thermal.oil_heat = Model::OIL_HEAT;
+    spec.sensors.thermal.exhaust_heat = Model::EXHAUST_HEAT;
+    spec.sensors.thermal.idle_heat = 0.3;
+    spec.sensors.thermal.oil_conductance = 15.0;
+    spec.sensors.thermal.cooler_conductance = 12.0;
+    spec.sensors.thermal.ambient_conductance = 0.5;
+    spec.sensors.thermal.exhaust_conductance = 2.0;
+    spec.sensors.thermal.sea_temp = 25.0;
+    spec.sensors.thermal.thermostat_open = 78.0;
+    spec.sensors.thermal.thermostat_full = 88.0;
+    return spec;
+}
+
+GeneratorSpec GeneratorSpec::defaults(EngineType engine) {
+    switch (engine) {
+        case EngineType::GAS: return model_defaults<GasEngine>();
+        case EngineType::DUAL_FUEL: return model_defaults<DualFuelEngine>();
+        case EngineType::DIESEL: break;
+    }
+    return model_defaults<DieselEngine>();
+}
+
+namespace {
+
+using Text = const std::string&;
+
+bool parse_number(Text text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && std::isfinite(value);
+}
+
+// Each writes the value only if the text is a number within its bound
+bool any(Text text, double& value) {
+    double number;
+    if (!parse_number(text, number)) {
+        return false;
+    }
+    value = number;
+    return true;
+}
+
+bool positive(Text text, double& value) {
+    double number;
+    if (!parse_number(text, number) || !(number > 0.0)) {
+        return false;
+    }
+    value = number;
+    return true;
+}
+
+bool non_negative(Text text, double& value) {
+    double number;
+    if (!parse_number(text, number) || !(number >= 0.0)) {
+        return false;
+    }
+    value = number;
+    return true;
+}
+
+// Digits only, up to 2^64 - 1
+bool whole(Text text, uint64_t& value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    errno = 0;
+    unsigned long long number = std::strtoull(text.c_str(), nullptr, 10);
+    if (errno == ERANGE) {
+        return false;
+    }
+    value = number;
+    return true;
+}
+
+// A key and what sets it in a spec; false when the value is invalid
+struct Field {
+    const char* key;
+    bool (*set)(GeneratorSpec& spec, Text text);
+};
+
+const Field FIELDS[] = {
+    {"max_rpm", [](GeneratorSpec& s, Text t) { return positive(t, s.max_rpm); }},
+    {"max_voltage", [](GeneratorSpec& s, Text t) { return positive(t, s.max_voltage); }},
+    {"max_frequency", [](GeneratorSpec& s, Text t) { return positive(t, s.max_frequency); }},
+    {"max_load", [](GeneratorSpec& s, Text t) { return positive(t, s.max_load); }},
+    {"rated_power", [](GeneratorSpec& s, Text t) { return positive(t, s.rated_power); }},
+    {"rpm_acceleration_rate", [](GeneratorSpec& s, Text t) { return positive(t, s.rpm_acceleration_rate); }},
+    {"voltage_ramp_rate", [](GeneratorSpec& s, Text t) { return positive(t, s.voltage_ramp_rate); }},
+    {"frequency_ramp_rate", [](GeneratorSpec& s, Text t) { return positive(t, s.frequency_ramp_rate); }},
+    {"startup_time", [](GeneratorSpec& s, Text t) { return positive(t, s.startup_time); }},
+    {"shutdown_time", [](GeneratorSpec& s, Text t) { return positive(t, s.shutdown_time); }},
+    {"load_ramp_rate", [](GeneratorSpec& s, Text t) { return positive(t, s.load_ramp_rate); }},
+    {"high_load_ramp_rate", [](GeneratorSpec& s, Text t) { return positive(t, s.high_load_ramp_rate); }},
+    {"high_load", [](GeneratorSpec& s, Text t) { return non_negative(t, s.high_load); }},
+    {"inertia", [](GeneratorSpec& s, Text t) { return positive(t, s.inertia); }},
+    {"actuator_time", [](GeneratorSpec& s, Text t) { return positive(t, s.actuator_time); }},
+    {"fast_step", [](GeneratorSpec& s, Text t) { return positive(t, s.fast_step); }},
+    {"slow_step", [](GeneratorSpec& s, Text t) { return positive(t, s.slow_step); }},
+    {"transient_rate", [](GeneratorSpec& s, Text t) { return non_negative(t, s.transient_rate); }},
+    {"low_fuel_level", [](GeneratorSpec& s, Text t) { return any(t, s.low_fuel_level); }},
+    {"low_oil_pressure", [](GeneratorSpec& s, Text t) { return any(t, s.low_oil_pressure); }},
+    {"high_cooling_temp", [](GeneratorSpec& s, Text t) { return any(t, s.high_cooling_temp); }},
+    {"high_vibration", [](GeneratorSpec& s, Text t) { return any(t, s.high_vibration); }},
+    {"overload", [](GeneratorSpec& s, Text t) { return positive(t, s.overload); }},
+    {"overspeed", [](GeneratorSpec& s, Text t) { return positive(t, s.overspeed); }},
+    {"power_factor", [](GeneratorSpec& s, Text t) { return positive(t, s.electrical.power_factor); }},
+    {"phase_a_load", [](GeneratorSpec& s, Text t) { return non_negative(t, s.electrical.phase_a_load); }},
+    {"phase_b_load", [](GeneratorSpec& s, Text t) { return non_negative(t, s.electrical.phase_b_load); }},
+    {"phase_c_load", [](GeneratorSpec& s, Text t) { return non_negative(t, s.electrical.phase_c_load); }},
+    {"source_resistance", [](GeneratorSpec& s, Text t) { return non_negative(t, s.electrical.source_resistance); }},
+    {"source_reactance", [](GeneratorSpec& s, Text t) { return non_negative(t, s.electrical.source_reactance); }},
+    {"tank_volume", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.tank_volume); }},
+    {"fuel_density", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.fuel_density); }},
+    {"oil_pressure_ramp", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.oil_pressure_ramp); }},
+    {"oil_pressure_base", [](GeneratorSpec& s, Text t) { return any(t, s.sensors.oil_pressure_base); }},
+    {"oil_pressure_load_factor", [](GeneratorSpec& s, Text t) { return any(t, s.sensors.oil_pressure_load_factor); }},
+    {"vibration_ramp", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.vibration_ramp); }},
+    {"vibration_base", [](GeneratorSpec& s, Text t) { return any(t, s.sensors.vibration_base); }},
+    {"vibration_load_factor", [](GeneratorSpec& s, Text t) { return any(t, s.sensors.vibration_load_factor); }},
+    {"noise", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.noise); }},
+    {"fuel_sample_rate", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.fuel_sample_rate); }},
+    {"oil_pressure_sample_rate", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.oil_pressure_sample_rate); }},
+    {"temp_sample_rate", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.temp_sample_rate); }},
+    {"vibration_sample_rate", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.vibration_sample_rate); }},
+    {"vibration_2x", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.vibration_2x); }},
+    {"bpfo_order", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.bpfo_order); }},
+    {"bpfi_order", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.bpfi_order); }},
+    {"outer_race_fault", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.outer_race_fault); }},
+    {"inner_race_fault", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.inner_race_fault); }},
+    {"jacket_capacity", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.thermal.jacket_capacity); }},
+    {"oil_capacity", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.thermal.oil_capacity); }},
+    {"exhaust_capacity", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.thermal.exhaust_capacity); }},
+    {"jacket_heat", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.thermal.jacket_heat); }},
+    {"oil_heat", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.thermal.oil_heat); }},
+    {"exhaust_heat", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.thermal.exhaust_heat); }},
+    {"idle_heat", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.thermal.idle_heat); }},
+    {"oil_conductance", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.thermal.oil_conductance); }},
+    {"cooler_conductance", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.thermal.cooler_conductance); }},
+    {"ambient_conductance", [](GeneratorSpec& s, Text t) { return non_negative(t, s.sensors.thermal.ambient_conductance); }},
+    {"exhaust_conductance", [](GeneratorSpec& s, Text t) { return positive(t, s.sensors.thermal.exhaust_conductance); }},
+    {"sea_temp", [](GeneratorSpec& s, Text t) { return any(t, s.sensors.thermal.sea_temp); }},
+    {"thermostat_open", [](GeneratorSpec& s, Text t) { return any(t, s.sensors.thermal.thermostat_open); }},
+    {"thermostat_full", [](GeneratorSpec& s, Text t) { return any(t, s.sensors.thermal.thermostat_full); }},
+};
+
+// Also taken on their own for the bus, see parse_disturbance()
+const Field DISTURBANCE_FIELDS[] = {
+    {"load_variation", [](GeneratorSpec& s, Text t) { return non_negative(t, s.disturbance.variation); }},
+    {"load_correlation_time", [](GeneratorSpec& s, Text t) { return positive(t, s.disturbance.correlation_time); }},
+    {"wave_amplitude", [](GeneratorSpec& s, Text t) { return non_negative(t, s.disturbance.wave_amplitude); }},
+    {"wave_period", [](GeneratorSpec& s, Text t) { return positive(t, s.disturbance.wave_period); }},
+    {"disturbance_seed", [](GeneratorSpec& s, Text t) { return whole(t, s.disturbance.seed); }},
+};
+
+template <size_t N>
+const Field* find_in(const Field (&fields)[N], Text key) {
+    for (const auto& field : fields) {
+        if (key == field.key) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+const Field* find_field(Text key) {
+    const Field* field = find_in(FIELDS, key);
+    return field ? field : find_in(DISTURBANCE_FIELDS, key);
+}
+
+// load:sfoc pairs in ascending load, SFOC positive
+bool parse_sfoc(std::istringstream& fields, SfocCurve& curve) {
+    curve.points = 0;
+    std::string pair;
+    while (fields >> pair) {
+        size_t colon = pair.find(':');
+        double load;
+        double sfoc;
+        if (curve.points == SfocCurve::MAX_POINTS || colon == std::string::npos ||
+            !parse_number(pair.substr(0, colon), load) || !parse_number(pair.substr(colon + 1), sfoc) ||
+            sfoc <= 0.0 || (curve.points > 0 && load <= curve.load[curve.points - 1])) {
+            return false;
+        }
+        curve.load[curve.points] = load;
+        curve.sfoc[curve.points] = sfoc;
+        ++curve.points;
+    }
+    return curve.points >= 2;
+}
+
+// One `[name]` section as written, applied onto its family's defaults
+// once the whole section has been read, so `engine` can come anywhere
+struct Section {
+    std::string name;
+    EngineType engine;
+    std::vector<std::pair<const Field*, std::string>> values;
+    bool has_sfoc;
+    SfocCurve sfoc;
+};
+
+}
+
+bool GeneratorSpec::parse(const std::string& text, std::vector<GeneratorSpec>& specs, std::string& error) {
+    // Values are checked as they are read, on a spec of their own
+    GeneratorSpec checked = defaults(EngineType::DIESEL);
+    std::vector<Section> sections;
+    std::istringstream lines(text);
+    std::string line;
+    size_t number = 0;
+    while (std::getline(lines, line)) {
+        ++number;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string key;
+        if (!(fields >> key)) {
+            continue;
+        }
+        std::string where = "line " + std::to_string(number) + ": ";
+
+        if (key.front() == '[') {
+            std::string rest;
+            if (key.size() < 3 || key.back() != ']' || fields >> rest) {
+                error = where + "expected [name]";
+                return false;
+            }
+            std::string name = key.substr(1, key.size() - 2);
+            for (const auto& section : sections) {
+                if (section.name == name) {
+                    error = where + "duplicate unit " + name;
+                    return false;
+                }
+            }
+            sections.push_back({name, EngineType::DIESEL, {}, false, {}});
+            continue;
+        }
+        if (sections.empty()) {
+            error = where + key + " before the first [name]";
+            return false;
+        }
+
+        if (key == "sfoc") {
+            if (!parse_sfoc(fields, sections.back().sfoc)) {
+                error = where + "expected sfoc <load>:<g/kWh> ..., 2 to " + std::to_string(SfocCurve::MAX_POINTS) +
+                        " points in ascending load";
+                return false;
+            }
+            sections.back().has_sfoc = true;
+            continue;
+        }
+
+        std::string value;
+        std::string rest;
+        if (!(fields >> value) || fields >> rest) {
+            error = where + "expected " + key + " <value>";
+            return false;
+        }
+        if (key == "engine") {
+            if (!parse_engine_type(value, sections.back().engine)) {
+                error = where + "unknown engine " + value;
+                return false;
+            }
+            continue;
+        }
+        const Field* field = find_field(key);
+        if (!field) {
+            error = where + "unknown key " + key;
+            return false;
+        }
+        if (!field->set(checked, value)) {
+            error = where + "invalid " + key + " " + value;
+            return false;
+        }
+        sections.back().values.emplace_back(field, value);
+    }
+
+    if (sections.empty()) {
+        error = "no units";
+        return false;
+    }
+
+    std::vector<GeneratorSpec> parsed;
+    for (const auto& section : sections) {
+        GeneratorSpec spec = defaults(section.engine);
+        spec.name = section.name;
+        for (const auto& value : section.values) {
+            value.first->set(spec, value.second);
+        }
+        if (section.has_sfoc) {
+            spec.sensors.sfoc = section.sfoc;
+        }
+        if (spec.sensors.thermal.thermostat_full <= spec.sensors.thermal.thermostat_open) {
+            error = "unit " + spec.name + ": thermostat_full must be above thermostat_open";
+            return false;
+        }
+        if (spec.electrical.power_factor > 1.0) {
+            error = "unit " + spec.name + ": power_factor must be at most 1";
+            return false;
+        }
+        if (spec.electrical.phase_a_load + spec.electrical.phase_b_load + spec.electrical.phase_c_load <= 0.0) {
+            error = "unit " + spec.name + ": no load on any phase";
+            return false;
+        }
+        parsed.push_back(spec);
+    }
+    specs.swap(parsed);
+    return true;
+}
+
+bool GeneratorSpec::load(const std::string& path, std::vector<GeneratorSpec>& specs, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot read " + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    if (!parse(text.str(), specs, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool GeneratorSpec::parse_disturbance(const std::string& text, DisturbanceSpec& disturbance, std::string& error) {
+    // Checked in full before anything changes
+    GeneratorSpec parsed;
+    parsed.disturbance = disturbance;
+    std::istringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t equals = item.find('=');
+        const Field* field = find_in(DISTURBANCE_FIELDS, item.substr(0, equals));
+        if (equals == std::string::npos || !field || !field->set(parsed, item.substr(equals + 1))) {
+            error = "unknown key or invalid value in " + item;
+            return false;
+        }
+    }
+    disturbance = parsed.disturbance;
+    return true;
+}
@@ -0,0 +1,342 @@
+#include "HotRestart.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#ifndef _WIN32
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <sys/un.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+static const char REQUEST[] = "TAKEOVER\n";
+static const char ACKNOWLEDGEMENT[] = "OK\n";
+
+std::vector<HotRestart::Descriptor> HotRestart::Handoff::take(const std::string& prefix) {
+    std::vector<Descriptor> taken;
+    for (auto it = descriptors.begin(); it != descriptors.end();) {
+        if (it->description.compare(0, prefix.size(), prefix) == 0) {
+            taken.push_back(*it);
+            it = descriptors.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return taken;
+}
+
+void HotRestart::Handoff::close_remaining() {
+    for (const auto& descriptor : descriptors) {
+        std::cout << "Closing unclaimed inherited socket (" << descriptor.description << ")" << std::endl;
+        close_socket(descriptor.fd);
+    }
+    descriptors.clear();
+}
+
+std::string HotRestart::encode_bytes(const std::string& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    if (bytes.empty()) {
+        return "-";
+    }
+    std::string text;
+    text.reserve(bytes.size() * 2);
+    for (unsigned char byte : bytes) {
+        text.push_back(digits[byte >> 4]);
+        text.push_back(digits[byte & 0x0F]);
+    }
+    return text;
+}
+
+std::string HotRestart::decode_bytes(const std::string& text) {
+    auto value = [](char digit) {
+        return digit <= '9' ? digit - '0' : digit - 'a' + 10;
+    };
+    std::string bytes;
+    if (text == "-") {
+        return bytes;
+    }
+    bytes.reserve(text.size() / 2);
+    for (size_t i = 0; i + 1 < text.size(); i += 2) {
+        bytes.push_back(static_cast<char>((value(text[i]) << 4) | value(text[i + 1])));
+    }
+    return bytes;
+}
+
+#ifdef _WIN32
+
+bool HotRestart::supported() { return false; }
+int HotRestart::listen(const std::string&) { return -1; }
+int HotRestart::accept_request(int) { return -1; }
+bool HotRestart::send(int, const Handoff&) { return false; }
+bool HotRestart::wait_acknowledgement(int) { return false; }
+int HotRestart::connect(const std::string&) { return -1; }
+bool HotRestart::receive(int, Handoff&) { return false; }
+bool HotRestart::acknowledge(int) { return false; }
+void HotRestart::close_socket(int) {}
+int HotRestart::duplicate(int) { return -1; }
+
+#else
+
+static bool set_timeouts(int socket, int seconds) {
+    struct timeval timeout;
+    timeout.tv_sec = seconds;
+    timeout.tv_usec = 0;
+    return setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0 &&
+           setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+static bool make_address(const std::string& path, struct sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Hot restart socket path is too long: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+static bool write_all(int socket, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::send(socket, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+static bool read_all(int socket, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(socket, data, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+static void put_u32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static uint32_t get_u32(const char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+bool HotRestart::supported() {
+    return true;
+}
+
+int HotRestart::listen(const std::string& path) {
+    struct sockaddr_un address;
+    if (!make_address(path, address)) {
+        return -1;
+    }
+
+    int control = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (control < 0) {
+        std::cerr << "Failed to create hot restart socket" << std::endl;
+        return -1;
+    }
+
+    // A previous process may have left its socket file behind
+    unlink(path.c_str());
+    if (bind(control, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(control, 1) < 0) {
+        std::cerr << "Failed to listen on hot restart socket " << path << std::endl;
+        close(control);
+        return -1;
+    }
+    int flags = fcntl(control, F_GETFL, 0);
+    fcntl(control, F_SETFL, flags | O_NONBLOCK);
+    return control;
+}
+
+int HotRestart::accept_request(int control_socket) {
+    int socket = accept(control_socket, nullptr, nullptr);
+    if (socket < 0) {
+        return -1;
+    }
+
+    // Accepted sockets may inherit O_NONBLOCK; the handoff itself blocks
+    int flags = fcntl(socket, F_GETFL, 0);
+    fcntl(socket, F_SETFL, flags & ~O_NONBLOCK);
+
+    char request[sizeof(REQUEST) - 1];
+    if (!set_timeouts(socket, TIMEOUT_SECONDS) || !read_all(socket, request, sizeof(request)) ||
+        std::memcmp(request, REQUEST, sizeof(request)) != 0) {
+        std::cerr << "Ignoring invalid hot restart request" << std::endl;
+        close(socket);
+        return -1;
+    }
+    return socket;
+}
+
+bool HotRestart::send(int socket, const Handoff& handoff) {
+    // Header, state and descriptions first, then the descriptors in order
+    std::string descriptions;
+    for (const auto& descriptor : handoff.descriptors) {
+        descriptions += descriptor.description;
+        descriptions += '\n';
+    }
+
+    std::string header;
+    put_u32(header, MAGIC);
+    put_u32(header, static_cast<uint32_t>(handoff.state.size()));
+    put_u32(header, static_cast<uint32_t>(descriptions.size()));
+    put_u32(header, static_cast<uint32_t>(handoff.descriptors.size()));
+    if (!write_all(socket, header.data(), header.size()) ||
+        !write_all(socket, handoff.state.data(), handoff.state.size()) ||
+        !write_all(socket, descriptions.data(), descriptions.size())) {
+        return false;
+    }
+
+    for (size_t sent = 0; sent < handoff.descriptors.size();) {
+        size_t count = std::min(MAX_FDS_PER_MESSAGE, handoff.descriptors.size() - sent);
+        std::vector<char> control(CMSG_SPACE(sizeof(int) * count), 0);
+        char marker = 'F';
+        struct iovec data = {&marker, 1};
+
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+
+        struct cmsghdr* header_cmsg = CMSG_FIRSTHDR(&message);
+        header_cmsg->cmsg_level = SOL_SOCKET;
+        header_cmsg->cmsg_type = SCM_RIGHTS;
+        header_cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        int* fds = reinterpret_cast<int*>(CMSG_DATA(header_cmsg));
+        for (size_t i = 0; i < count; ++i) {
+            fds[i] = handoff.descriptors[sent + i].fd;
+        }
+
+        if (sendmsg(socket, &message, MSG_NOSIGNAL) != 1) {
+            return false;
+        }
+        sent += count;
+    }
+    return true;
+}
+
+bool HotRestart::wait_acknowledgement(int socket) {
+    char reply[sizeof(ACKNOWLEDGEMENT) - 1];
+    return read_all(socket, reply, sizeof(reply)) && std::memcmp(reply, ACKNOWLEDGEMENT, sizeof(reply)) == 0;
+}
+
+int HotRestart::connect(const std::string& path) {
+    struct sockaddr_un address;
+    if (!make_address(path, address)) {
+        return -1;
+    }
+
+    int socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket < 0) {
+        return -1;
+    }
+    if (::connect(socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 ||
+        !set_timeouts(socket, TIMEOUT_SECONDS) || !write_all(socket, REQUEST, sizeof(REQUEST) - 1)) {
+        close(socket);
+        return -1;
+    }
+    return socket;
+}
+
+bool HotRestart::receive(int socket, Handoff& handoff) {
+    char header[16];
+    if (!read_all(socket, header, sizeof(header)) || get_u32(header) != MAGIC) {
+        std::cerr << "Invalid hot restart handoff header" << std::endl;
+        return false;
+    }
+    uint32_t state_size = get_u32(header + 4);
+    uint32_t descriptions_size = get_u32(header + 8);
+    uint32_t count = get_u32(header + 12);
+
+    handoff.state.resize(state_size);
+    std::string descriptions(descriptions_size, '\0');
+    if (!read_all(socket, &handoff.state[0], state_size) || !read_all(socket, &descriptions[0], descriptions_size)) {
+        return false;
+    }
+
+    std::vector<int> fds;
+    while (fds.size() < count) {
+        size_t expected = std::min(MAX_FDS_PER_MESSAGE, count - fds.size());
+        std::vector<char> control(CMSG_SPACE(sizeof(int) * expected), 0);
+        char marker;
+        struct iovec data = {&marker, 1};
+
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+
+        if (recvmsg(socket, &message, 0) != 1) {
+            break;
+        }
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                size_t received = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                const int* passed = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+                fds.insert(fds.end(), passed, passed + received);
+            }
+        }
+        if (message.msg_flags & MSG_CTRUNC) {
+            break;
+        }
+    }
+
+    if (fds.size() != count) {
+        std::cerr << "Hot restart handoff lost sockets" << std::endl;
+        for (int fd : fds) {
+            close(fd);
+        }
+        return false;
+    }
+
+    size_t start = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t end = descriptions.find('\n', start);
+        handoff.add(descriptions.substr(start, end - start), fds[i]);
+        start = end == std::string::npos ? descriptions.size() : end + 1;
+    }
+    return true;
+}
+
+bool HotRestart::acknowledge(int socket) {
+    return write_all(socket, ACKNOWLEDGEMENT, sizeof(ACKNOWLEDGEMENT) - 1);
+}
+
+void HotRestart::close_socket(int socket) {
+    if (socket >= 0) {
+        close(socket);
+    }
+}
+
+int HotRestart::duplicate(int socket) {
+    return dup(socket);
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include "LoadDisturbance.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Wave components as fractions of the peak frequency
+static const double WAVE_SPREAD[LoadDisturbance::WAVE_COMPONENTS] = {0.8, 0.9, 1.1, 1.25};
+static const uint64_t GOLDEN = 0x9e3779b97f4a7c15ULL;
+static const double PI = 3.14159265358979323846;
+
+// splitmix64 finalizer
+static inline uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+size_t LoadDisturbance::add(const DisturbanceSpec& spec, uint64_t stream) {
+    specs_.push_back(spec);
+    streams_.push_back(stream);
+    for (auto* column : {&variation_, &inverse_time_, &amplitude_, &ou_}) {
+        column->push_back(0.0);
+    }
+    for (size_t k = 0; k < WAVE_COMPONENTS; ++k) {
+        omega_[k].push_back(0.0);
+        re_[k].push_back(1.0);
+        im_[k].push_back(0.0);
+    }
+    key_.push_back(0);
+    counter_.push_back(0);
+
+    size_t index = size() - 1;
+    set(index, spec);
+    seed(index);
+    return index;
+}
+
+void LoadDisturbance::set(size_t index, const DisturbanceSpec& spec) {
+    bool reseed = spec.seed != specs_[index].seed;
+    specs_[index] = spec;
+    variation_[index] = spec.variation;
+    inverse_time_[index] = 1.0 / spec.correlation_time;
+    amplitude_[index] = spec.wave_amplitude / std::sqrt(static_cast<double>(WAVE_COMPONENTS));
+    for (size_t k = 0; k < WAVE_COMPONENTS; ++k) {
+        omega_[k][index] = 2.0 * PI * WAVE_SPREAD[k] / spec.wave_period;
+    }
+    if (reseed) {
+        seed(index);
+    }
+    update_max_step();
+}
+
+void LoadDisturbance::seed(size_t index) {
+    key_[index] = mix(mix(specs_[index].seed) ^ streams_[index]);
+    counter_[index] = 0;
+    ou_[index] = 0.0;
+    for (size_t k = 0; k < WAVE_COMPONENTS; ++k) {
+        // Off the draw sequence, which starts at 1
+        double phase = 2.0 * PI * (mix(~key_[index] + k * GOLDEN) >> 11) * (1.0 / 9007199254740992.0);
+        re_[k][index] = std::cos(phase);
+        im_[k][index] = std::sin(phase);
+    }
+}
+
+void LoadDisturbance::update_max_step() {
+    double shortest = std::numeric_limits<double>::infinity();
+    for (const auto& spec : specs_) {
+        if (spec.variation > 0.0) {
+            shortest = std::min(shortest, spec.correlation_time);
+        }
+        if (spec.wave_amplitude > 0.0) {
+            shortest = std::min(shortest, spec.wave_period / WAVE_SPREAD[WAVE_COMPONENTS - 1]);
+        }
+    }
+    max_step_ = STEP_FRACTION * shortest;
+    pending_ = 0.0;
+}
+
+void LoadDisturbance::advance(double delta_time, double* value) {
+    const size_t count = size();
+    if (std::isinf(max_step_)) {
+        std::fill(value, value + count, 0.0);
+        return;
+    }
+
+    // Whole steps of an eighth of a correlation time, so the decay argument
+    // stays below 1/8, and of the shortest wave period, so no phasor turns
+    // more than pi/4; the polynomials are good to 1e-8 there. Between steps
+    // the value holds, so it depends on simulated time but not on the ticks
+    // that took it there.
+    pending_ += delta_time;
+    const double h = max_step_;
+    const long steps = static_cast<long>(std::floor(pending_ / h + 1e-9));
+    pending_ = std::max(pending_ - steps * h, 0.0);
+    const double* variation = variation_.data();
+    const double* inverse_time = inverse_time_.data();
+    const uint64_t* key = key_.data();
+    uint64_t* counter = counter_.data();
+    double* ou = ou_.data();
+    for (long step = 0; step < steps; ++step) {
+        for (size_t i = 0; i < count; ++i) {
+            double x = h * inverse_time[i];
+            double decay = 1.0 - x * (1.0 - x * (0.5 - x * (1.0 / 6.0 - x * (1.0 / 24.0 - x * (1.0 / 120.0)))));
+            uint64_t z = mix(key[i] + ++counter[i] * GOLDEN);
+            double sum = static_cast<double>((z & 0xffff) + ((z >> 16) & 0xffff) + ((z >> 32) & 0xffff) + (z >> 48));
+            double normal = ((sum + 2.0) * (1.0 / 65536.0) - 2.0) * 1.7320508075688772;
+            ou[i] = decay * ou[i] + variation[i] * std::sqrt(std::max(1.0 - decay * decay, 0.0)) * normal;
+        }
+        for (size_t k = 0; k < WAVE_COMPONENTS; ++k) {
+            const double* omega = omega_[k].data();
+            double* re = re_[k].data();
+            double* im = im_[k].data();
+            for (size_t i = 0; i < count; ++i) {
+                double theta = h * omega[i];
+                double t2 = theta * theta;
+                double c = 1.0 - t2 * (0.5 - t2 * (1.0 / 24.0 - t2 * (1.0 / 720.0 - t2 * (1.0 / 40320.0))));
+                double s = theta * (1.0 - t2 * (1.0 / 6.0 - t2 * (1.0 / 120.0 - t2 * (1.0 / 5040.0 - t2 * (1.0 / 362880.0)))));
+                double r = re[i] * c - im[i] * s;
+                double j = re[i] * s + im[i] * c;
+                // Pulled back onto the unit circle, one Newton step
+                double scale = 1.5 - 0.5 * (r * r + j * j);
+                re[i] = r * scale;
+                im[i] = j * scale;
+            }
+        }
+    }
+
+    const double* amplitude = amplitude_.data();
+    for (size_t i = 0; i < count; ++i) {
+        double waves = 0.0;
+        for (size_t k = 0; k < WAVE_COMPONENTS; ++k) {
+            waves += im_[k][i];
+        }
+        value[i] = ou[i] + amplitude[i] * waves;
+    }
+}
@@ -0,0 +1,433 @@
+#include "LoadProfile.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+static const char MAGIC[4] = {'L', 'P', 'R', 'F'};
+static const uint32_t VERSION = 1;
+
+const char* profile_target_name(ProfileTarget target) {
+    switch (target) {
+        case ProfileTarget::GENERATOR: return "generator";
+        case ProfileTarget::BUS: return "bus";
+    }
+    return "unknown";
+}
+
+bool parse_profile_target(const std::string& name, ProfileTarget& target) {
+    for (size_t i = 0; i < PROFILE_TARGET_COUNT; ++i) {
+        if (name == profile_target_name(static_cast<ProfileTarget>(i))) {
+            target = static_cast<ProfileTarget>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+LoadProfile::LoadProfile()
+    : data_(nullptr)
+    , size_(0)
+#ifdef _WIN32
+    , file_(INVALID_HANDLE_VALUE)
+    , mapping_(nullptr)
+#endif
+    , binary_(false)
+    , columns_(0)
+    , start_(0)
+    , base_(0.0)
+    , cursor_(0)
+    , released_(0)
+    , line_(0)
+    , start_line_(0)
+    , state_(State::EMPTY)
+    , position_(0.0)
+    , samples_(0)
+    , current_()
+    , next_()
+    , has_next_(false)
+{
+}
+
+LoadProfile::~LoadProfile() {
+    close();
+}
+
+const char* LoadProfile::state_name(State state) {
+    switch (state) {
+        case State::EMPTY: return "empty";
+        case State::IDLE: return "idle";
+        case State::PLAYING: return "playing";
+        case State::FINISHED: return "finished";
+        case State::FAILED: return "failed";
+    }
+    return "unknown";
+}
+
+bool LoadProfile::open(const std::string& path, std::string& error) {
+    close();
+    error.clear();
+    if (!map(path, error)) {
+        return false;
+    }
+
+    Header header;
+    if (size_ >= sizeof(header) && std::memcmp(data_, MAGIC, sizeof(MAGIC)) == 0) {
+        std::memcpy(&header, data_, sizeof(header));
+        size_t record = (header.columns + 1) * sizeof(double);
+        binary_ = true;
+        columns_ = header.columns;
+        start_ = sizeof(header);
+        if (header.version != VERSION) {
+            error = path + ": unsupported profile version " + std::to_string(header.version);
+        } else if (header.columns < 1 || header.columns > MAX_COLUMNS) {
+            error = path + ": profile must have 1 or 2 value columns";
+        } else if (size_ == start_ || (size_ - start_) % record != 0) {
+            error = path + ": profile has no samples or a partial record";
+        }
+    } else {
+        // The first sample, after blank lines, comments and one header line
+        binary_ = false;
+        cursor_ = 0;
+        line_ = 0;
+        bool header_seen = false;
+        while (cursor_ < size_ && columns_ == 0 && error.empty()) {
+            const char* end = static_cast<const char*>(std::memchr(data_ + cursor_, '\n', size_ - cursor_));
+            size_t length = (end ? end - data_ : size_) - cursor_;
+            std::string line(data_ + cursor_, std::min(length, MAX_LINE));
+            size_t first = line.find_first_not_of(" \t\r");
+            Sample sample;
+            size_t fields = parse_line(line.c_str(), sample);
+            if (first != std::string::npos && line[first] != '#') {
+                if (fields >= 2 && fields <= MAX_COLUMNS + 1 && length < MAX_LINE) {
+                    columns_ = fields - 1;
+                    start_ = cursor_;
+                    start_line_ = line_;
+                    break;
+                }
+                if (header_seen) {
+                    error = path + ": no samples, or a malformed one at line " + std::to_string(line_ + 1);
+                }
+                header_seen = true;
+            }
+            cursor_ += length + 1;
+            ++line_;
+        }
+        if (columns_ == 0 && error.empty()) {
+            error = path + ": profile has no samples";
+        }
+    }
+    if (!error.empty()) {
+        close();
+        return false;
+    }
+
+    cursor_ = start_;
+    line_ = start_line_;
+    read_sample(next_);
+    base_ = next_.time;
+
+    path_ = path;
+    state_ = State::IDLE;
+    seek(0.0);
+    return true;
+}
+
+void LoadProfile::close() {
+    unmap();
+    path_.clear();
+    columns_ = 0;
+    state_ = State::EMPTY;
+    error_.clear();
+    position_ = 0.0;
+    samples_ = 0;
+    current_ = Sample();
+    has_next_ = false;
+}
+
+void LoadProfile::play(double from) {
+    if (state_ == State::EMPTY) {
+        return;
+    }
+    error_.clear();
+    position_ = std::max(from, 0.0);
+    samples_ = 0;
+    seek(position_);
+    state_ = has_next_ ? State::PLAYING : State::FAILED;
+}
+
+void LoadProfile::stop() {
+    if (state_ != State::EMPTY) {
+        state_ = State::IDLE;
+    }
+}
+
+bool LoadProfile::advance(double delta_time, Sample& sample) {
+    if (state_ != State::PLAYING) {
+        return false;
+    }
+    position_ += delta_time;
+    bool passed = false;
+    while (has_next_ && next_.time <= position_) {
+        current_ = next_;
+        passed = true;
+        ++samples_;
+
+        Sample following;
+        has_next_ = read_sample(following);
+        following.time -= base_;
+        if (has_next_ && !(following.time >= next_.time)) {
+            error_ = "Sample times go backwards at " +
+                     (binary_ ? "record " + std::to_string((cursor_ - start_) / ((columns_ + 1) * sizeof(double)))
+                              : "line " + std::to_string(line_));
+            has_next_ = false;
+        }
+        next_ = following;
+        release_behind();
+    }
+    if (!has_next_) {
+        state_ = error_.empty() ? State::FINISHED : State::FAILED;
+    }
+    sample = current_;
+    return passed;
+}
+
+double LoadProfile::time_to_next_sample() const {
+    if (state_ != State::PLAYING || !has_next_) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return std::max(next_.time - position_, 0.0);
+}
+
+void LoadProfile::seek(double time) {
+    if (binary_) {
+        // Last record at or before time, so it is in effect from the start
+        const size_t record = (columns_ + 1) * sizeof(double);
+        size_t low = 0;
+        size_t high = (size_ - start_) / record;
+        while (high - low > 1) {
+            size_t middle = low + (high - low) / 2;
+            double stamp;
+            std::memcpy(&stamp, data_ + start_ + middle * record, sizeof(stamp));
+            if (stamp - base_ <= time) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        cursor_ = start_ + low * record;
+    } else {
+        cursor_ = start_;
+        line_ = start_line_;
+    }
+    released_ = std::min(released_, cursor_);
+
+    has_next_ = read_sample(next_);
+    next_.time -= base_;
+    while (has_next_ && !binary_) {
+        // Scanned up to the last line at or before time
+        size_t cursor = cursor_;
+        size_t line = line_;
+        Sample following;
+        bool read = read_sample(following);
+        following.time -= base_;
+        if (!read || following.time > time || following.time < next_.time) {
+            // Left for advance() to read again, and to report if malformed
+            cursor_ = cursor;
+            line_ = line;
+            error_.clear();
+            break;
+        }
+        next_ = following;
+    }
+}
+
+bool LoadProfile::read_sample(Sample& sample) {
+    bool read = binary_ ? read_record(sample) : read_line(sample);
+    if (read && !std::isfinite(sample.time)) {
+        error_ = "Invalid sample time";
+        return false;
+    }
+    return read;
+}
+
+bool LoadProfile::read_record(Sample& sample) {
+    const size_t record = (columns_ + 1) * sizeof(double);
+    if (cursor_ + record > size_) {
+        return false;
+    }
+    double fields[MAX_COLUMNS + 1];
+    std::memcpy(fields, data_ + cursor_, record);
+    sample.time = fields[0];
+    for (size_t i = 0; i < MAX_COLUMNS; ++i) {
+        sample.values[i] = i < columns_ ? fields[i + 1] : 0.0;
+    }
+    cursor_ += record;
+    // As a CSV line with one would not parse
+    for (size_t i = 0; i < columns_; ++i) {
+        if (!std::isfinite(sample.values[i])) {
+            error_ = "Invalid sample value at record " + std::to_string((cursor_ - start_) / record);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LoadProfile::read_line(Sample& sample) {
+    while (cursor_ < size_) {
+        const char* end = static_cast<const char*>(std::memchr(data_ + cursor_, '\n', size_ - cursor_));
+        size_t length = (end ? end - data_ : size_) - cursor_;
+        ++line_;
+        if (length >= MAX_LINE) {
+            error_ = "Line " + std::to_string(line_) + " is too long";
+            return false;
+        }
+        char line[MAX_LINE];
+        std::memcpy(line, data_ + cursor_, length);
+        line[length] = '\0';
+        cursor_ += length + 1;
+
+        const char* first = line + std::strspn(line, " \t\r");
+        if (*first == '\0' || *first == '#') {
+            continue;
+        }
+        if (parse_line(line, sample) != columns_ + 1) {
+            error_ = "Malformed sample at line " + std::to_string(line_);
+            return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+size_t LoadProfile::parse_line(const char* line, Sample& sample) const {
+    // Comma-separated numbers, with spaces around them
+    double fields[MAX_COLUMNS + 1] = {};
+    size_t count = 0;
+    const char* text = line;
+    while (true) {
+        char* end = nullptr;
+        double value = std::strtod(text, &end);
+        if (end == text || !std::isfinite(value) || count == MAX_COLUMNS + 1) {
+            return 0;
+        }
+        fields[count++] = value;
+        text = end + std::strspn(end, " \t\r");
+        if (*text == '\0') {
+            break;
+        }
+        if (*text != ',') {
+            return 0;
+        }
+        ++text;
+    }
+    sample.time = fields[0];
+    for (size_t i = 0; i < MAX_COLUMNS; ++i) {
+        sample.values[i] = fields[i + 1];
+    }
+    return count;
+}
+
+#ifdef _WIN32
+
+bool LoadProfile::map(const std::string& path, std::string& error) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        error = path + ": cannot open, or empty";
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        error = path + ": cannot map";
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const char*>(view);
+    size_ = static_cast<size_t>(size.QuadPart);
+    released_ = 0;
+    return true;
+}
+
+void LoadProfile::unmap() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+        CloseHandle(file_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+}
+
+// The working set of a read-only view is trimmed by the system
+void LoadProfile::release_behind() {}
+
+#else
+
+bool LoadProfile::map(const std::string& path, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        error = path + ": cannot read, or empty";
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(view);
+    size_ = static_cast<size_t>(info.st_size);
+    released_ = 0;
+    return true;
+}
+
+void LoadProfile::unmap() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void LoadProfile::release_behind() {
+    // Played pages are clean and come back from the file if a seek needs them
+    if (cursor_ < released_ + RELEASE_SPAN) {
+        return;
+    }
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t end = cursor_ / page * page;
+    madvise(const_cast<char*>(data_) + released_, end - released_, MADV_DONTNEED);
+    released_ = end;
+}
+
+#endif
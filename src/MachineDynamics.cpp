@@ -0,0 +1,70 @@
+#include "MachineDynamics.h"
+#include <algorithm>
+#include <limits>
+
+Governor::Governor(double inertia, double actuator_time)
+    : trip_speed_(std::numeric_limits<double>::infinity())
+    , trip_time_(-1.0)
+{
+    configure(inertia, actuator_time);
+}
+
+void Governor::configure(double inertia, double actuator_time) {
+    model_.a = {{{-DAMPING / (2.0 * inertia), 1.0 / (2.0 * inertia)},
+                 {-1.0 / (DROOP * actuator_time), -1.0 / actuator_time}}};
+    model_.b = {{{-1.0 / (2.0 * inertia)},
+                 {0.0}}};
+}
+
+void Governor::reset(double speed, double power) {
+    model_.x = {speed - 1.0, power};
+    trip_time_ = -1.0;
+}
+
+void Governor::update(double electrical_power, double delta_time) {
+    // Interpolated linearly between RK4 steps, which are short next to the
+    // swing of the speed
+    double limit = trip_speed_ - 1.0;
+    double previous_time = 0.0;
+    double previous_speed = model_.x[0];
+    trip_time_ = previous_speed > limit ? 0.0 : -1.0;
+    model_.integrate({electrical_power}, delta_time, MAX_STEP, [&](double elapsed, const Vector<2>& state) {
+        if (trip_time_ < 0.0 && state[0] > limit) {
+            trip_time_ = previous_time + (elapsed - previous_time) * (limit - previous_speed) / (state[0] - previous_speed);
+        }
+        previous_time = elapsed;
+        previous_speed = state[0];
+    });
+
+    // The fuel rack stops at its limits
+    model_.x[1] = std::min(std::max(model_.x[1], 0.0), MAX_POWER);
+}
+
+void Governor::settle(double electrical_power) {
+    model_.x = model_.equilibrium({electrical_power});
+    trip_time_ = model_.x[0] > trip_speed_ - 1.0 ? 0.0 : -1.0;
+}
+
+Exciter::Exciter()
+    : current_(0.0)
+{
+    model_.a = {{{-1.0 / EXCITER_TIME, -GAIN / EXCITER_TIME},
+                 {1.0 / FIELD_TIME, -1.0 / FIELD_TIME}}};
+    model_.b = {{{GAIN / EXCITER_TIME, GAIN * TRANSIENT_REACTANCE / EXCITER_TIME},
+                 {0.0, -(SYNCHRONOUS_REACTANCE - TRANSIENT_REACTANCE) / FIELD_TIME}}};
+}
+
+void Exciter::reset(double voltage, double current) {
+    current_ = current;
+    model_.x = {voltage + SYNCHRONOUS_REACTANCE * current, voltage + TRANSIENT_REACTANCE * current};
+}
+
+void Exciter::update(double current, double delta_time) {
+    current_ = current;
+    model_.integrate(input(current), delta_time, MAX_STEP);
+}
+
+void Exciter::settle(double current) {
+    current_ = current;
+    model_.x = model_.equilibrium(input(current));
+}
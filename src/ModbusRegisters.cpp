@@ -0,0 +1,56 @@
+#include "ModbusRegisters.h"
+#include "StatusEncoder.h"
+#include <algorithm>
+#include <cmath>
+
+static void store_register(uint8_t* registers, size_t index, uint16_t value) {
+    registers[index * 2] = static_cast<uint8_t>(value >> 8);
+    registers[index * 2 + 1] = static_cast<uint8_t>(value & 0xFF);
+}
+
+static uint16_t scale(double value, double factor) {
+    double scaled = std::round(value * factor);
+    return static_cast<uint16_t>(std::min(std::max(scaled, 0.0), 65535.0));
+}
+
+ModbusRegisters ModbusRegisters::build(const Generator::GeneratorStatus& status, double target_load, uint64_t tick) {
+    ModbusRegisters image;
+
+    auto set_input = [&image](Input reg, uint16_t value) {
+        store_register(image.input, static_cast<size_t>(reg), value);
+    };
+    uint16_t alarms = StatusEncoder::alarm_mask(status);
+    set_input(Input::STATE, static_cast<uint16_t>(status.state));
+    set_input(Input::RPM, scale(status.rpm, 1.0));
+    set_input(Input::VOLTAGE, scale(status.voltage, 10.0));
+    set_input(Input::FREQUENCY, scale(status.frequency, 100.0));
+    set_input(Input::LOAD, scale(status.load_percentage, 10.0));
+    set_input(Input::FUEL_LEVEL, scale(status.fuel_level, 10.0));
+    set_input(Input::OIL_PRESSURE, scale(status.oil_pressure, 10.0));
+    set_input(Input::COOLING_TEMP, scale(status.cooling_temp, 10.0));
+    set_input(Input::ALARMS, alarms);
+    set_input(Input::TICK_HIGH, static_cast<uint16_t>((tick >> 16) & 0xFFFF));
+    set_input(Input::TICK_LOW, static_cast<uint16_t>(tick & 0xFFFF));
+    const ElectricalReadings& electrical = status.electrical;
+    set_input(Input::VOLTAGE_AB, scale(electrical.line_voltage[0], 10.0));
+    set_input(Input::VOLTAGE_BC, scale(electrical.line_voltage[1], 10.0));
+    set_input(Input::VOLTAGE_CA, scale(electrical.line_voltage[2], 10.0));
+    set_input(Input::CURRENT_A, scale(electrical.current[0], 10.0));
+    set_input(Input::CURRENT_B, scale(electrical.current[1], 10.0));
+    set_input(Input::CURRENT_C, scale(electrical.current[2], 10.0));
+    set_input(Input::ACTIVE_POWER, scale(electrical.active_power, 1.0));
+    set_input(Input::REACTIVE_POWER, scale(electrical.reactive_power, 1.0));
+    set_input(Input::APPARENT_POWER, scale(electrical.apparent_power, 1.0));
+    set_input(Input::POWER_FACTOR, scale(electrical.power_factor, 1000.0));
+
+    store_register(image.holding, static_cast<size_t>(Holding::LOAD_SETPOINT), scale(target_load, 10.0));
+
+    image.discrete = alarms;
+    if (status.state == Generator::State::RUNNING) {
+        image.discrete |= 1u << static_cast<int>(Discrete::RUNNING);
+    }
+    if (status.state == Generator::State::FAULT) {
+        image.discrete |= 1u << static_cast<int>(Discrete::FAULT);
+    }
+    return image;
+}
@@ -0,0 +1,510 @@
+#include "ModbusServer.h"
+#include "GeneratorServer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    #define close closesocket
+    #define poll WSAPoll
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+#endif
+
+static bool set_non_blocking(int socket) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static bool would_block() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+static uint16_t read_u16(const uint8_t* data) {
+    return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+static void write_u16(uint8_t* data, uint16_t value) {
+    data[0] = static_cast<uint8_t>(value >> 8);
+    data[1] = static_cast<uint8_t>(value & 0xFF);
+}
+
+ModbusServer::ModbusServer(GeneratorServer& server)
+    : server_(server)
+    , port_(0)
+    , server_socket_(-1)
+    , commands_(COMMAND_QUEUE_SIZE)
+{
+}
+
+ModbusServer::~ModbusServer() {
+    shutdown();
+}
+
+bool ModbusServer::initialize(int port) {
+    port_ = port;
+    if (server_socket_ >= 0) {
+        std::cout << "Modbus TCP server listening on port " << port << " (adopted)" << std::endl;
+        return true;
+    }
+    return open_listener(port);
+}
+
+bool ModbusServer::open_listener(int port) {
+    server_socket_ = static_cast<int>(socket(AF_INET, SOCK_STREAM, 0));
+    if (server_socket_ < 0) {
+        std::cerr << "Failed to create Modbus socket" << std::endl;
+        return false;
+    }
+
+    int opt = 1;
+    if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0) {
+        std::cerr << "Failed to set Modbus socket options" << std::endl;
+        return false;
+    }
+
+    struct sockaddr_in server_addr;
+    std::memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (bind(server_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        std::cerr << "Failed to bind Modbus socket to port " << port << std::endl;
+        return false;
+    }
+
+    if (listen(server_socket_, LISTEN_BACKLOG) < 0) {
+        std::cerr << "Failed to listen on Modbus socket" << std::endl;
+        return false;
+    }
+
+    if (!set_non_blocking(server_socket_)) {
+        std::cerr << "Failed to make Modbus socket non-blocking" << std::endl;
+        return false;
+    }
+
+    std::cout << "Modbus TCP server listening on port " << port << std::endl;
+    return true;
+}
+
+void ModbusServer::run() {
+    std::vector<pollfd> poll_fds;
+    while (server_.running()) {
+        poll_fds.clear();
+        poll_fds.push_back({static_cast<decltype(pollfd::fd)>(server_socket_), POLLIN, 0});
+        for (const auto& connection : connections_) {
+            short events = POLLIN;
+            if (!connection.output.empty()) {
+                events |= POLLOUT;
+            }
+            poll_fds.push_back({static_cast<decltype(pollfd::fd)>(connection.socket), events, 0});
+        }
+
+        int ready = poll(poll_fds.data(), static_cast<unsigned long>(poll_fds.size()), POLL_TIMEOUT_MS);
+        if (ready < 0 && !would_block()) {
+            std::cerr << "Modbus poll() failed" << std::endl;
+            break;
+        }
+
+        for (size_t i = 0; i + 1 < poll_fds.size(); ++i) {
+            Connection& connection = connections_[i];
+            short revents = poll_fds[i + 1].revents;
+            if (connection.closed || revents == 0) {
+                continue;
+            }
+            if (revents & (POLLIN | POLLHUP)) {
+                read_from(connection);
+            }
+            if (!connection.closed && (revents & POLLOUT)) {
+                flush(connection);
+            }
+            if (!connection.closed && (revents & (POLLERR | POLLNVAL))) {
+                close_connection(connection);
+            }
+        }
+
+        if (poll_fds[0].revents & POLLIN) {
+            accept_clients();
+        }
+
+        connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                          [](const Connection& c) { return c.closed; }),
+                           connections_.end());
+    }
+}
+
+void ModbusServer::shutdown() {
+    for (auto& connection : connections_) {
+        if (!connection.closed) {
+            close(connection.socket);
+            connection.closed = true;
+        }
+    }
+    connections_.clear();
+
+    if (server_socket_ >= 0) {
+        close(server_socket_);
+        server_socket_ = -1;
+    }
+}
+
+void ModbusServer::adopt(HotRestart::Handoff& handoff, int port) {
+    // A listener bound to a different port is simply closed
+    for (const auto& descriptor : handoff.take("modbus listener ")) {
+        if (server_socket_ < 0 && descriptor.description == "modbus listener " + std::to_string(port)) {
+            server_socket_ = descriptor.fd;
+        } else {
+            HotRestart::close_socket(descriptor.fd);
+        }
+    }
+
+    for (const auto& descriptor : handoff.take("modbus client ")) {
+        // modbus client <input> <output>
+        std::istringstream fields(descriptor.description);
+        std::string component, kind, input, output;
+        fields >> component >> kind >> input >> output;
+        connections_.push_back({descriptor.fd, false, HotRestart::decode_bytes(input), HotRestart::decode_bytes(output)});
+    }
+    if (!connections_.empty()) {
+        std::cout << "Adopted " << connections_.size() << " Modbus masters" << std::endl;
+    }
+}
+
+void ModbusServer::hand_over(HotRestart::Handoff& handoff) {
+    if (server_socket_ >= 0) {
+        handoff.add("modbus listener " + std::to_string(port_), server_socket_);
+    }
+    for (auto& connection : connections_) {
+        if (connection.closed) {
+            continue;
+        }
+        if (!connection.output.empty()) {
+            flush(connection);
+        }
+        if (!connection.closed) {
+            handoff.add("modbus client " + HotRestart::encode_bytes(connection.input) + " " +
+                            HotRestart::encode_bytes(connection.output),
+                        connection.socket);
+        }
+    }
+}
+
+void ModbusServer::accept_clients() {
+    while (true) {
+        struct sockaddr_in client_addr;
+#ifdef _WIN32
+        int client_len = sizeof(client_addr);
+#else
+        socklen_t client_len = sizeof(client_addr);
+#endif
+        int client_socket = static_cast<int>(accept(server_socket_, (struct sockaddr*)&client_addr, &client_len));
+        if (client_socket < 0) {
+            if (!would_block()) {
+                std::cerr << "Failed to accept Modbus connection" << std::endl;
+            }
+            return;
+        }
+
+        if (!set_non_blocking(client_socket)) {
+            std::cerr << "Failed to make Modbus client socket non-blocking" << std::endl;
+            close(client_socket);
+            continue;
+        }
+
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+        std::cout << "Modbus master connected from " << client_ip << std::endl;
+
+        connections_.push_back({client_socket, false, std::string(), std::string()});
+    }
+}
+
+void ModbusServer::read_from(Connection& connection) {
+    char buffer[BUFFER_SIZE];
+    int bytes_received = static_cast<int>(recv(connection.socket, buffer, BUFFER_SIZE, 0));
+
+    if (bytes_received <= 0) {
+        if (bytes_received < 0 && would_block()) {
+            return;
+        }
+        close_connection(connection);
+        return;
+    }
+
+    connection.input.append(buffer, bytes_received);
+    process_input(connection);
+    if (!connection.closed && !connection.output.empty()) {
+        flush(connection);
+    }
+}
+
+void ModbusServer::flush(Connection& connection) {
+    while (!connection.output.empty()) {
+        int bytes_sent = static_cast<int>(send(connection.socket, connection.output.data(),
+                                               static_cast<int>(connection.output.size()), MSG_NOSIGNAL));
+        if (bytes_sent < 0) {
+            if (!would_block()) {
+                close_connection(connection);
+            }
+            return;
+        }
+        connection.output.erase(0, static_cast<size_t>(bytes_sent));
+    }
+}
+
+void ModbusServer::close_connection(Connection& connection) {
+    if (connection.closed) {
+        return;
+    }
+    close(connection.socket);
+    connection.closed = true;
+    connection.output.clear();
+    std::cout << "Modbus master disconnected" << std::endl;
+}
+
+void ModbusServer::process_input(Connection& connection) {
+    // Every request in this read is answered from the same tick's image
+    std::shared_ptr<const StatusSnapshot> snapshot;
+    size_t consumed = 0;
+
+    while (connection.input.size() - consumed >= MBAP_HEADER_SIZE + 1) {
+        const uint8_t* adu = reinterpret_cast<const uint8_t*>(connection.input.data()) + consumed;
+
+        // MBAP: transaction id, protocol id (0), length of unit id + PDU, unit id
+        size_t length = read_u16(adu + 4);
+        if (read_u16(adu + 2) != 0 || length < 2 || length > MAX_ADU_SIZE - 6) {
+            std::cout << "Invalid Modbus frame, closing connection" << std::endl;
+            close_connection(connection);
+            return;
+        }
+        if (connection.input.size() - consumed < length + 6) {
+            break;
+        }
+
+        if (!snapshot) {
+            snapshot = server_.snapshot();
+        }
+        handle_request(connection, adu, length + 6, snapshot->modbus);
+        consumed += length + 6;
+    }
+    connection.input.erase(0, consumed);
+
+    if (connection.output.size() > MAX_OUTPUT_SIZE) {
+        std::cout << "Modbus master is not reading responses, closing connection" << std::endl;
+        close_connection(connection);
+    }
+}
+
+void ModbusServer::handle_request(Connection& connection, const uint8_t* adu, size_t length,
+                                  const ModbusRegisters& image) {
+    const uint8_t* pdu = adu + MBAP_HEADER_SIZE;
+    size_t pdu_length = length - MBAP_HEADER_SIZE;
+    uint8_t function = pdu[0];
+
+    uint8_t response[MAX_ADU_SIZE];
+    uint8_t* response_pdu = response + MBAP_HEADER_SIZE;
+    size_t response_length = 0;
+
+    Exception exception;
+    switch (function) {
+        case 0x01:
+            exception = read_bits(pdu, pdu_length, 0, ModbusRegisters::COIL_COUNT, response_pdu, response_length);
+            break;
+        case 0x02:
+            exception = read_bits(pdu, pdu_length, image.discrete, ModbusRegisters::DISCRETE_COUNT,
+                                  response_pdu, response_length);
+            break;
+        case 0x03:
+            exception = read_registers(pdu, pdu_length, image.holding, ModbusRegisters::HOLDING_COUNT,
+                                       response_pdu, response_length);
+            break;
+        case 0x04:
+            exception = read_registers(pdu, pdu_length, image.input, ModbusRegisters::INPUT_COUNT,
+                                       response_pdu, response_length);
+            break;
+        case 0x05:
+        case 0x0F:
+            exception = write_coils(pdu, pdu_length);
+            break;
+        case 0x06:
+        case 0x10:
+            exception = write_registers(pdu, pdu_length);
+            break;
+        default:
+            exception = Exception::ILLEGAL_FUNCTION;
+            break;
+    }
+
+    if (exception != Exception::NONE) {
+        response_pdu[0] = static_cast<uint8_t>(function | 0x80);
+        response_pdu[1] = static_cast<uint8_t>(exception);
+        response_length = 2;
+    } else if (response_length == 0) {
+        // Writes echo function, address and value/quantity
+        std::memcpy(response_pdu, pdu, 5);
+        response_length = 5;
+    }
+
+    std::memcpy(response, adu, 4);  // Transaction and protocol id
+    write_u16(response + 4, static_cast<uint16_t>(response_length + 1));
+    response[6] = adu[6];           // Unit id
+    connection.output.append(reinterpret_cast<const char*>(response), MBAP_HEADER_SIZE + response_length);
+}
+
+ModbusServer::Exception ModbusServer::read_bits(const uint8_t* pdu, size_t length, uint16_t bits, size_t count,
+                                                uint8_t* response, size_t& response_length) const {
+    if (length != 5) {
+        return Exception::ILLEGAL_DATA_VALUE;
+    }
+    size_t address = read_u16(pdu + 1);
+    size_t quantity = read_u16(pdu + 3);
+    if (quantity < 1 || quantity > MAX_READ_BITS) {
+        return Exception::ILLEGAL_DATA_VALUE;
+    }
+    if (address + quantity > count) {
+        return Exception::ILLEGAL_DATA_ADDRESS;
+    }
+
+    // Every bit table fits in 16 bits, so this is at most two bytes
+    uint32_t selected = (static_cast<uint32_t>(bits) >> address) & ((1u << quantity) - 1);
+    size_t byte_count = (quantity + 7) / 8;
+    response[0] = pdu[0];
+    response[1] = static_cast<uint8_t>(byte_count);
+    for (size_t i = 0; i < byte_count; ++i) {
+        response[2 + i] = static_cast<uint8_t>((selected >> (8 * i)) & 0xFF);
+    }
+    response_length = 2 + byte_count;
+    return Exception::NONE;
+}
+
+ModbusServer::Exception ModbusServer::read_registers(const uint8_t* pdu, size_t length, const uint8_t* registers,
+                                                     size_t count, uint8_t* response,
+                                                     size_t& response_length) const {
+    if (length != 5) {
+        return Exception::ILLEGAL_DATA_VALUE;
+    }
+    size_t address = read_u16(pdu + 1);
+    size_t quantity = read_u16(pdu + 3);
+    if (quantity < 1 || quantity > MAX_READ_REGISTERS) {
+        return Exception::ILLEGAL_DATA_VALUE;
+    }
+    if (address + quantity > count) {
+        return Exception::ILLEGAL_DATA_ADDRESS;
+    }
+
+    response[0] = pdu[0];
+    response[1] = static_cast<uint8_t>(quantity * 2);
+    std::memcpy(response + 2, registers + address * 2, quantity * 2);
+    response_length = 2 + quantity * 2;
+    return Exception::NONE;
+}
+
+ModbusServer::Exception ModbusServer::write_coils(const uint8_t* pdu, size_t length) {
+    static const ServerShard::Operation::Type coil_operations[] = {
+        ServerShard::Operation::Type::START,
+        ServerShard::Operation::Type::STOP,
+        ServerShard::Operation::Type::EMERGENCY_STOP
+    };
+
+    if (length < 5) {
+        return Exception::ILLEGAL_DATA_VALUE;
+    }
+    size_t address = read_u16(pdu + 1);
+    std::vector<ServerShard::Operation> operations;
+
+    if (pdu[0] == 0x05) {
+        uint16_t value = read_u16(pdu + 3);
+        if (length != 5 || (value != 0xFF00 && value != 0x0000)) {
+            return Exception::ILLEGAL_DATA_VALUE;
+        }
+        if (address >= ModbusRegisters::COIL_COUNT) {
+            return Exception::ILLEGAL_DATA_ADDRESS;
+        }
+        if (value == 0xFF00) {
+            operations.push_back({coil_operations[address], {0.0, 0.0, 0.0}});
+        }
+    } else {
+        size_t quantity = read_u16(pdu + 3);
+        if (length < 6 || quantity < 1 || quantity > 0x07B0 || pdu[5] != (quantity + 7) / 8 ||
+            length != 6u + pdu[5]) {
+            return Exception::ILLEGAL_DATA_VALUE;
+        }
+        if (address + quantity > ModbusRegisters::COIL_COUNT) {
+            return Exception::ILLEGAL_DATA_ADDRESS;
+        }
+        // Coils switched on together are applied together, in address order
+        for (size_t i = 0; i < quantity; ++i) {
+            if (pdu[6 + i / 8] & (1u << (i % 8))) {
+                operations.push_back({coil_operations[address + i], {0.0, 0.0, 0.0}});
+            }
+        }
+    }
+
+    return operations.empty() ? Exception::NONE : submit(std::move(operations));
+}
+
+ModbusServer::Exception ModbusServer::write_registers(const uint8_t* pdu, size_t length) {
+    if (length < 5) {
+        return Exception::ILLEGAL_DATA_VALUE;
+    }
+    size_t address = read_u16(pdu + 1);
+    const uint8_t* values = pdu + 3;
+    size_t quantity = 1;
+
+    if (pdu[0] == 0x06) {
+        if (length != 5) {
+            return Exception::ILLEGAL_DATA_VALUE;
+        }
+    } else {
+        quantity = read_u16(pdu + 3);
+        if (length < 6 || quantity < 1 || quantity > 123 || pdu[5] != quantity * 2 || length != 6u + pdu[5]) {
+            return Exception::ILLEGAL_DATA_VALUE;
+        }
+        values = pdu + 6;
+    }
+    if (address + quantity > ModbusRegisters::HOLDING_COUNT) {
+        return Exception::ILLEGAL_DATA_ADDRESS;
+    }
+
+    // The only writable register is the load setpoint, in 0.1 %
+    std::vector<ServerShard::Operation> operations;
+    for (size_t i = 0; i < quantity; ++i) {
+        uint16_t value = read_u16(values + i * 2);
+        if (value > 1000) {
+            return Exception::ILLEGAL_DATA_VALUE;
+        }
+        operations.push_back({ServerShard::Operation::Type::SET_LOAD, {value / 10.0, 0.0, 0.0}});
+    }
+    return submit(std::move(operations));
+}
+
+ModbusServer::Exception ModbusServer::submit(std::vector<ServerShard::Operation> operations) {
+    bool batch = operations.size() > 1;
+    if (!commands_.try_push({0, std::move(operations), batch, {false, 0}, false})) {
+        return Exception::SERVER_DEVICE_BUSY;
+    }
+    return Exception::NONE;
+}
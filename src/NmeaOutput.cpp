@@ -0,0 +1,546 @@
+#include "NmeaOutput.h"
+#include "GeneratorServer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <thread>
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    #define close closesocket
+    #define poll WSAPoll
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <termios.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <cstdlib>
+#endif
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+#endif
+
+static bool set_non_blocking(int socket) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static bool would_block() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+static const char* const ALARM_TEXT[] = {
+    "GENERATOR OVERLOAD",
+    "HIGH COOLANT TEMPERATURE",
+    "LOW OIL PRESSURE",
+    "LOW FUEL LEVEL",
+    "HIGH VIBRATION",
+    "OVERSPEED"
+};
+
+NmeaOutput::Config::Config()
+    : tcp_port(0)
+    , udp_port(0)
+    , pty(false)
+    , rates{5.0, 2.0, 1.0, 1.0}
+{
+}
+
+NmeaOutput::NmeaOutput(GeneratorServer& server)
+    : server_(server)
+    , tcp_socket_(-1)
+    , udp_socket_(-1)
+    , pty_fd_(-1)
+    , pty_slave_fd_(-1)
+    , buffer_tick_(0)
+    , offsets_{}
+{
+}
+
+NmeaOutput::~NmeaOutput() {
+    shutdown();
+}
+
+bool NmeaOutput::initialize(const Config& config) {
+    config_ = config;
+    if (config.tcp_port > 0 && tcp_socket_ < 0 && !open_tcp(config.tcp_port)) {
+        return false;
+    }
+    if (!config.udp_host.empty() && !open_udp(config.udp_host, config.udp_port)) {
+        return false;
+    }
+    if (config.pty && pty_fd_ < 0 && !open_pty()) {
+        return false;
+    }
+
+    auto now = Clock::now();
+    for (auto& due : next_due_) {
+        due = now;
+    }
+    return true;
+}
+
+bool NmeaOutput::open_tcp(int port) {
+    tcp_socket_ = static_cast<int>(socket(AF_INET, SOCK_STREAM, 0));
+    if (tcp_socket_ < 0) {
+        std::cerr << "Failed to create NMEA socket" << std::endl;
+        return false;
+    }
+
+    int opt = 1;
+    if (setsockopt(tcp_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0) {
+        std::cerr << "Failed to set NMEA socket options" << std::endl;
+        return false;
+    }
+
+    struct sockaddr_in server_addr;
+    std::memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (bind(tcp_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        std::cerr << "Failed to bind NMEA socket to port " << port << std::endl;
+        return false;
+    }
+    if (listen(tcp_socket_, LISTEN_BACKLOG) < 0 || !set_non_blocking(tcp_socket_)) {
+        std::cerr << "Failed to listen on NMEA socket" << std::endl;
+        return false;
+    }
+
+    std::cout << "NMEA output listening on TCP port " << port << std::endl;
+    return true;
+}
+
+bool NmeaOutput::open_udp(const std::string& host, int port) {
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || result == nullptr) {
+        std::cerr << "Failed to resolve NMEA UDP destination " << host << std::endl;
+        return false;
+    }
+    const uint8_t* address = reinterpret_cast<const uint8_t*>(result->ai_addr);
+    udp_address_.assign(address, address + result->ai_addrlen);
+    freeaddrinfo(result);
+
+    udp_socket_ = static_cast<int>(socket(AF_INET, SOCK_DGRAM, 0));
+    if (udp_socket_ < 0) {
+        std::cerr << "Failed to create NMEA UDP socket" << std::endl;
+        return false;
+    }
+
+    // Bridge systems usually listen on a broadcast address
+    int opt = 1;
+    if (setsockopt(udp_socket_, SOL_SOCKET, SO_BROADCAST, reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0 ||
+        !set_non_blocking(udp_socket_)) {
+        std::cerr << "Failed to set NMEA UDP socket options" << std::endl;
+        return false;
+    }
+
+    std::cout << "NMEA output sending UDP to " << host << ":" << port << std::endl;
+    return true;
+}
+
+bool NmeaOutput::open_pty() {
+#ifdef _WIN32
+    std::cerr << "NMEA pseudo-terminal output is not supported on this platform" << std::endl;
+    return false;
+#else
+    pty_fd_ = posix_openpt(O_RDWR | O_NOCTTY);
+    if (pty_fd_ < 0 || grantpt(pty_fd_) != 0 || unlockpt(pty_fd_) != 0) {
+        std::cerr << "Failed to create NMEA pseudo-terminal" << std::endl;
+        return false;
+    }
+    const char* slave_name = ptsname(pty_fd_);
+    if (slave_name == nullptr) {
+        std::cerr << "Failed to name NMEA pseudo-terminal" << std::endl;
+        return false;
+    }
+
+    // Raw mode: no echo back to us and no CR/LF translation
+    pty_slave_fd_ = open(slave_name, O_RDWR | O_NOCTTY);
+    struct termios settings;
+    if (pty_slave_fd_ < 0 || tcgetattr(pty_slave_fd_, &settings) != 0) {
+        std::cerr << "Failed to configure NMEA pseudo-terminal" << std::endl;
+        return false;
+    }
+    cfmakeraw(&settings);
+    cfsetispeed(&settings, B4800);
+    cfsetospeed(&settings, B4800);
+    if (tcsetattr(pty_slave_fd_, TCSANOW, &settings) != 0 || !set_non_blocking(pty_fd_)) {
+        std::cerr << "Failed to configure NMEA pseudo-terminal" << std::endl;
+        return false;
+    }
+
+    std::cout << "NMEA output on pseudo-terminal " << slave_name << std::endl;
+    return true;
+#endif
+}
+
+void NmeaOutput::adopt(HotRestart::Handoff& handoff, const Config& config) {
+    // Only what the new configuration still asks for is kept
+    for (const auto& descriptor : handoff.take("nmea listener ")) {
+        if (tcp_socket_ < 0 && config.tcp_port > 0 &&
+            descriptor.description == "nmea listener " + std::to_string(config.tcp_port)) {
+            tcp_socket_ = descriptor.fd;
+            std::cout << "NMEA output listening on TCP port " << config.tcp_port << " (adopted)" << std::endl;
+        } else {
+            HotRestart::close_socket(descriptor.fd);
+        }
+    }
+    for (const auto& descriptor : handoff.take("nmea client")) {
+        if (config.tcp_port > 0) {
+            // nmea client <output>
+            clients_.push_back({descriptor.fd, false, HotRestart::decode_bytes(descriptor.description.substr(12)), 0});
+        } else {
+            HotRestart::close_socket(descriptor.fd);
+        }
+    }
+
+    // Bridge systems keep reading the same terminal device
+    for (const auto& descriptor : handoff.take("nmea pty")) {
+        int& fd = descriptor.description == "nmea pty" ? pty_fd_ : pty_slave_fd_;
+        if (config.pty && fd < 0) {
+            fd = descriptor.fd;
+        } else {
+            HotRestart::close_socket(descriptor.fd);
+        }
+    }
+#ifndef _WIN32
+    if (pty_fd_ >= 0) {
+        const char* slave_name = ptsname(pty_fd_);
+        std::cout << "NMEA output on pseudo-terminal " << (slave_name != nullptr ? slave_name : "?")
+                  << " (adopted)" << std::endl;
+    }
+#endif
+}
+
+void NmeaOutput::hand_over(HotRestart::Handoff& handoff) {
+    if (tcp_socket_ >= 0) {
+        handoff.add("nmea listener " + std::to_string(config_.tcp_port), tcp_socket_);
+    }
+    for (auto& client : clients_) {
+        if (!client.closed && !client.output.empty()) {
+            flush(client);
+        }
+        if (!client.closed) {
+            handoff.add("nmea client " + HotRestart::encode_bytes(client.output), client.socket);
+        }
+    }
+    if (pty_fd_ >= 0) {
+        handoff.add("nmea pty", pty_fd_);
+    }
+    if (pty_slave_fd_ >= 0) {
+        handoff.add("nmea pty-slave", pty_slave_fd_);
+    }
+}
+
+void NmeaOutput::run() {
+    std::vector<pollfd> poll_fds;
+    while (server_.running()) {
+        poll_fds.clear();
+        if (tcp_socket_ >= 0) {
+            poll_fds.push_back({static_cast<decltype(pollfd::fd)>(tcp_socket_), POLLIN, 0});
+        }
+        size_t first_client = poll_fds.size();
+        for (const auto& client : clients_) {
+            short events = POLLIN;
+            if (!client.output.empty()) {
+                events |= POLLOUT;
+            }
+            poll_fds.push_back({static_cast<decltype(pollfd::fd)>(client.socket), events, 0});
+        }
+
+        int timeout = poll_timeout_ms();
+        if (poll_fds.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+        } else if (poll(poll_fds.data(), static_cast<unsigned long>(poll_fds.size()), timeout) < 0 &&
+                   !would_block()) {
+            std::cerr << "NMEA poll() failed" << std::endl;
+            break;
+        }
+
+        for (size_t i = first_client; i < poll_fds.size(); ++i) {
+            service_client(clients_[i - first_client], poll_fds[i].revents);
+        }
+        if (tcp_socket_ >= 0 && (poll_fds[0].revents & POLLIN)) {
+            accept_clients();
+        }
+
+        emit_due();
+
+        clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+                                      [](const Client& c) { return c.closed; }),
+                       clients_.end());
+    }
+}
+
+void NmeaOutput::shutdown() {
+    for (auto& client : clients_) {
+        close_client(client);
+    }
+    clients_.clear();
+
+    if (tcp_socket_ >= 0) {
+        close(tcp_socket_);
+        tcp_socket_ = -1;
+    }
+    if (udp_socket_ >= 0) {
+        close(udp_socket_);
+        udp_socket_ = -1;
+    }
+#ifndef _WIN32
+    for (int* fd : {&pty_fd_, &pty_slave_fd_}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+#endif
+}
+
+void NmeaOutput::accept_clients() {
+    while (true) {
+        struct sockaddr_in client_addr;
+#ifdef _WIN32
+        int client_len = sizeof(client_addr);
+#else
+        socklen_t client_len = sizeof(client_addr);
+#endif
+        int client_socket = static_cast<int>(accept(tcp_socket_, (struct sockaddr*)&client_addr, &client_len));
+        if (client_socket < 0) {
+            if (!would_block()) {
+                std::cerr << "Failed to accept NMEA connection" << std::endl;
+            }
+            return;
+        }
+        if (!set_non_blocking(client_socket)) {
+            close(client_socket);
+            continue;
+        }
+
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+        std::cout << "NMEA listener connected from " << client_ip << std::endl;
+        clients_.push_back({client_socket, false, std::string(), 0});
+    }
+}
+
+void NmeaOutput::service_client(Client& client, short revents) {
+    if (client.closed || revents == 0) {
+        return;
+    }
+    if (revents & (POLLIN | POLLHUP)) {
+        // Listeners have nothing to say; anything they send is discarded
+        char buffer[256];
+        int bytes_received = static_cast<int>(recv(client.socket, buffer, sizeof(buffer), 0));
+        if (bytes_received == 0 || (bytes_received < 0 && !would_block())) {
+            close_client(client);
+            return;
+        }
+    }
+    if (revents & POLLOUT) {
+        flush(client);
+    }
+    if (!client.closed && (revents & (POLLERR | POLLNVAL))) {
+        close_client(client);
+    }
+}
+
+void NmeaOutput::flush(Client& client) {
+    while (!client.output.empty()) {
+        int bytes_sent = static_cast<int>(send(client.socket, client.output.data(),
+                                               static_cast<int>(client.output.size()), MSG_NOSIGNAL));
+        if (bytes_sent < 0) {
+            if (!would_block()) {
+                close_client(client);
+            }
+            return;
+        }
+        client.output.erase(0, static_cast<size_t>(bytes_sent));
+    }
+}
+
+void NmeaOutput::close_client(Client& client) {
+    if (client.closed) {
+        return;
+    }
+    close(client.socket);
+    client.closed = true;
+    std::cout << "NMEA listener disconnected (" << client.dropped << " sentences dropped)" << std::endl;
+}
+
+void NmeaOutput::emit_due() {
+    auto now = Clock::now();
+    auto snapshot = server_.snapshot();
+    due_.clear();
+
+    for (size_t i = 0; i < static_cast<size_t>(Sentence::COUNT); ++i) {
+        double rate = config_.rates[i];
+        if (rate <= 0.0 || now < next_due_[i]) {
+            continue;
+        }
+
+        // All sinks share one formatted copy of this tick's sentences
+        if (snapshot->tick != buffer_tick_ || buffer_.empty()) {
+            format_tick(snapshot->status, snapshot->tick);
+        }
+        due_.append(buffer_, offsets_[i], offsets_[i + 1] - offsets_[i]);
+
+        // Stay on the rate grid, but never try to catch up on missed slots
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+        next_due_[i] += period;
+        if (next_due_[i] <= now) {
+            next_due_[i] = now + period;
+        }
+    }
+
+    if (!due_.empty()) {
+        write_all(due_);
+    }
+}
+
+void NmeaOutput::format_tick(const Generator::GeneratorStatus& status, uint64_t tick) {
+    char body[96];
+    buffer_.clear();
+
+    offsets_[static_cast<size_t>(Sentence::RPM)] = buffer_.size();
+    std::snprintf(body, sizeof(body), "ERRPM,E,1,%.1f,,A", status.rpm);
+    buffer_ += format_sentence(body);
+
+    offsets_[static_cast<size_t>(Sentence::ELECTRICAL)] = buffer_.size();
+    std::snprintf(body, sizeof(body), "ERXDR,U,%.1f,V,GEN1,F,%.2f,H,GEN1,G,%.1f,P,GEN1LOAD",
+                  status.voltage, status.frequency, status.load_percentage);
+    buffer_ += format_sentence(body);
+
+    offsets_[static_cast<size_t>(Sentence::ENGINE)] = buffer_.size();
+    std::snprintf(body, sizeof(body), "ERXDR,C,%.1f,C,ENGINE1,P,%.2f,B,ENGINE1,V,%.1f,P,FUEL1",
+                  status.cooling_temp, status.oil_pressure, status.fuel_level);
+    buffer_ += format_sentence(body);
+
+    // ALR time field is UTC hhmmss.ss
+    std::time_t now = std::time(nullptr);
+    std::tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+
+    offsets_[static_cast<size_t>(Sentence::ALARMS)] = buffer_.size();
+    for (size_t i = 0; i < sizeof(ALARM_TEXT) / sizeof(ALARM_TEXT[0]); ++i) {
+        bool active = false;
+        for (const auto& alarm : status.active_alarms) {
+            active = active || static_cast<size_t>(alarm.type) == i;
+        }
+        // Condition A = threshold exceeded; active alarms are unacknowledged
+        std::snprintf(body, sizeof(body), "ERALR,%02d%02d%02d.00,%03zu,%c,%c,%s",
+                      utc.tm_hour, utc.tm_min, utc.tm_sec, i + 1,
+                      active ? 'A' : 'V', active ? 'V' : 'A', ALARM_TEXT[i]);
+        buffer_ += format_sentence(body);
+    }
+    offsets_[static_cast<size_t>(Sentence::COUNT)] = buffer_.size();
+
+    buffer_tick_ = tick;
+}
+
+void NmeaOutput::write_all(const std::string& data) {
+    for (auto& client : clients_) {
+        if (client.closed) {
+            continue;
+        }
+        // Whole sentences or nothing, so a lagging listener never sees a torn line
+        if (client.output.size() + data.size() > MAX_CLIENT_OUTPUT) {
+            ++client.dropped;
+            continue;
+        }
+        bool was_empty = client.output.empty();
+        client.output += data;
+        if (was_empty) {
+            flush(client);
+        }
+    }
+
+    if (udp_socket_ >= 0) {
+        sendto(udp_socket_, data.data(), static_cast<int>(data.size()), 0,
+               reinterpret_cast<const struct sockaddr*>(udp_address_.data()),
+               static_cast<socklen_t>(udp_address_.size()));
+    }
+
+#ifndef _WIN32
+    if (pty_fd_ >= 0 && write(pty_fd_, data.data(), data.size()) < 0) {
+        // Nobody reading the terminal just means the sentences are lost
+    }
+#endif
+}
+
+int NmeaOutput::poll_timeout_ms() const {
+    auto now = Clock::now();
+    auto timeout = std::chrono::milliseconds(IDLE_POLL_TIMEOUT_MS);
+    for (size_t i = 0; i < static_cast<size_t>(Sentence::COUNT); ++i) {
+        if (config_.rates[i] > 0.0) {
+            auto until_due = std::chrono::duration_cast<std::chrono::milliseconds>(next_due_[i] - now);
+            timeout = std::min(timeout, std::max(until_due, std::chrono::milliseconds(0)));
+        }
+    }
+    return static_cast<int>(timeout.count());
+}
+
+std::string NmeaOutput::format_sentence(const std::string& body) {
+    char trailer[6];
+    std::snprintf(trailer, sizeof(trailer), "*%02X\r\n", checksum(body.data(), body.size()));
+    return "$" + body + trailer;
+}
+
+uint8_t NmeaOutput::checksum(const char* body, size_t length) {
+    // XOR of every character between '$' and '*'
+    uint8_t sum = 0;
+    for (size_t i = 0; i < length; ++i) {
+        sum ^= static_cast<uint8_t>(body[i]);
+    }
+    return sum;
+}
+
+const char* NmeaOutput::sentence_name(Sentence sentence) {
+    switch (sentence) {
+        case Sentence::RPM: return "rpm";
+        case Sentence::ELECTRICAL: return "electrical";
+        case Sentence::ENGINE: return "engine";
+        case Sentence::ALARMS: return "alarms";
+        case Sentence::COUNT: break;
+    }
+    return "unknown";
+}
+
+bool NmeaOutput::parse_sentence(const std::string& name, Sentence& sentence) {
+    for (int i = 0; i < static_cast<int>(Sentence::COUNT); ++i) {
+        if (name == sentence_name(static_cast<Sentence>(i))) {
+            sentence = static_cast<Sentence>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,145 @@
+#include "OutputQueue.h"
+#include <algorithm>
+
+OutputQueue::OutputQueue()
+    : front_offset_(0)
+    , bytes_(0)
+    , policy_(Policy::CONFLATE)
+    , max_frames_(DEFAULT_MAX_FRAMES)
+    , max_bytes_(DEFAULT_MAX_BYTES)
+    , high_watermark_(0)
+    , dropped_(0)
+    , conflated_(0)
+{
+}
+
+bool OutputQueue::push(const Frame& frame, Kind kind) {
+    // A pending status frame is superseded in place, keeping reply order intact
+    if (kind == Kind::STATUS && policy_ == Policy::CONFLATE) {
+        for (size_t i = entries_.size(); i-- > 0;) {
+            if (entries_[i].kind == Kind::STATUS && !in_flight(i)) {
+                bytes_ -= entries_[i].frame->size();
+                entries_[i].frame = frame;
+                bytes_ += frame->size();
+                ++conflated_;
+                return true;
+            }
+        }
+    }
+
+    entries_.push_back({frame, kind});
+    bytes_ += frame->size();
+
+    // Control frames are tiny and must reach the peer
+    while (kind != Kind::CONTROL && over_limit()) {
+        if (policy_ == Policy::DISCONNECT) {
+            return false;
+        }
+        if (!drop_oldest(policy_ == Policy::CONFLATE)) {
+            // Conflating status frames cannot help a client that is not
+            // reading its replies either
+            if (policy_ == Policy::CONFLATE) {
+                return false;
+            }
+            break;
+        }
+    }
+
+    high_watermark_ = std::max(high_watermark_, entries_.size());
+    return true;
+}
+
+bool OutputQueue::empty() const {
+    return entries_.empty();
+}
+
+bool OutputQueue::has_pending_status() const {
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].kind == Kind::STATUS && !in_flight(i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* OutputQueue::pending_data() const {
+    return entries_.front().frame->data() + front_offset_;
+}
+
+size_t OutputQueue::pending_size() const {
+    return entries_.front().frame->size() - front_offset_;
+}
+
+void OutputQueue::consume(size_t bytes) {
+    bytes_ -= bytes;
+    front_offset_ += bytes;
+    if (front_offset_ == entries_.front().frame->size()) {
+        entries_.pop_front();
+        front_offset_ = 0;
+    }
+}
+
+void OutputQueue::clear() {
+    entries_.clear();
+    front_offset_ = 0;
+    bytes_ = 0;
+}
+
+std::string OutputQueue::unsent() const {
+    std::string data;
+    data.reserve(bytes_);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        data.append(*entries_[i].frame, i == 0 ? front_offset_ : 0, std::string::npos);
+    }
+    return data;
+}
+
+void OutputQueue::set_policy(Policy policy) {
+    policy_ = policy;
+}
+
+void OutputQueue::set_limits(size_t max_frames, size_t max_bytes) {
+    max_frames_ = max_frames;
+    max_bytes_ = max_bytes;
+}
+
+const char* OutputQueue::policy_name(Policy policy) {
+    switch (policy) {
+        case Policy::CONFLATE: return "conflate";
+        case Policy::DROP_OLDEST: return "drop_oldest";
+        case Policy::DISCONNECT: return "disconnect";
+    }
+    return "unknown";
+}
+
+bool OutputQueue::parse_policy(const std::string& name, Policy& policy) {
+    if (name == "conflate") {
+        policy = Policy::CONFLATE;
+    } else if (name == "drop_oldest") {
+        policy = Policy::DROP_OLDEST;
+    } else if (name == "disconnect") {
+        policy = Policy::DISCONNECT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool OutputQueue::over_limit() const {
+    return entries_.size() > max_frames_ || bytes_ > max_bytes_;
+}
+
+bool OutputQueue::drop_oldest(bool status_only) {
+    // Never drop the frame being written or the one just queued
+    for (size_t i = 0; i + 1 < entries_.size(); ++i) {
+        const Entry& entry = entries_[i];
+        if (in_flight(i) || entry.kind == Kind::CONTROL || (status_only && entry.kind != Kind::STATUS)) {
+            continue;
+        }
+        bytes_ -= entry.frame->size();
+        entries_.erase(entries_.begin() + static_cast<std::ptrdiff_t>(i));
+        ++dropped_;
+        return true;
+    }
+    return false;
+}
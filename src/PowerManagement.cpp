@@ -0,0 +1,250 @@
+#include "PowerManagement.h"
+#include <algorithm>
+#include <limits>
+
+static constexpr size_t NO_UNIT = Switchboard::MAX_UNITS;
+static constexpr double NEVER = std::numeric_limits<double>::infinity();
+
+PowerManagement::PowerManagement()
+    : enabled_(false)
+    , changed_(false)
+    , shed_tiers_(0)
+    , action_(Action::NONE)
+    , action_deadline_(NEVER)
+    , deadline_(NEVER)
+    , band_low_(-NEVER)
+    , band_high_(NEVER)
+    , evaluations_(0)
+{
+    for (size_t i = 0; i < Switchboard::MAX_UNITS; ++i) {
+        external_[i] = false;
+        priorities_[i] = static_cast<int>(i) + 1;
+        states_[i] = UnitState::STANDBY;
+        start_deadlines_[i] = NEVER;
+    }
+    for (size_t i = 0; i < MAX_TIERS; ++i) {
+        tiers_[i] = 0.0;
+    }
+}
+
+bool PowerManagement::set_priority(size_t unit, int priority) {
+    if (unit >= Switchboard::MAX_UNITS || priority < 0 || priority > MAX_PRIORITY) {
+        return false;
+    }
+    priorities_[unit] = priority;
+    if (priority == 0) {
+        states_[unit] = UnitState::MANUAL;
+    } else if (states_[unit] == UnitState::MANUAL) {
+        // Picked up as online on the next evaluation if it is running
+        states_[unit] = UnitState::STANDBY;
+    }
+    changed_ = true;
+    return true;
+}
+
+bool PowerManagement::set_tier(size_t tier, double kw) {
+    if (tier >= MAX_TIERS || !(kw >= 0.0)) {
+        return false;
+    }
+    tiers_[tier] = kw;
+    changed_ = true;
+    return true;
+}
+
+void PowerManagement::enable(Switchboard::Bus& bus) {
+    for (size_t i = 0; i < Switchboard::MAX_UNITS; ++i) {
+        if (priorities_[i] == 0) {
+            states_[i] = UnitState::MANUAL;
+        } else {
+            states_[i] = i < bus.unit_count && bus.connected(i) ? UnitState::ONLINE : UnitState::STANDBY;
+        }
+        start_deadlines_[i] = NEVER;
+    }
+    shed_tiers_ = 0;
+    bus.shed_kw = 0.0;
+    action_ = Action::NONE;
+    action_deadline_ = NEVER;
+    enabled_ = true;
+    changed_ = true;
+}
+
+void PowerManagement::disable(Switchboard::Bus& bus) {
+    shed_tiers_ = 0;
+    bus.shed_kw = 0.0;
+    action_ = Action::NONE;
+    enabled_ = false;
+}
+
+size_t PowerManagement::evaluate(Switchboard::Bus& bus, double now, Request* requests) {
+    changed_ = false;
+    ++evaluations_;
+    size_t count = 0;
+    update_units(bus, now, requests, count);
+
+    // Capacity of whatever is on the bus, units run by the operator included
+    double capacity = 0.0;
+    bool starting = false;
+    size_t standby = NO_UNIT;
+    size_t last = NO_UNIT;
+    for (size_t i = 0; i < bus.unit_count; ++i) {
+        if (bus.connected(i)) {
+            capacity += bus.units[i].rated_kw;
+        }
+        if (states_[i] == UnitState::STARTING) {
+            starting = true;
+        } else if (states_[i] == UnitState::STANDBY && bus.breaker_closed[i] &&
+                   (standby == NO_UNIT || priorities_[i] < priorities_[standby])) {
+            standby = i;
+        } else if (states_[i] == UnitState::ONLINE && (last == NO_UNIT || priorities_[i] >= priorities_[last])) {
+            last = i;
+        }
+    }
+    double remaining = last == NO_UNIT ? 0.0 : capacity - bus.units[last].rated_kw;
+
+    // Shedding never waits
+    bool overloaded = bus.load_kw() - shed_kw() > capacity;
+    while (shed_tiers_ < MAX_TIERS && bus.load_kw() - shed_kw() > capacity) {
+        ++shed_tiers_;
+    }
+    bus.shed_kw = shed_kw();
+    double served = bus.load_kw() - bus.shed_kw;
+
+    // Shed load counts as wanted back, so more capacity is started for it
+    // first; at most one timed action at a time, and a changed decision
+    // restarts its timer
+    double wanted = served + (shed_tiers_ > 0 ? tiers_[shed_tiers_ - 1] : 0.0);
+    Action action = Action::NONE;
+    double delay = 0.0;
+    if (!starting && standby != NO_UNIT && wanted > capacity * START_LOAD) {
+        action = Action::START;
+        delay = overloaded || shed_tiers_ > 0 ? 0.0 : START_DELAY;
+    } else if (shed_tiers_ > 0 && wanted <= capacity * START_LOAD) {
+        action = Action::RESTORE;
+        delay = RESTORE_DELAY;
+    } else if (!starting && shed_tiers_ == 0 && remaining > 0.0 && served <= remaining * STOP_LOAD) {
+        action = Action::STOP;
+        delay = STOP_DELAY;
+    }
+    if (action != action_) {
+        action_ = action;
+        action_deadline_ = now + delay;
+    } else {
+        action_deadline_ = std::min(action_deadline_, now + delay);
+    }
+
+    if (action_ != Action::NONE && now >= action_deadline_) {
+        if (action_ == Action::START) {
+            states_[standby] = UnitState::STARTING;
+            start_deadlines_[standby] = now + (external_[standby] ? START_TIMEOUT : UNIT_START_TIME);
+            if (external_[standby]) {
+                requests[count++] = {standby, true};
+            }
+        } else if (action_ == Action::STOP) {
+            states_[last] = UnitState::STANDBY;
+            if (external_[last]) {
+                requests[count++] = {last, false};
+            } else {
+                bus.running[last] = false;
+            }
+        } else {
+            --shed_tiers_;
+            bus.shed_kw = shed_kw();
+        }
+
+        // The bus has changed under every threshold; look again next tick
+        action_ = Action::NONE;
+        changed_ = true;
+        return count;
+    }
+
+    // Crossing any of these thresholds changes a decision above
+    double thresholds[3];
+    size_t threshold_count = 0;
+    thresholds[threshold_count++] = capacity + bus.shed_kw;
+    if ((!starting && standby != NO_UNIT) || shed_tiers_ > 0) {
+        thresholds[threshold_count++] = capacity * START_LOAD + bus.load_kw() - wanted;
+    }
+    if (!starting && shed_tiers_ == 0 && remaining > 0.0) {
+        thresholds[threshold_count++] = remaining * STOP_LOAD;
+    }
+    band_low_ = -NEVER;
+    band_high_ = NEVER;
+    for (size_t i = 0; i < threshold_count; ++i) {
+        if (thresholds[i] < bus.load_kw()) {
+            band_low_ = std::max(band_low_, thresholds[i]);
+        } else {
+            band_high_ = std::min(band_high_, thresholds[i]);
+        }
+    }
+
+    deadline_ = action_ == Action::NONE ? NEVER : action_deadline_;
+    for (size_t i = 0; i < bus.unit_count; ++i) {
+        if (states_[i] == UnitState::STARTING) {
+            deadline_ = std::min(deadline_, start_deadlines_[i]);
+        }
+    }
+    return count;
+}
+
+void PowerManagement::update_units(Switchboard::Bus& bus, double now, Request* requests, size_t& count) {
+    for (size_t i = 0; i < bus.unit_count; ++i) {
+        bool connected = bus.connected(i);
+        switch (states_[i]) {
+            case UnitState::STANDBY:
+                // Started by the operator
+                if (connected) {
+                    states_[i] = UnitState::ONLINE;
+                }
+                break;
+
+            case UnitState::STARTING:
+                if (connected) {
+                    states_[i] = UnitState::ONLINE;
+                } else if (now >= start_deadlines_[i]) {
+                    if (!external_[i] && bus.breaker_closed[i]) {
+                        bus.running[i] = true;
+                        states_[i] = UnitState::ONLINE;
+                    } else {
+                        states_[i] = UnitState::BLOCKED;
+                        if (external_[i]) {
+                            requests[count++] = {i, false};
+                        }
+                    }
+                }
+                break;
+
+            case UnitState::ONLINE:
+                // Left the bus without being asked: a trip
+                if (!connected) {
+                    states_[i] = UnitState::BLOCKED;
+                    if (!external_[i]) {
+                        bus.running[i] = false;
+                    }
+                }
+                break;
+
+            case UnitState::MANUAL:
+            case UnitState::BLOCKED:
+                break;
+        }
+    }
+}
+
+double PowerManagement::shed_kw() const {
+    double kw = 0.0;
+    for (size_t i = 0; i < shed_tiers_; ++i) {
+        kw += tiers_[i];
+    }
+    return kw;
+}
+
+const char* PowerManagement::state_name(UnitState state) {
+    switch (state) {
+        case UnitState::MANUAL: return "manual";
+        case UnitState::STANDBY: return "standby";
+        case UnitState::STARTING: return "starting";
+        case UnitState::ONLINE: return "online";
+        case UnitState::BLOCKED: return "blocked";
+    }
+    return "unknown";
+}
@@ -1,188 +1,275 @@
 #include "Sensors.h"
+#include <algorithm>
 #include <cmath>
 #include <random>
 #include <chrono>
+#include <limits>
+#include <sstream>
 
 // Static random number generator for sensor noise
 static std::random_device rd;
 static std::mt19937 gen(rd());
 static std::normal_distribution<double> noise_dist(0.0, 1.0);
 
-Sensors::Sensors()
+template <typename Model>
+BasicSensors<Model>::BasicSensors()
     : fuel_sensor_failed_(false)
     , oil_sensor_failed_(false)
     , temp_sensor_failed_(false)
     , fuel_calibration_drift_(0.0)
     , oil_calibration_drift_(0.0)
     , temp_calibration_drift_(0.0)
+    , temp_offset_(0.0)
 {
     // Initialize sensor readings to realistic values
     current_readings_.fuel_level = 100.0;  // Start at 100%
     current_readings_.oil_pressure = 3.0;
     current_readings_.cooling_temp = 25.0;
+    current_readings_.oil_temp = 25.0;
     current_readings_.vibration = 0.0;
     current_readings_.exhaust_temp = 25.0;
     current_readings_.ambient_temp = 25.0;
     current_readings_.humidity = 60.0;
+
+    thermal_ = {25.0, 25.0, 25.0};
+    fuel_level_ = current_readings_.fuel_level;
+    oil_pressure_ = current_readings_.oil_pressure;
+    vibration_ = current_readings_.vibration;
+    reset_channels();
+
+    set_spec(GeneratorSpec::defaults(Model::TYPE));
+    spectrum_ = VibrationSpectrum();
+    spectrum_.sample_rate = spec_.vibration_sample_rate;
+}
+
+template <typename Model>
+void BasicSensors<Model>::set_spec(const GeneratorSpec& spec) {
+    spec_ = spec.sensors;
+    // g/kWh at rated_power * load / 100 kW, in kg/s, over the tank mass
+    fuel_factor_ = spec.rated_power / 100.0 / 3.6e6 / (spec_.fuel_density * spec_.tank_volume) * 100.0;
+    thermal_coefficients_ = ThermalCoefficients::from(spec_.thermal, spec.high_cooling_temp);
+    fuel_channel_.set_rate(spec_.fuel_sample_rate);
+    oil_pressure_channel_.set_rate(spec_.oil_pressure_sample_rate);
+    cooling_temp_channel_.set_rate(spec_.temp_sample_rate);
+    oil_temp_channel_.set_rate(spec_.temp_sample_rate);
+    exhaust_temp_channel_.set_rate(spec_.temp_sample_rate);
+    vibration_channel_.set_rate(spec_.vibration_sample_rate);
+    rated_shaft_speed_ = spec.max_rpm / 60.0;
 }
 
-Sensors::SensorReadings Sensors::get_readings() const {
+template <typename Model>
+void BasicSensors<Model>::reset_channels() {
+    fuel_channel_.set_reading(current_readings_.fuel_level);
+    oil_pressure_channel_.set_reading(current_readings_.oil_pressure);
+    cooling_temp_channel_.set_reading(current_readings_.cooling_temp);
+    oil_temp_channel_.set_reading(current_readings_.oil_temp);
+    exhaust_temp_channel_.set_reading(current_readings_.exhaust_temp);
+    vibration_channel_.set_reading(current_readings_.vibration);
+}
+
+template <typename Model>
+SensorTypes::SensorReadings BasicSensors<Model>::get_readings() const {
     return current_readings_;
 }
 
-void Sensors::update(double delta_time, bool generator_running, double load_percentage) {
-    if (generator_running) {
-        update_fuel_sensor(delta_time, generator_running, load_percentage);
-        update_oil_pressure_sensor(delta_time, generator_running, load_percentage);
-        update_temperature_sensors(delta_time, generator_running, load_percentage);
-        update_vibration_sensor(delta_time, generator_running, load_percentage);
-    } else {
-        // Generator stopped - sensors return to ambient values
-        current_readings_.oil_pressure = 0.0;
-        current_readings_.cooling_temp = current_readings_.ambient_temp;
-        current_readings_.vibration = 0.0;
-        current_readings_.exhaust_temp = current_readings_.ambient_temp;
-    }
+template <typename Model>
+void BasicSensors<Model>::update(double delta_time, bool generator_running, double load_percentage,
+                                 double shaft_speed) {
+    // When the generator is stopped pressure and vibration drop at once
+    // and the engine cools down through the thermal network
+    update_fuel_sensor(delta_time);
+    update_oil_pressure_sensor(delta_time, generator_running, load_percentage);
+    update_temperature_sensors(delta_time, generator_running, load_percentage);
+    update_vibration_sensor(delta_time, generator_running, load_percentage, shaft_speed);
 }
 
-void Sensors::set_sensor_failure(bool fuel_failed, bool oil_failed, bool temp_failed) {
+template <typename Model>
+void BasicSensors<Model>::set_sensor_failure(bool fuel_failed, bool oil_failed, bool temp_failed) {
     fuel_sensor_failed_ = fuel_failed;
     oil_sensor_failed_ = oil_failed;
     temp_sensor_failed_ = temp_failed;
 }
 
-void Sensors::set_calibration_drift(double fuel_drift, double oil_drift, double temp_drift) {
+template <typename Model>
+void BasicSensors<Model>::set_calibration_drift(double fuel_drift, double oil_drift, double temp_drift) {
     fuel_calibration_drift_ = fuel_drift;
     oil_calibration_drift_ = oil_drift;
     temp_calibration_drift_ = temp_drift;
 }
 
-void Sensors::reset_sensors() {
+template <typename Model>
+void BasicSensors<Model>::reset_sensors() {
     fuel_sensor_failed_ = false;
     oil_sensor_failed_ = false;
     temp_sensor_failed_ = false;
     fuel_calibration_drift_ = 0.0;
     oil_calibration_drift_ = 0.0;
     temp_calibration_drift_ = 0.0;
+    temp_offset_ = 0.0;
 }
 
-void Sensors::update_fuel_sensor(double delta_time, bool generator_running, double load_percentage) {
-    if (fuel_sensor_failed_) {
-        // Failed sensor returns random values
-        current_readings_.fuel_level = 50.0 + (noise_dist(gen) * 20.0);
-        return;
-    }
-    
-    if (generator_running) {
-        // Very slow fuel consumption - only 0.001% per second regardless of load
-        double consumption_rate = 0.001;  // 0.001% per second
-        current_readings_.fuel_level -= consumption_rate * delta_time;
-        
-        // Prevent fuel from going below 0
-        if (current_readings_.fuel_level < 0.0) {
-            current_readings_.fuel_level = 0.0;
-        }
-    }
+template <typename Model>
+void BasicSensors<Model>::burn_fuel(double running_time, double load_percentage, double sfoc) {
+    // Fuel burned at the engine's specific consumption for this load
+    fuel_level_ -= fuel_rate(load_percentage, sfoc) * running_time;
     
     // Add calibration drift
-    current_readings_.fuel_level += fuel_calibration_drift_ * delta_time;
-    
-    // Add noise
-    current_readings_.fuel_level = add_noise(current_readings_.fuel_level, SENSOR_NOISE_LEVEL);
+    fuel_level_ += fuel_calibration_drift_ * running_time;
     
     // Clamp to valid range (0-100%)
-    if (current_readings_.fuel_level > 100.0) current_readings_.fuel_level = 100.0;
-    if (current_readings_.fuel_level < 0.0) current_readings_.fuel_level = 0.0;
+    fuel_level_ = std::min(std::max(fuel_level_, 0.0), 100.0);
 }
 
-void Sensors::update_oil_pressure_sensor(double delta_time, bool generator_running, double load_percentage) {
-    if (oil_sensor_failed_) {
-        // Failed sensor returns random values
-        current_readings_.oil_pressure = 2.0 + (noise_dist(gen) * 1.0);
-        return;
-    }
-    
+template <typename Model>
+void BasicSensors<Model>::update_fuel_sensor(double delta_time) {
+    fuel_channel_.update(delta_time, [&] {
+        if (fuel_sensor_failed_) {
+            // Failed sensor returns random values
+            return 50.0 + (noise_dist(gen) * 20.0);
+        }
+        return std::min(std::max(add_noise(fuel_level_, spec_.noise), 0.0), 100.0);
+    });
+    current_readings_.fuel_level = fuel_channel_.reading();
+}
+
+template <typename Model>
+void BasicSensors<Model>::update_oil_pressure_sensor(double delta_time, bool generator_running, double load_percentage) {
     if (generator_running) {
         // Oil pressure increases with load
-        double target_pressure = OIL_PRESSURE_BASE + (load_percentage * OIL_PRESSURE_LOAD_FACTOR);
-        current_readings_.oil_pressure = smooth_transition(current_readings_.oil_pressure, target_pressure, 2.0, delta_time);
+        double target_pressure = spec_.oil_pressure_base + (load_percentage * spec_.oil_pressure_load_factor);
+        oil_pressure_ = smooth_transition(oil_pressure_, target_pressure, spec_.oil_pressure_ramp, delta_time);
     } else {
-        current_readings_.oil_pressure = 0.0;
+        oil_pressure_ = 0.0;
     }
     
     // Add calibration drift
-    current_readings_.oil_pressure += oil_calibration_drift_ * delta_time;
-    
-    // Add noise
-    current_readings_.oil_pressure = add_noise(current_readings_.oil_pressure, SENSOR_NOISE_LEVEL);
+    oil_pressure_ += oil_calibration_drift_ * delta_time;
     
-    // Clamp to valid range
-    if (current_readings_.oil_pressure < 0.0) current_readings_.oil_pressure = 0.0;
-    if (current_readings_.oil_pressure > 10.0) current_readings_.oil_pressure = 10.0;
+    oil_pressure_channel_.update(delta_time, [&] {
+        if (oil_sensor_failed_) {
+            // Failed sensor returns random values
+            return 2.0 + (noise_dist(gen) * 1.0);
+        }
+        // Clamp to valid range
+        return std::min(std::max(add_noise(oil_pressure_, spec_.noise), 0.0), 10.0);
+    });
+    current_readings_.oil_pressure = oil_pressure_channel_.reading();
 }
 
-void Sensors::update_temperature_sensors(double delta_time, bool generator_running, double load_percentage) {
-    if (temp_sensor_failed_) {
-        // Failed sensor returns random values
-        current_readings_.cooling_temp = 80.0 + (noise_dist(gen) * 20.0);
-        return;
-    }
-    
-    if (generator_running) {
-        // Cooling temperature increases with load
-        double target_temp = COOLING_TEMP_BASE + (load_percentage * COOLING_TEMP_LOAD_FACTOR);
-        current_readings_.cooling_temp = smooth_transition(current_readings_.cooling_temp, target_temp, 5.0, delta_time);
-        
-        // Exhaust temperature follows cooling temp with some lag
-        double target_exhaust = target_temp + 200.0; // Exhaust is much hotter
-        current_readings_.exhaust_temp = smooth_transition(current_readings_.exhaust_temp, target_exhaust, 10.0, delta_time);
-    } else {
-        // Cool down when stopped
-        current_readings_.cooling_temp = smooth_transition(current_readings_.cooling_temp, current_readings_.ambient_temp, 2.0, delta_time);
-        current_readings_.exhaust_temp = smooth_transition(current_readings_.exhaust_temp, current_readings_.ambient_temp, 5.0, delta_time);
-    }
-    
-    // Add calibration drift
-    current_readings_.cooling_temp += temp_calibration_drift_ * delta_time;
-    current_readings_.exhaust_temp += temp_calibration_drift_ * delta_time;
-    
-    // Add noise
-    current_readings_.cooling_temp = add_noise(current_readings_.cooling_temp, SENSOR_NOISE_LEVEL);
-    current_readings_.exhaust_temp = add_noise(current_readings_.exhaust_temp, SENSOR_NOISE_LEVEL);
-    
-    // Clamp to valid ranges
-    if (current_readings_.cooling_temp < -20.0) current_readings_.cooling_temp = -20.0;
-    if (current_readings_.cooling_temp > 150.0) current_readings_.cooling_temp = 150.0;
-    if (current_readings_.exhaust_temp < -20.0) current_readings_.exhaust_temp = -20.0;
-    if (current_readings_.exhaust_temp > 600.0) current_readings_.exhaust_temp = 600.0;
+template <typename Model>
+void BasicSensors<Model>::update_temperature_sensors(double delta_time, bool, double) {
+    // Read off the thermal network; noise and drift are in the reading
+    // only, not in the temperatures themselves
+    temp_offset_ += temp_calibration_drift_ * delta_time;
+    cooling_temp_channel_.update(delta_time, [&] {
+        if (temp_sensor_failed_) {
+            // Failed sensor returns random values
+            return 80.0 + (noise_dist(gen) * 20.0);
+        }
+        return std::min(std::max(add_noise(thermal_.jacket + temp_offset_, spec_.noise), -20.0), 150.0);
+    });
+    oil_temp_channel_.update(delta_time, [&] {
+        return std::min(std::max(add_noise(thermal_.oil + temp_offset_, spec_.noise), -20.0), 150.0);
+    });
+    exhaust_temp_channel_.update(delta_time, [&] {
+        return std::min(std::max(add_noise(thermal_.exhaust + temp_offset_, spec_.noise), -20.0), 600.0);
+    });
+    current_readings_.cooling_temp = cooling_temp_channel_.reading();
+    current_readings_.oil_temp = oil_temp_channel_.reading();
+    current_readings_.exhaust_temp = exhaust_temp_channel_.reading();
 }
 
-void Sensors::update_vibration_sensor(double delta_time, bool generator_running, double load_percentage) {
+template <typename Model>
+void BasicSensors<Model>::update_vibration_sensor(double delta_time, bool generator_running, double load_percentage,
+                                                  double shaft_speed) {
     if (generator_running) {
         // Vibration increases with load
-        double target_vibration = VIBRATION_BASE + (load_percentage * VIBRATION_LOAD_FACTOR);
-        current_readings_.vibration = smooth_transition(current_readings_.vibration, target_vibration, 1.0, delta_time);
+        double target_vibration = spec_.vibration_base + (load_percentage * spec_.vibration_load_factor);
+        vibration_ = smooth_transition(vibration_, target_vibration, spec_.vibration_ramp, delta_time);
     } else {
-        current_readings_.vibration = 0.0;
+        vibration_ = 0.0;
     }
-    
-    // Add noise
-    current_readings_.vibration = add_noise(current_readings_.vibration, SENSOR_NOISE_LEVEL);
-    
-    // Clamp to valid range
-    if (current_readings_.vibration < 0.0) current_readings_.vibration = 0.0;
-    if (current_readings_.vibration > 50.0) current_readings_.vibration = 50.0;
+
+    // Bearing defects excite in proportion to speed, and stay with the
+    // shaft as it runs down
+    double speed_ratio = shaft_speed / rated_shaft_speed_;
+    VibrationSource source = {vibration_,
+                              spec_.vibration_2x,
+                              spec_.outer_race_fault * speed_ratio,
+                              spec_.inner_race_fault * speed_ratio,
+                              spec_.bpfo_order,
+                              spec_.bpfi_order,
+                              vibration_ * spec_.noise};
+    waveform_.synthesize(vibration_channel_.advance(delta_time), spec_.vibration_sample_rate, shaft_speed, source,
+                         [] { return noise_dist(gen); });
+}
+
+template <typename Model>
+void BasicSensors<Model>::set_vibration_spectrum(const VibrationSpectrum& spectrum) {
+    spectrum_ = spectrum;
+    waveform_.clear_due();
+    // Clamped to the valid range
+    vibration_channel_.set_reading(std::min(spectrum.bands[VibrationSpectrum::OVERALL].rms, 50.0));
+    current_readings_.vibration = vibration_channel_.reading();
 }
 
-double Sensors::add_noise(double value, double noise_level) const {
+// Seconds until a ramp from current toward target passes threshold
+static double ramp_crossing(double current, double target, double rate, double threshold) {
+    if ((current < threshold && target >= threshold) || (current > threshold && target <= threshold)) {
+        return std::abs(threshold - current) / rate;
+    }
+    return std::numeric_limits<double>::infinity();
+}
+
+template <typename Model>
+double BasicSensors<Model>::time_to_crossing(bool generator_running, double load_percentage, const AlarmLimits& limits,
+                                             double fuel_due) const {
+    if (fuel_calibration_drift_ != 0.0 || oil_calibration_drift_ != 0.0 || temp_calibration_drift_ != 0.0) {
+        return 0.0;
+    }
+    AlarmTimes times = crossing_times(generator_running, load_percentage, limits);
+    return std::min({std::max(times.fuel_level, fuel_due), times.oil_pressure, times.vibration});
+}
+
+template <typename Model>
+SensorTypes::AlarmTimes BasicSensors<Model>::crossing_times(bool generator_running, double load_percentage,
+                                                           const AlarmLimits& limits) const {
+    // Stopped readings are set outright and failed sensors are pure noise
+    const double never = std::numeric_limits<double>::infinity();
+    AlarmTimes times = {never, never, never};
+    if (!generator_running) {
+        return times;
+    }
+
+    if (!fuel_sensor_failed_) {
+        double rate = fuel_rate(load_percentage, spec_.sfoc.at(load_percentage));
+        times.fuel_level = ramp_crossing(fuel_level_, 0.0, rate, limits.low_fuel_level);
+    }
+    if (!oil_sensor_failed_) {
+        double target = spec_.oil_pressure_base + load_percentage * spec_.oil_pressure_load_factor;
+        times.oil_pressure = ramp_crossing(oil_pressure_, target, spec_.oil_pressure_ramp, limits.low_oil_pressure);
+    }
+    // The orders and their noise ramp under the defects, which add in power
+    double faults = spec_.outer_race_fault * spec_.outer_race_fault + spec_.inner_race_fault * spec_.inner_race_fault;
+    double threshold = std::sqrt(std::max(limits.high_vibration * limits.high_vibration - faults, 0.0) /
+                                 (1.0 + spec_.noise * spec_.noise));
+    double target = spec_.vibration_base + load_percentage * spec_.vibration_load_factor;
+    times.vibration = ramp_crossing(vibration_, target, spec_.vibration_ramp, threshold);
+    return times;
+}
+
+template <typename Model>
+double BasicSensors<Model>::add_noise(double value, double noise_level) const {
     return value + (noise_dist(gen) * value * noise_level);
 }
 
-double Sensors::add_drift(double value, double drift_rate, double delta_time) {
+template <typename Model>
+double BasicSensors<Model>::add_drift(double value, double drift_rate, double delta_time) {
     return value + (drift_rate * delta_time);
 }
 
-double Sensors::smooth_transition(double current, double target, double rate, double delta_time) const {
+template <typename Model>
+double BasicSensors<Model>::smooth_transition(double current, double target, double rate, double delta_time) const {
     double difference = target - current;
     double max_change = rate * delta_time;
     
@@ -192,3 +279,76 @@ double Sensors::smooth_transition(double current, double target, double rate, do
         return current + (difference > 0 ? max_change : -max_change);
     }
 }
+
+template <typename Model>
+std::string BasicSensors<Model>::save_state() const {
+    std::ostringstream state;
+    state.precision(17);
+    state << "sensors.fuel_level " << fuel_level_ << "\n"
+          << "sensors.oil_pressure " << oil_pressure_ << "\n"
+          << "sensors.cooling_temp " << current_readings_.cooling_temp << "\n"
+          << "sensors.vibration " << vibration_ << "\n"
+          << "sensors.exhaust_temp " << current_readings_.exhaust_temp << "\n"
+          << "sensors.ambient_temp " << current_readings_.ambient_temp << "\n"
+          << "sensors.humidity " << current_readings_.humidity << "\n"
+          << "sensors.failed " << fuel_sensor_failed_ << " " << oil_sensor_failed_ << " "
+          << temp_sensor_failed_ << "\n"
+          << "sensors.drift " << fuel_calibration_drift_ << " " << oil_calibration_drift_ << " "
+          << temp_calibration_drift_ << "\n"
+          << "sensors.temp_offset " << temp_offset_ << "\n"
+          << "sensors.thermal " << thermal_.jacket << " " << thermal_.oil << " " << thermal_.exhaust << "\n";
+    return state.str();
+}
+
+template <typename Model>
+void BasicSensors<Model>::restore_state(const std::string& state) {
+    std::istringstream lines(state);
+    std::string line;
+    bool has_thermal = false;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "sensors.fuel_level") {
+            fields >> current_readings_.fuel_level;
+        } else if (key == "sensors.oil_pressure") {
+            fields >> current_readings_.oil_pressure;
+        } else if (key == "sensors.cooling_temp") {
+            fields >> current_readings_.cooling_temp;
+        } else if (key == "sensors.vibration") {
+            fields >> current_readings_.vibration;
+        } else if (key == "sensors.exhaust_temp") {
+            fields >> current_readings_.exhaust_temp;
+        } else if (key == "sensors.ambient_temp") {
+            fields >> current_readings_.ambient_temp;
+        } else if (key == "sensors.humidity") {
+            fields >> current_readings_.humidity;
+        } else if (key == "sensors.failed") {
+            fields >> fuel_sensor_failed_ >> oil_sensor_failed_ >> temp_sensor_failed_;
+        } else if (key == "sensors.drift") {
+            fields >> fuel_calibration_drift_ >> oil_calibration_drift_ >> temp_calibration_drift_;
+        } else if (key == "sensors.temp_offset") {
+            fields >> temp_offset_;
+        } else if (key == "sensors.thermal") {
+            fields >> thermal_.jacket >> thermal_.oil >> thermal_.exhaust;
+            has_thermal = true;
+        }
+    }
+    if (!has_thermal) {
+        // State saved before the thermal network: start it from the readings
+        thermal_ = {current_readings_.cooling_temp, current_readings_.cooling_temp, current_readings_.exhaust_temp};
+        current_readings_.oil_temp = current_readings_.cooling_temp;
+    } else {
+        current_readings_.oil_temp = thermal_.oil + temp_offset_;
+    }
+
+    // Saved are the values behind the readings, which start from them
+    fuel_level_ = current_readings_.fuel_level;
+    oil_pressure_ = current_readings_.oil_pressure;
+    vibration_ = current_readings_.vibration;
+    reset_channels();
+}
+
+template class BasicSensors<DieselEngine>;
+template class BasicSensors<GasEngine>;
+template class BasicSensors<DualFuelEngine>;
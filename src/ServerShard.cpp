@@ -0,0 +1,1513 @@
+#include "ServerShard.h"
+#include "GeneratorServer.h"
+#include "WebSocket.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "ws2_32.lib")
+    #define close closesocket
+    #define poll WSAPoll
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+#endif
+
+static bool set_non_blocking(int socket) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(socket, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+static bool would_block() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+static std::vector<std::string> split_command(const std::string& command) {
+    std::istringstream stream(command);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (stream >> token) {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+// std::stod that also throws on inf, nan and trailing text, so they take
+// the same error path as any other text that is not a number
+static double parse_number(const std::string& text) {
+    size_t parsed = 0;
+    double value = std::stod(text, &parsed);
+    if (parsed != text.size() || !std::isfinite(value)) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+// Likewise std::stoi for unit, tier and other whole numbers
+static int parse_integer(const std::string& text) {
+    size_t parsed = 0;
+    int value = std::stoi(text, &parsed);
+    if (parsed != text.size()) {
+        throw std::invalid_argument(text);
+    }
+    return value;
+}
+
+static bool parse_alarm_type(const std::string& name, Generator::AlarmType& type) {
+    for (size_t i = 0; i < Generator::ALARM_TYPE_COUNT; ++i) {
+        if (name == alarm_type_name(static_cast<Generator::AlarmType>(i))) {
+            type = static_cast<Generator::AlarmType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+ServerShard::ServerShard(GeneratorServer& server, int index, int shard_count)
+    : server_(server)
+    , index_(index)
+    , shard_count_(shard_count)
+    , server_socket_(-1)
+    , wake_fds_{-1, -1}
+    , next_connection_id_(static_cast<uint64_t>(index) + 1)
+    , status_frames_{nullptr, nullptr, nullptr, nullptr}
+    , commands_(COMMAND_QUEUE_SIZE)
+    , replies_(COMMAND_QUEUE_SIZE)
+    , replies_owed_(0)
+{
+    const std::string throttled = "{\"status\":\"error\",\"message\":\"Rate limit exceeded\"}";
+    throttled_text_ = std::make_shared<const std::string>(throttled + "\n");
+    throttled_websocket_ = std::make_shared<const std::string>(
+        WebSocket::encode_frame(WebSocket::Opcode::TEXT, throttled));
+}
+
+ServerShard::~ServerShard() {
+    shutdown();
+}
+
+bool ServerShard::initialize(int port, bool reuse_port) {
+    // An adopted listener is already bound and listening
+    if (server_socket_ < 0 && !open_listener(port, reuse_port)) {
+        return false;
+    }
+
+#ifndef _WIN32
+    if (pipe(wake_fds_) < 0 || !set_non_blocking(wake_fds_[0]) || !set_non_blocking(wake_fds_[1])) {
+        std::cerr << "Failed to create wake pipe" << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool ServerShard::open_listener(int port, bool reuse_port) {
+    // Create socket
+    server_socket_ = static_cast<int>(socket(AF_INET, SOCK_STREAM, 0));
+    if (server_socket_ < 0) {
+        std::cerr << "Failed to create socket" << std::endl;
+        return false;
+    }
+
+    // Set socket options
+    int opt = 1;
+    if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt)) < 0) {
+        std::cerr << "Failed to set socket options" << std::endl;
+        return false;
+    }
+#ifdef SO_REUSEPORT
+    if (reuse_port && setsockopt(server_socket_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        std::cerr << "Failed to set SO_REUSEPORT" << std::endl;
+        return false;
+    }
+#else
+    if (reuse_port) {
+        std::cerr << "SO_REUSEPORT is not available on this platform" << std::endl;
+        return false;
+    }
+#endif
+
+    // Bind socket
+    struct sockaddr_in server_addr;
+    std::memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (bind(server_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        std::cerr << "Failed to bind socket" << std::endl;
+        return false;
+    }
+
+    // Listen for connections
+    if (listen(server_socket_, LISTEN_BACKLOG) < 0) {
+        std::cerr << "Failed to listen on socket" << std::endl;
+        return false;
+    }
+
+    if (!set_non_blocking(server_socket_)) {
+        std::cerr << "Failed to make listening socket non-blocking" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ServerShard::run() {
+    std::vector<pollfd> poll_fds;
+    while (server_.running()) {
+        poll_fds.clear();
+        poll_fds.push_back({static_cast<decltype(pollfd::fd)>(server_socket_), POLLIN, 0});
+        if (wake_fds_[0] >= 0) {
+            poll_fds.push_back({static_cast<decltype(pollfd::fd)>(wake_fds_[0]), POLLIN, 0});
+        }
+        size_t first_connection = poll_fds.size();
+        for (const auto& connection : connections_) {
+            short events = POLLIN;
+            if (!connection.output.empty()) {
+                events |= POLLOUT;
+            }
+            poll_fds.push_back({static_cast<decltype(pollfd::fd)>(connection.socket), events, 0});
+        }
+
+        int ready = poll(poll_fds.data(), static_cast<unsigned long>(poll_fds.size()), poll_timeout_ms());
+        if (ready < 0 && !would_block()) {
+            std::cerr << "poll() failed" << std::endl;
+            break;
+        }
+
+        // Connections accepted below are appended after the polled range
+        size_t polled = poll_fds.size() - first_connection;
+        for (size_t i = 0; i < polled; ++i) {
+            Connection& connection = connections_[i];
+            short revents = poll_fds[first_connection + i].revents;
+            if (connection.closed || revents == 0) {
+                continue;
+            }
+            if (revents & (POLLIN | POLLHUP)) {
+                read_from(connection);
+            }
+            if (!connection.closed && (revents & POLLOUT)) {
+                flush(connection);
+            }
+            if (!connection.closed && (revents & (POLLERR | POLLNVAL))) {
+                close_connection(connection);
+            }
+        }
+
+#ifndef _WIN32
+        if (wake_fds_[0] >= 0 && (poll_fds[1].revents & POLLIN)) {
+            char drain[64];
+            while (read(wake_fds_[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+#endif
+        drain_replies();
+
+        if (poll_fds[0].revents & POLLIN) {
+            accept_clients();
+        }
+
+        stream_status();
+
+        connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                          [](const Connection& c) { return c.closed; }),
+                           connections_.end());
+    }
+}
+
+void ServerShard::shutdown() {
+    for (auto& connection : connections_) {
+        close_connection(connection);
+    }
+    connections_.clear();
+
+    if (server_socket_ >= 0) {
+        close(server_socket_);
+        server_socket_ = -1;
+    }
+
+#ifndef _WIN32
+    for (int& fd : wake_fds_) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+#endif
+}
+
+void ServerShard::deliver(Reply reply) {
+    // Cannot fail: replies owed are capped at the reply queue size
+    replies_.try_push(std::move(reply));
+    wake();
+}
+
+void ServerShard::wake() {
+#ifndef _WIN32
+    char byte = 1;
+    if (wake_fds_[1] >= 0 && write(wake_fds_[1], &byte, 1) < 0) {
+        // A full pipe already has a wakeup pending
+    }
+#endif
+}
+
+void ServerShard::drain_replies() {
+    Reply reply;
+    while (replies_.try_pop(reply)) {
+        --replies_owed_;
+        Connection* connection = find_connection(reply.connection_id);
+        if (connection == nullptr) {
+            continue;
+        }
+        send_reply(*connection, reply.tag, reply.message);
+        if (!reply.event) {
+            connection->awaiting_reply = false;
+            process_input(*connection);
+        }
+    }
+}
+
+ServerShard::Connection* ServerShard::find_connection(uint64_t id) {
+    for (auto& connection : connections_) {
+        if (connection.id == id) {
+            return connection.closed ? nullptr : &connection;
+        }
+    }
+    return nullptr;
+}
+
+void ServerShard::accept_clients() {
+    while (true) {
+        struct sockaddr_in client_addr;
+#ifdef _WIN32
+        int client_len = sizeof(client_addr);
+#else
+        socklen_t client_len = sizeof(client_addr);
+#endif
+        int client_socket = static_cast<int>(accept(server_socket_, (struct sockaddr*)&client_addr, &client_len));
+        if (client_socket < 0) {
+            if (!would_block()) {
+                std::cerr << "Failed to accept connection" << std::endl;
+            }
+            return;
+        }
+
+        if (!set_non_blocking(client_socket)) {
+            std::cerr << "Failed to make client socket non-blocking" << std::endl;
+            close(client_socket);
+            continue;
+        }
+
+        // Over the cap: one best-effort line, no connection state at all
+        if (!server_.admit_connection()) {
+            static const char rejection[] = "{\"status\":\"error\",\"message\":\"Too many connections\"}\n";
+            send(client_socket, rejection, static_cast<int>(sizeof(rejection) - 1), MSG_NOSIGNAL);
+            close(client_socket);
+            continue;
+        }
+
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+        std::cout << "Client connected from " << client_ip << std::endl;
+        add_connection(client_socket, client_ip);
+    }
+}
+
+void ServerShard::add_connection(int socket, const std::string& address) {
+    Connection connection;
+    connection.id = next_connection_id_;
+    next_connection_id_ += static_cast<uint64_t>(shard_count_);
+    connection.socket = socket;
+    connection.address = address;
+    connection.protocol = Protocol::PENDING;
+    connection.closing = false;
+    connection.closed = false;
+    connection.input_unterminated = false;
+    connection.newline_framed = false;
+    connection.ws_fragmented = false;
+    connection.awaiting_reply = false;
+    connection.streaming = false;
+    connection.encoding = StreamEncoding::JSON;
+    connection.stream_interval = std::chrono::steady_clock::duration::zero();
+    connection.delta = false;
+    connection.delta_drops_seen = 0;
+    const RateLimits& limits = server_.limits();
+    for (size_t i = 0; i < RateLimits::CLASS_COUNT; ++i) {
+        connection.buckets[i].configure(limits.rate[i], limits.burst[i]);
+        connection.throttled[i] = 0;
+    }
+    connections_.push_back(std::move(connection));
+}
+
+void ServerShard::adopt_listener(int socket) {
+    server_socket_ = socket;
+}
+
+bool ServerShard::adopt_connection(const std::string& description, int socket) {
+    // shard client <address> <protocol> <newline_framed> <input_unterminated> <closing>
+    //     <streaming> <encoding> <interval_ns> <delta> <policy> <max_frames> <input> <ws_message> <output>
+    //     [<ws_fragmented>]
+    std::istringstream fields(description);
+    std::string component, kind, address, policy_name, input, ws_message, output;
+    int protocol, newline_framed, input_unterminated, closing, streaming, encoding, delta;
+    long long interval_ns;
+    size_t max_frames;
+    OutputQueue::Policy policy;
+    if (!(fields >> component >> kind >> address >> protocol >> newline_framed >> input_unterminated >> closing >>
+          streaming >> encoding >> interval_ns >> delta >> policy_name >> max_frames >> input >> ws_message >>
+          output) ||
+        protocol < 0 || protocol > static_cast<int>(Protocol::WEBSOCKET) ||
+        !OutputQueue::parse_policy(policy_name, policy)) {
+        return false;
+    }
+
+    // Admitted by the previous process, so never refused here
+    server_.admit_connection(true);
+    add_connection(socket, address);
+
+    Connection& connection = connections_.back();
+    connection.protocol = static_cast<Protocol>(protocol);
+    connection.newline_framed = newline_framed != 0;
+    connection.input_unterminated = input_unterminated != 0;
+    connection.closing = closing != 0;
+    connection.streaming = streaming != 0;
+    connection.encoding = encoding != 0 ? StreamEncoding::BINARY : StreamEncoding::JSON;
+    connection.stream_interval = std::chrono::nanoseconds(interval_ns);
+    connection.next_stream = std::chrono::steady_clock::now();
+    connection.delta = delta != 0;
+    connection.output.set_policy(policy);
+    connection.output.set_limits(max_frames, OutputQueue::DEFAULT_MAX_BYTES);
+    connection.input = HotRestart::decode_bytes(input);
+    connection.ws_message = HotRestart::decode_bytes(ws_message);
+    int ws_fragmented;
+    connection.ws_fragmented = fields >> ws_fragmented ? ws_fragmented != 0 : !connection.ws_message.empty();
+
+    // May end mid-frame, so it goes out before anything this process sends
+    std::string pending = HotRestart::decode_bytes(output);
+    if (!pending.empty()) {
+        connection.output.push(std::make_shared<const std::string>(std::move(pending)), OutputQueue::Kind::CONTROL);
+    }
+    std::cout << "Adopted client " << connection.id << " from " << address << std::endl;
+    return true;
+}
+
+bool ServerShard::quiesce() {
+    drain_replies();
+    for (auto& connection : connections_) {
+        if (!connection.closed && !connection.output.empty()) {
+            flush(connection);
+        }
+    }
+    return replies_owed_ == 0;
+}
+
+void ServerShard::hand_over(HotRestart::Handoff& handoff) const {
+    if (server_socket_ >= 0) {
+        handoff.add("shard listener", server_socket_);
+    }
+
+    for (const auto& connection : connections_) {
+        if (connection.closed) {
+            continue;
+        }
+        std::ostringstream description;
+        description << "shard client " << connection.address
+                    << " " << static_cast<int>(connection.protocol)
+                    << " " << connection.newline_framed
+                    << " " << connection.input_unterminated
+                    << " " << connection.closing
+                    << " " << connection.streaming
+                    << " " << (connection.encoding == StreamEncoding::BINARY)
+                    << " " << std::chrono::duration_cast<std::chrono::nanoseconds>(connection.stream_interval).count()
+                    << " " << connection.delta
+                    << " " << OutputQueue::policy_name(connection.output.policy())
+                    << " " << connection.output.max_frames()
+                    << " " << HotRestart::encode_bytes(connection.input)
+                    << " " << HotRestart::encode_bytes(connection.ws_message)
+                    << " " << HotRestart::encode_bytes(connection.output.unsent())
+                    << " " << connection.ws_fragmented;
+        handoff.add(description.str(), connection.socket);
+    }
+}
+
+void ServerShard::read_from(Connection& connection) {
+    char buffer[BUFFER_SIZE];
+    int bytes_received = static_cast<int>(recv(connection.socket, buffer, BUFFER_SIZE, 0));
+
+    if (bytes_received <= 0) {
+        if (bytes_received < 0 && would_block()) {
+            return;
+        }
+        if (bytes_received == 0) {
+            std::cout << "Client disconnected" << std::endl;
+        } else {
+            std::cout << "Error receiving data" << std::endl;
+        }
+        close_connection(connection);
+        return;
+    }
+
+    connection.input.append(buffer, bytes_received);
+    connection.input_unterminated = buffer[bytes_received - 1] != '\n';
+    connection.newline_framed = connection.newline_framed ||
+                                std::memchr(buffer, '\n', static_cast<size_t>(bytes_received)) != nullptr;
+    process_input(connection);
+
+    // Input held back behind a pending reply, or one endless line
+    if (!connection.closed && connection.input.size() > MAX_INPUT_SIZE) {
+        std::cout << "Client " << connection.id << " input overflow" << std::endl;
+        close_connection(connection);
+    }
+}
+
+void ServerShard::flush(Connection& connection) {
+    while (!connection.output.empty()) {
+        size_t remaining = connection.output.pending_size();
+        int bytes_sent = static_cast<int>(send(connection.socket, connection.output.pending_data(),
+                                               static_cast<int>(remaining), MSG_NOSIGNAL));
+        if (bytes_sent < 0) {
+            if (!would_block()) {
+                std::cout << "Error sending response" << std::endl;
+                close_connection(connection);
+            }
+            return;
+        }
+
+        connection.output.consume(static_cast<size_t>(bytes_sent));
+        if (static_cast<size_t>(bytes_sent) < remaining) {
+            return;
+        }
+    }
+
+    if (connection.closing) {
+        close_connection(connection);
+    }
+}
+
+void ServerShard::send_frame(Connection& connection, const Frame& frame, OutputQueue::Kind kind) {
+    if (connection.closed) {
+        return;
+    }
+
+    // Only try the socket when nothing is queued; otherwise POLLOUT drains it
+    bool was_empty = connection.output.empty();
+    if (!connection.output.push(frame, kind)) {
+        std::cout << "Client " << connection.id << " output queue overflow ("
+                  << OutputQueue::policy_name(connection.output.policy()) << ")" << std::endl;
+        close_connection(connection);
+        return;
+    }
+    if (was_empty) {
+        flush(connection);
+    }
+}
+
+void ServerShard::send_reply(Connection& connection, const RequestTag& tag, const std::string& reply) {
+    if (!tag.present) {
+        send_reply(connection, reply);
+        return;
+    }
+    // Replies are JSON objects; the ID becomes their first member
+    send_reply(connection, "{\"id\":" + std::to_string(tag.id) + "," + reply.substr(1));
+}
+
+void ServerShard::send_reply(Connection& connection, const std::string& reply) {
+    std::cout << "Sending response: " << reply << std::endl;
+    if (connection.protocol == Protocol::WEBSOCKET) {
+        send_frame(connection, std::make_shared<const std::string>(
+                                   WebSocket::encode_frame(WebSocket::Opcode::TEXT, reply)),
+                   OutputQueue::Kind::REPLY);
+    } else {
+        send_frame(connection, std::make_shared<const std::string>(reply + "\n"), OutputQueue::Kind::REPLY);
+    }
+}
+
+void ServerShard::close_connection(Connection& connection) {
+    if (connection.closed) {
+        return;
+    }
+    close(connection.socket);
+    connection.closed = true;
+    connection.output.clear();
+    server_.release_connection();
+    std::cout << "Client connection closed" << std::endl;
+}
+
+int ServerShard::poll_timeout_ms() const {
+    auto now = std::chrono::steady_clock::now();
+    auto timeout = std::chrono::milliseconds(IDLE_POLL_TIMEOUT_MS);
+
+    for (const auto& connection : connections_) {
+        if (connection.streaming) {
+            auto until_due = std::chrono::ceil<std::chrono::milliseconds>(connection.next_stream - now);
+            timeout = std::min(timeout, std::max(until_due, std::chrono::milliseconds(0)));
+        }
+    }
+
+    // Without a wake pipe, replies are only noticed by polling
+    if (wake_fds_[0] < 0 && replies_owed_ > 0) {
+        timeout = std::min(timeout, std::chrono::milliseconds(WAKELESS_POLL_TIMEOUT_MS));
+    }
+    return static_cast<int>(timeout.count());
+}
+
+void ServerShard::process_input(Connection& connection) {
+    if (connection.protocol == Protocol::PENDING) {
+        // Browsers open with an HTTP upgrade; anything else is the text protocol
+        if (connection.input.size() < 4 && std::string("GET ").compare(0, connection.input.size(), connection.input) == 0) {
+            return;
+        }
+        connection.protocol = connection.input.compare(0, 4, "GET ") == 0 ? Protocol::WEBSOCKET : Protocol::TEXT;
+        if (connection.protocol == Protocol::WEBSOCKET) {
+            process_handshake(connection);
+            return;
+        }
+    }
+
+    if (connection.protocol == Protocol::WEBSOCKET) {
+        process_websocket(connection);
+        return;
+    }
+
+    size_t newline;
+    while (!connection.closed && !connection.awaiting_reply &&
+           (newline = connection.input.find('\n')) != std::string::npos) {
+        std::string line = connection.input.substr(0, newline);
+        connection.input.erase(0, newline + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!split_command(line).empty()) {
+            handle_command(connection, line);
+        }
+    }
+
+    // Clients written against the original one-command-per-recv server
+    // send commands without a trailing newline. Once a client has used
+    // newlines, a partial line is just a line split across reads.
+    if (!connection.closed && !connection.awaiting_reply && connection.input_unterminated &&
+        !connection.newline_framed &&
+        !connection.input.empty()) {
+        std::string line;
+        line.swap(connection.input);
+        handle_command(connection, line);
+    }
+}
+
+void ServerShard::process_handshake(Connection& connection) {
+    size_t header_end = connection.input.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        if (connection.input.size() > WebSocket::MAX_HANDSHAKE_SIZE) {
+            close_connection(connection);
+        }
+        return;
+    }
+
+    std::string request = connection.input.substr(0, header_end + 4);
+    connection.input.erase(0, header_end + 4);
+
+    std::string response = WebSocket::handshake_response(request);
+    if (response.empty()) {
+        connection.closing = true;
+        send_frame(connection, std::make_shared<const std::string>(
+                                   "HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Length: 0\r\n\r\n"),
+                   OutputQueue::Kind::CONTROL);
+        return;
+    }
+
+    std::cout << "WebSocket client upgraded" << std::endl;
+    send_frame(connection, std::make_shared<const std::string>(response), OutputQueue::Kind::CONTROL);
+    process_websocket(connection);
+}
+
+void ServerShard::process_websocket(Connection& connection) {
+    while (!connection.closed && !connection.closing && !connection.awaiting_reply) {
+        WebSocket::Frame frame;
+        size_t consumed = 0;
+        auto result = WebSocket::decode_frame(connection.input, consumed, frame);
+        if (result == WebSocket::DecodeResult::INCOMPLETE) {
+            return;
+        }
+        if (result == WebSocket::DecodeResult::INVALID) {
+            fail_websocket(connection);
+            return;
+        }
+        connection.input.erase(0, consumed);
+
+        switch (frame.opcode) {
+            case WebSocket::Opcode::TEXT:
+            case WebSocket::Opcode::BINARY:
+                // Not while another message is still arriving
+                if (connection.ws_fragmented) {
+                    fail_websocket(connection);
+                    return;
+                }
+                connection.ws_message = frame.payload;
+                connection.ws_fragmented = !frame.final;
+                break;
+            case WebSocket::Opcode::CONTINUATION:
+                if (!connection.ws_fragmented) {
+                    fail_websocket(connection);
+                    return;
+                }
+                connection.ws_fragmented = !frame.final;
+                connection.ws_message += frame.payload;
+                if (connection.ws_message.size() > WebSocket::MAX_PAYLOAD_SIZE) {
+                    close_connection(connection);
+                    return;
+                }
+                break;
+            case WebSocket::Opcode::PING:
+                send_frame(connection, std::make_shared<const std::string>(
+                                           WebSocket::encode_frame(WebSocket::Opcode::PONG, frame.payload)),
+                           OutputQueue::Kind::CONTROL);
+                continue;
+            case WebSocket::Opcode::PONG:
+                continue;
+            case WebSocket::Opcode::CLOSE:
+                connection.closing = true;
+                send_frame(connection, std::make_shared<const std::string>(
+                                           WebSocket::encode_frame(WebSocket::Opcode::CLOSE, frame.payload.substr(0, 2))),
+                           OutputQueue::Kind::CONTROL);
+                return;
+            default:
+                fail_websocket(connection);
+                return;
+        }
+
+        if (frame.final) {
+            std::string command;
+            command.swap(connection.ws_message);
+            if (!split_command(command).empty()) {
+                handle_command(connection, command);
+            }
+        }
+    }
+}
+
+void ServerShard::fail_websocket(Connection& connection) {
+    connection.closing = true;
+    send_frame(connection, std::make_shared<const std::string>(
+                               WebSocket::encode_frame(WebSocket::Opcode::CLOSE, std::string("\x03\xEA", 2))),
+               OutputQueue::Kind::CONTROL);
+}
+
+bool ServerShard::admit_command(Connection& connection, const std::string& command) {
+    // Classify on the first word only; rejected commands are never parsed
+    size_t start = command.find_first_not_of(" \t");
+    size_t end = command.find_first_of(" \t", start);
+    const std::string name = start == std::string::npos ? "" : command.substr(start, end - start);
+
+    RateLimits::Class command_class = RateLimits::Class::QUERY;
+    if (name == "start" || name == "stop" || name == "emergency_stop" || name == "set_load" ||
+        name == "acknowledge_alarm" || name == "reset_alarms" || name == "set_parameters" || name == "batch" ||
+        name == "fast_forward" || name == "reload") {
+        command_class = RateLimits::Class::CONTROL;
+    } else if ((name == "bus" || name == "pms" || name == "profile") &&
+               command.find_first_not_of(" \t", end) != std::string::npos) {
+        command_class = RateLimits::Class::CONTROL;
+    } else if (name == "stream" || name == "deadband" || name == "queue") {
+        command_class = RateLimits::Class::CONFIG;
+    }
+
+    size_t index = static_cast<size_t>(command_class);
+    if (connection.buckets[index].try_take(std::chrono::steady_clock::now())) {
+        return true;
+    }
+
+    ++connection.throttled[index];
+    server_.count_throttled();
+    send_frame(connection, connection.protocol == Protocol::WEBSOCKET ? throttled_websocket_ : throttled_text_,
+               OutputQueue::Kind::REPLY);
+    return false;
+}
+
+void ServerShard::handle_command(Connection& connection, const std::string& command) {
+    if (!admit_command(connection, command)) {
+        return;
+    }
+    std::cout << "Received: " << command << std::endl;
+
+    // Request options may appear anywhere after the command name:
+    // id=<n> tags every reply, wait adds a completion event
+    std::vector<std::string> tokens;
+    RequestTag tag{false, 0};
+    bool wait = false;
+    for (const auto& token : split_command(command)) {
+        if (!tokens.empty() && token == "wait") {
+            wait = true;
+        } else if (!tokens.empty() && token.compare(0, 3, "id=") == 0) {
+            try {
+                size_t parsed = 0;
+                tag.id = std::stoull(token.substr(3), &parsed);
+                if (parsed != token.size() - 3) {
+                    throw std::invalid_argument("request id");
+                }
+                tag.present = true;
+            } catch (const std::exception& e) {
+                send_reply(connection, "{\"status\":\"error\",\"message\":\"Invalid request id\"}");
+                return;
+            }
+        } else {
+            tokens.push_back(token);
+        }
+    }
+    const std::string name = tokens.empty() ? "" : tokens[0];
+
+    // Generator commands are applied by the simulation thread
+    std::string response;
+    std::string error;
+    Operation operation;
+    if (name == "batch") {
+        if (wait) {
+            response = "{\"status\":\"error\",\"message\":\"wait is not supported for batches\"}";
+        } else {
+            submit_batch(connection, command, tag);
+            return;
+        }
+    } else if (parse_operation(tokens, operation, error)) {
+        bool waitable = operation.type == Operation::Type::START || operation.type == Operation::Type::STOP ||
+                        operation.type == Operation::Type::EMERGENCY_STOP ||
+                        operation.type == Operation::Type::SET_LOAD;
+        if (!wait || waitable) {
+            submit(connection, {connection.id, {operation}, false, tag, wait});
+            return;
+        }
+        response = "{\"status\":\"error\",\"message\":\"wait is only supported for generator commands\"}";
+    } else if (!error.empty()) {
+        response = "{\"status\":\"error\",\"message\":\"" + error + "\"}";
+    } else if (wait) {
+        response = "{\"status\":\"error\",\"message\":\"wait is only supported for generator commands\"}";
+    } else if (name == "status") {
+        response = status_reply();
+    } else if (name == "bus") {
+        response = bus_reply();
+    } else if (name == "pms") {
+        response = pms_reply();
+    } else if (name == "spectrum") {
+        response = spectrum_reply();
+    } else if (name == "profile") {
+        response = profile_reply();
+    } else if (name == "stream") {
+        response = configure_stream(connection, tokens);
+    } else if (name == "deadband") {
+        response = configure_deadband(connection, tokens);
+    } else if (name == "queue") {
+        response = configure_queue(connection, tokens);
+    } else if (name == "clients") {
+        response = describe_clients();
+    } else if (name == "limits") {
+        response = describe_limits(connection);
+    } else {
+        response = "{\"status\":\"error\",\"message\":\"Unknown command\"}";
+    }
+
+    send_reply(connection, tag, response);
+}
+
+bool ServerShard::parse_operation(const std::vector<std::string>& tokens, Operation& operation,
+                                  std::string& error) const {
+    // Returns false with an empty error for commands that are not generator operations
+    const std::string name = tokens.empty() ? "" : tokens[0];
+    operation = Operation{Operation::Type::START, {0.0, 0.0, 0.0}};
+
+    if (name == "start") {
+        return true;
+    } else if (name == "stop") {
+        operation.type = Operation::Type::STOP;
+        return true;
+    } else if (name == "emergency_stop") {
+        operation.type = Operation::Type::EMERGENCY_STOP;
+        return true;
+    } else if (name == "reset_alarms") {
+        operation.type = Operation::Type::RESET_ALARMS;
+        return true;
+    } else if (name == "reload") {
+        operation.type = Operation::Type::RELOAD_SPEC;
+        return true;
+    } else if (name == "set_load") {
+        // Parse load value from command (e.g., "set_load 75")
+        if (tokens.size() < 2) {
+            error = "Missing load value";
+            return false;
+        }
+        try {
+            double load_value = parse_number(tokens[1]);
+            if (!(load_value >= 0.0 && load_value <= 100.0)) {
+                error = "Load must be between 0 and 100";
+                return false;
+            }
+            operation.type = Operation::Type::SET_LOAD;
+            operation.values[0] = load_value;
+            return true;
+        } catch (const std::exception& e) {
+            error = "Invalid load value";
+            return false;
+        }
+    } else if (name == "acknowledge_alarm") {
+        Generator::AlarmType type;
+        if (tokens.size() < 2 || !parse_alarm_type(tokens[1], type)) {
+            error = "Unknown alarm type";
+            return false;
+        }
+        operation.type = Operation::Type::ACKNOWLEDGE_ALARM;
+        operation.values[0] = static_cast<double>(type);
+        return true;
+    } else if (name == "fast_forward") {
+        // fast_forward <seconds>
+        if (tokens.size() < 2) {
+            error = "Missing duration";
+            return false;
+        }
+        try {
+            double seconds = parse_number(tokens[1]);
+            if (!(seconds > 0.0) || seconds > MAX_FAST_FORWARD) {
+                error = "Duration must be between 0 and " + std::to_string(static_cast<long>(MAX_FAST_FORWARD)) +
+                        " seconds";
+                return false;
+            }
+            operation.type = Operation::Type::FAST_FORWARD;
+            operation.values[0] = seconds;
+            return true;
+        } catch (const std::exception& e) {
+            error = "Invalid duration";
+            return false;
+        }
+    } else if (name == "bus" && tokens.size() > 1) {
+        return parse_bus_operation(tokens, operation, error);
+    } else if (name == "pms" && tokens.size() > 1) {
+        return parse_pms_operation(tokens, operation, error);
+    } else if (name == "profile" && tokens.size() > 1) {
+        return parse_profile_operation(tokens, operation, error);
+    } else if (name == "set_parameters") {
+        // set_parameters <max_rpm> <max_voltage> <max_frequency>
+        if (tokens.size() < 4) {
+            error = "Missing parameter values";
+            return false;
+        }
+        try {
+            for (size_t i = 0; i < 3; ++i) {
+                operation.values[i] = parse_number(tokens[i + 1]);
+                if (!(operation.values[i] > 0.0)) {
+                    error = "Parameters must be positive";
+                    return false;
+                }
+            }
+            operation.type = Operation::Type::SET_PARAMETERS;
+            return true;
+        } catch (const std::exception& e) {
+            error = "Invalid parameter value";
+            return false;
+        }
+    }
+    return false;
+}
+
+bool ServerShard::parse_bus_operation(const std::vector<std::string>& tokens, Operation& operation,
+                                      std::string& error) const {
+    // bus demand <kW> [power_factor]
+    // bus mode <unit> droop [percent] | bus mode <unit> isochronous
+    // bus breaker <unit> open|close
+    try {
+        if (tokens[1] == "demand") {
+            if (tokens.size() < 3) {
+                error = "Missing bus demand";
+                return false;
+            }
+            double kw = parse_number(tokens[2]);
+            double power_factor = tokens.size() > 3 ? parse_number(tokens[3]) : DEFAULT_POWER_FACTOR;
+            if (kw < 0.0) {
+                error = "Bus demand must not be negative";
+                return false;
+            }
+            if (!(power_factor > 0.0 && power_factor <= 1.0)) {
+                error = "Power factor must be above 0 and at most 1";
+                return false;
+            }
+            operation.type = Operation::Type::SET_BUS_DEMAND;
+            operation.values[0] = kw;
+            operation.values[1] = kw * std::tan(std::acos(power_factor));
+            if (!std::isfinite(operation.values[1])) {
+                error = "Bus demand is too large";
+                return false;
+            }
+            return true;
+        }
+
+        if (tokens[1] != "mode" && tokens[1] != "breaker") {
+            error = "Unknown bus command: " + tokens[1];
+            return false;
+        }
+        if (tokens.size() < 4) {
+            error = "Usage: bus " + tokens[1] + " <unit> " + (tokens[1] == "mode" ? "<droop|isochronous>" : "<open|close>");
+            return false;
+        }
+        int unit = parse_integer(tokens[2]);
+        if (unit < 0 || unit >= static_cast<int>(Switchboard::MAX_UNITS)) {
+            error = "Unknown unit";
+            return false;
+        }
+        operation.values[0] = unit;
+
+        if (tokens[1] == "breaker") {
+            if (tokens[3] != "open" && tokens[3] != "close") {
+                error = "Breaker must be open or close";
+                return false;
+            }
+            operation.type = Operation::Type::SET_BREAKER;
+            operation.values[1] = tokens[3] == "close" ? 1.0 : 0.0;
+            return true;
+        }
+
+        Switchboard::Mode mode;
+        if (!Switchboard::parse_mode(tokens[3], mode)) {
+            error = "Mode must be droop or isochronous";
+            return false;
+        }
+        double droop = tokens.size() > 4 ? parse_number(tokens[4]) / 100.0 : 0.0;
+        if (tokens.size() > 4 && !(droop >= Switchboard::MIN_DROOP && droop <= Switchboard::MAX_DROOP)) {
+            error = "Droop must be between 0.1 and 20%";
+            return false;
+        }
+        operation.type = Operation::Type::SET_UNIT_MODE;
+        operation.values[1] = static_cast<double>(mode);
+        operation.values[2] = droop;
+        return true;
+    } catch (const std::exception& e) {
+        error = "Invalid bus value";
+        return false;
+    }
+}
+
+bool ServerShard::parse_pms_operation(const std::vector<std::string>& tokens, Operation& operation,
+                                      std::string& error) const {
+    // pms on|off
+    // pms priority <unit> <priority>
+    // pms tier <tier> <kW>
+    if (tokens[1] == "on" || tokens[1] == "off") {
+        operation.type = Operation::Type::SET_POWER_MANAGEMENT;
+        operation.values[0] = tokens[1] == "on" ? 1.0 : 0.0;
+        return true;
+    }
+    if (tokens[1] != "priority" && tokens[1] != "tier") {
+        error = "Unknown pms command: " + tokens[1];
+        return false;
+    }
+    if (tokens.size() < 4) {
+        error = "Usage: pms " + tokens[1] + (tokens[1] == "priority" ? " <unit> <priority>" : " <tier> <kW>");
+        return false;
+    }
+
+    try {
+        if (tokens[1] == "priority") {
+            int unit = parse_integer(tokens[2]);
+            int priority = parse_integer(tokens[3]);
+            if (unit < 0 || unit >= static_cast<int>(Switchboard::MAX_UNITS)) {
+                error = "Unknown unit";
+                return false;
+            }
+            if (priority < 0 || priority > PowerManagement::MAX_PRIORITY) {
+                error = "Priority must be between 0 and " + std::to_string(PowerManagement::MAX_PRIORITY);
+                return false;
+            }
+            operation.type = Operation::Type::SET_UNIT_PRIORITY;
+            operation.values[0] = unit;
+            operation.values[1] = priority;
+            return true;
+        }
+
+        int tier = parse_integer(tokens[2]);
+        double kw = parse_number(tokens[3]);
+        if (tier < 1 || tier > static_cast<int>(PowerManagement::MAX_TIERS)) {
+            error = "Tier must be between 1 and " + std::to_string(PowerManagement::MAX_TIERS);
+            return false;
+        }
+        if (kw < 0.0) {
+            error = "Tier load must not be negative";
+            return false;
+        }
+        operation.type = Operation::Type::SET_SHED_TIER;
+        operation.values[0] = tier - 1;
+        operation.values[1] = kw;
+        return true;
+    } catch (const std::exception& e) {
+        error = "Invalid pms value";
+        return false;
+    }
+}
+
+bool ServerShard::parse_profile_operation(const std::vector<std::string>& tokens, Operation& operation,
+                                          std::string& error) const {
+    // profile <generator|bus> play [seconds]
+    // profile <generator|bus> stop
+    ProfileTarget target;
+    if (!parse_profile_target(tokens[1], target)) {
+        error = "Profile target must be generator or bus";
+        return false;
+    }
+    if (tokens.size() < 3 || (tokens[2] != "play" && tokens[2] != "stop")) {
+        error = "Usage: profile " + tokens[1] + " play [seconds] | profile " + tokens[1] + " stop";
+        return false;
+    }
+    operation.values[0] = static_cast<double>(target);
+    if (tokens[2] == "stop") {
+        operation.type = Operation::Type::STOP_PROFILE;
+        return true;
+    }
+
+    try {
+        double from = tokens.size() > 3 ? parse_number(tokens[3]) : 0.0;
+        if (!(from >= 0.0)) {
+            error = "Playback must start at 0 seconds or later";
+            return false;
+        }
+        operation.type = Operation::Type::PLAY_PROFILE;
+        operation.values[1] = from;
+        return true;
+    } catch (const std::exception& e) {
+        error = "Invalid start time";
+        return false;
+    }
+}
+
+void ServerShard::submit_batch(Connection& connection, const std::string& command, const RequestTag& tag) {
+    // batch <operation>; <operation>; ...
+    // The whole batch is rejected if any operation is invalid, so nothing
+    // is applied partially
+    Command request{connection.id, {}, true, tag, false};
+    std::istringstream stream(command.substr(command.find("batch") + 5));
+    std::string segment;
+    while (std::getline(stream, segment, ';')) {
+        std::vector<std::string> tokens;
+        for (const auto& token : split_command(segment)) {
+            if (token.compare(0, 3, "id=") != 0) {
+                tokens.push_back(token);
+            }
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+
+        Operation operation;
+        std::string error;
+        if (!parse_operation(tokens, operation, error)) {
+            if (error.empty()) {
+                error = "Unsupported operation: " + tokens[0];
+            }
+            send_reply(connection, tag, "{\"status\":\"error\",\"message\":\"Batch operation " +
+                                        std::to_string(request.operations.size() + 1) + ": " + error + "\"}");
+            return;
+        }
+        // These step the simulation or replace its state, so they cannot
+        // sit between operations applied with no update in between
+        if (operation.type == Operation::Type::FAST_FORWARD || operation.type == Operation::Type::RELOAD_SPEC ||
+            operation.type == Operation::Type::PLAY_PROFILE) {
+            send_reply(connection, tag, "{\"status\":\"error\",\"message\":\"Batch operation " +
+                                        std::to_string(request.operations.size() + 1) + ": " + tokens[0] +
+                                        (operation.type == Operation::Type::PLAY_PROFILE ? " play" : "") +
+                                        " cannot be batched\"}");
+            return;
+        }
+        if (request.operations.size() == MAX_BATCH_OPERATIONS) {
+            send_reply(connection, tag, "{\"status\":\"error\",\"message\":\"Batch exceeds " +
+                                        std::to_string(MAX_BATCH_OPERATIONS) + " operations\"}");
+            return;
+        }
+        request.operations.push_back(operation);
+    }
+
+    if (request.operations.empty()) {
+        send_reply(connection, tag, "{\"status\":\"error\",\"message\":\"Empty batch\"}");
+        return;
+    }
+    submit(connection, std::move(request));
+}
+
+void ServerShard::submit(Connection& connection, Command command) {
+    // A waited command owes a reply and a completion event; capping what
+    // is owed keeps the reply queue from ever overflowing
+    size_t owed = command.wait ? 2 : 1;
+    RequestTag tag = command.tag;
+    if (replies_owed_ + owed > COMMAND_QUEUE_SIZE || !commands_.try_push(std::move(command))) {
+        send_reply(connection, tag, "{\"status\":\"error\",\"message\":\"Server busy, try again\"}");
+        return;
+    }
+    replies_owed_ += owed;
+    connection.awaiting_reply = true;
+}
+
+std::string ServerShard::status_reply() {
+    return StatusEncoder::to_json(server_.snapshot()->status);
+}
+
+std::string ServerShard::bus_reply() {
+    auto snapshot = server_.snapshot();
+    if (!snapshot->bus_enabled) {
+        return "{\"status\":\"error\",\"message\":\"Switchboard is not enabled\"}";
+    }
+
+    const Switchboard::Bus& bus = snapshot->bus;
+    std::ostringstream response;
+    response << "{\"status\":\"success\",\"data\":{\"frequency\":" << bus.frequency
+             << ",\"voltage\":" << bus.voltage
+             << ",\"demand_kw\":" << bus.demand_kw
+             << ",\"demand_kvar\":" << bus.demand_kvar
+             << ",\"disturbance_kw\":" << bus.load_kw() - bus.demand_kw
+             << ",\"shed_kw\":" << bus.shed_kw
+             << ",\"unserved_kw\":" << bus.unserved_kw
+             << ",\"units\":[";
+    for (size_t i = 0; i < bus.unit_count; ++i) {
+        const Switchboard::UnitConfig& unit = bus.units[i];
+        if (i > 0) response << ",";
+        response << "{\"unit\":" << i
+                 << ",\"mode\":\"" << Switchboard::mode_name(unit.mode) << "\""
+                 << ",\"droop\":" << unit.speed_droop * 100.0
+                 << ",\"running\":" << (bus.running[i] ? "true" : "false")
+                 << ",\"breaker\":\"" << (bus.breaker_closed[i] ? "closed" : "open") << "\""
+                 << ",\"kw\":" << bus.unit_kw[i]
+                 << ",\"kvar\":" << bus.unit_kvar[i]
+                 << ",\"load\":" << bus.unit_kw[i] / unit.rated_kw * 100.0 << "}";
+    }
+    response << "]}}";
+    return response.str();
+}
+
+std::string ServerShard::pms_reply() {
+    auto snapshot = server_.snapshot();
+    if (!snapshot->bus_enabled) {
+        return "{\"status\":\"error\",\"message\":\"Switchboard is not enabled\"}";
+    }
+
+    const PowerManagement& pms = snapshot->power_management;
+    std::ostringstream response;
+    response << "{\"status\":\"success\",\"data\":{\"enabled\":" << (pms.enabled() ? "true" : "false")
+             << ",\"shed_kw\":" << snapshot->bus.shed_kw
+             << ",\"evaluations\":" << pms.evaluations()
+             << ",\"units\":[";
+    for (size_t i = 0; i < snapshot->bus.unit_count; ++i) {
+        if (i > 0) response << ",";
+        response << "{\"unit\":" << i
+                 << ",\"priority\":" << pms.priority(i)
+                 << ",\"state\":\"" << PowerManagement::state_name(pms.unit_state(i)) << "\"}";
+    }
+    response << "],\"tiers\":[";
+    for (size_t i = 0; i < PowerManagement::MAX_TIERS; ++i) {
+        if (i > 0) response << ",";
+        response << "{\"tier\":" << i + 1
+                 << ",\"kw\":" << pms.tier_kw(i)
+                 << ",\"shed\":" << (i < pms.shed_tiers() ? "true" : "false") << "}";
+    }
+    response << "]}}";
+    return response.str();
+}
+
+std::string ServerShard::profile_reply() {
+    auto snapshot = server_.snapshot();
+    std::ostringstream response;
+    response << "{\"status\":\"success\",\"data\":{";
+    for (size_t i = 0; i < PROFILE_TARGET_COUNT; ++i) {
+        auto target = static_cast<ProfileTarget>(i);
+        const LoadProfile::Status& profile = snapshot->profiles[i];
+        if (i > 0) response << ",";
+        response << "\"" << profile_target_name(target) << "\":{"
+                 << "\"file\":\"" << server_.profile_file(target) << "\""
+                 << ",\"state\":\"" << LoadProfile::state_name(profile.state) << "\""
+                 << ",\"position\":" << profile.position
+                 << ",\"samples\":" << profile.samples
+                 << ",\"sample_time\":" << profile.sample.time
+                 << ",\"values\":[" << profile.sample.values[0] << "," << profile.sample.values[1] << "]}";
+    }
+    response << "}}";
+    return response.str();
+}
+
+std::string ServerShard::spectrum_reply() {
+    auto snapshot = server_.snapshot();
+    const VibrationSpectrum& spectrum = snapshot->spectrum;
+    std::ostringstream response;
+    response << "{\"status\":\"success\",\"data\":{\"sample_rate\":" << spectrum.sample_rate
+             << ",\"resolution\":" << spectrum.resolution()
+             << ",\"shaft_speed\":" << spectrum.shaft_speed
+             << ",\"bands\":{";
+    for (size_t i = 0; i < VibrationSpectrum::BAND_COUNT; ++i) {
+        const VibrationSpectrum::BandValues& band = spectrum.bands[i];
+        if (i > 0) response << ",";
+        response << "\"" << VibrationSpectrum::band_name(static_cast<VibrationSpectrum::Band>(i)) << "\":{"
+                 << "\"rms\":" << band.rms
+                 << ",\"peak\":" << band.peak
+                 << ",\"peak_frequency\":" << band.peak_frequency << "}";
+    }
+    response << "},\"amplitude\":[";
+    for (size_t k = 0; k < VibrationSpectrum::BINS; ++k) {
+        if (k > 0) response << ",";
+        response << spectrum.amplitude[k];
+    }
+    response << "]}}";
+    return response.str();
+}
+
+std::string ServerShard::configure_stream(Connection& connection, const std::vector<std::string>& args) {
+    // stream off | stream <rate_hz> [json|binary] [delta]
+    if (args.size() < 2) {
+        return "{\"status\":\"error\",\"message\":\"Missing stream rate\"}";
+    }
+
+    if (args[1] == "off") {
+        connection.streaming = false;
+        return "{\"status\":\"success\",\"message\":\"Streaming stopped\"}";
+    }
+
+    double rate;
+    try {
+        rate = parse_number(args[1]);
+    } catch (const std::exception& e) {
+        return "{\"status\":\"error\",\"message\":\"Invalid stream rate\"}";
+    }
+    if (!(rate > 0.0 && rate <= MAX_STREAM_RATE)) {
+        return "{\"status\":\"error\",\"message\":\"Stream rate must be between 0 and " +
+               std::to_string(static_cast<int>(MAX_STREAM_RATE)) + " Hz\"}";
+    }
+
+    StreamEncoding encoding = StreamEncoding::JSON;
+    bool delta = false;
+    for (size_t i = 2; i < args.size(); ++i) {
+        if (args[i] == "binary") {
+            if (connection.protocol != Protocol::WEBSOCKET) {
+                return "{\"status\":\"error\",\"message\":\"Binary streaming requires a WebSocket connection\"}";
+            }
+            encoding = StreamEncoding::BINARY;
+        } else if (args[i] == "delta") {
+            delta = true;
+        } else if (args[i] != "json") {
+            return "{\"status\":\"error\",\"message\":\"Unknown stream option: " + args[i] + "\"}";
+        }
+    }
+
+    connection.streaming = true;
+    connection.encoding = encoding;
+    connection.delta = delta;
+    connection.delta_encoder.reset();
+    connection.stream_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / rate));
+    connection.next_stream = std::chrono::steady_clock::now();
+
+    std::ostringstream message;
+    message << "{\"status\":\"success\",\"message\":\"Streaming " << (delta ? "delta " : "")
+            << "status at " << rate << " Hz\"}";
+    return message.str();
+}
+
+std::string ServerShard::configure_deadband(Connection& connection, const std::vector<std::string>& args) {
+    // deadband <field> <value> | deadband keyframe <slots>
+    if (args.size() < 3) {
+        return "{\"status\":\"error\",\"message\":\"Usage: deadband <field|keyframe> <value>\"}";
+    }
+
+    double value;
+    try {
+        value = parse_number(args[2]);
+    } catch (const std::exception& e) {
+        return "{\"status\":\"error\",\"message\":\"Invalid deadband value\"}";
+    }
+
+    if (args[1] == "keyframe") {
+        if (!(value >= 1.0 && value <= 1e6)) {
+            return "{\"status\":\"error\",\"message\":\"Keyframe interval must be between 1 and 1000000\"}";
+        }
+        connection.delta_encoder.set_keyframe_interval(static_cast<uint32_t>(value));
+        return "{\"status\":\"success\",\"message\":\"Keyframe every " +
+               std::to_string(static_cast<uint32_t>(value)) + " frames\"}";
+    }
+
+    StatusEncoder::Field field;
+    if (!StatusEncoder::parse_field(args[1], field)) {
+        return "{\"status\":\"error\",\"message\":\"Unknown field: " + args[1] + "\"}";
+    }
+    if (!(value >= 0.0)) {
+        return "{\"status\":\"error\",\"message\":\"Deadband must not be negative\"}";
+    }
+
+    connection.delta_encoder.set_deadband(field, value);
+    return "{\"status\":\"success\",\"message\":\"Deadband for " + args[1] + " set to " +
+           std::to_string(value) + "\"}";
+}
+
+std::string ServerShard::configure_queue(Connection& connection, const std::vector<std::string>& args) {
+    // queue <conflate|drop_oldest|disconnect> [max_frames]
+    OutputQueue::Policy policy;
+    if (args.size() < 2 || !OutputQueue::parse_policy(args[1], policy)) {
+        return "{\"status\":\"error\",\"message\":\"Queue policy must be conflate, drop_oldest or disconnect\"}";
+    }
+
+    size_t max_frames = connection.output.max_frames();
+    if (args.size() > 2) {
+        try {
+            int value = parse_integer(args[2]);
+            if (value < 1 || static_cast<size_t>(value) > MAX_QUEUE_FRAMES) {
+                throw std::out_of_range("queue size");
+            }
+            max_frames = static_cast<size_t>(value);
+        } catch (const std::exception& e) {
+            return "{\"status\":\"error\",\"message\":\"Queue size must be between 1 and " +
+                   std::to_string(MAX_QUEUE_FRAMES) + "\"}";
+        }
+    }
+
+    connection.output.set_policy(policy);
+    connection.output.set_limits(max_frames, OutputQueue::DEFAULT_MAX_BYTES);
+    return "{\"status\":\"success\",\"message\":\"Output queue set to " +
+           std::string(OutputQueue::policy_name(policy)) + " with " + std::to_string(max_frames) + " frames\"}";
+}
+
+std::string ServerShard::describe_clients() const {
+    std::ostringstream response;
+    response << "{\"status\":\"success\",\"data\":[";
+    bool first = true;
+    for (const auto& connection : connections_) {
+        if (connection.closed) {
+            continue;
+        }
+        if (!first) response << ",";
+        first = false;
+        response << "{\"id\":" << connection.id
+                 << ",\"shard\":" << index_
+                 << ",\"address\":\"" << connection.address << "\""
+                 << ",\"websocket\":" << (connection.protocol == Protocol::WEBSOCKET ? "true" : "false")
+                 << ",\"streaming\":" << (connection.streaming ? "true" : "false")
+                 << ",\"policy\":\"" << OutputQueue::policy_name(connection.output.policy()) << "\""
+                 << ",\"queue_depth\":" << connection.output.depth()
+                 << ",\"queued_bytes\":" << connection.output.bytes()
+                 << ",\"high_watermark\":" << connection.output.high_watermark()
+                 << ",\"dropped\":" << connection.output.dropped()
+                 << ",\"conflated\":" << connection.output.conflated();
+        uint64_t throttled = 0;
+        for (uint64_t count : connection.throttled) {
+            throttled += count;
+        }
+        response << ",\"throttled\":" << throttled << "}";
+    }
+    response << "]}";
+    return response.str();
+}
+
+std::string ServerShard::describe_limits(const Connection& connection) const {
+    std::ostringstream response;
+    response << "{\"status\":\"success\",\"data\":{\"classes\":{";
+    for (size_t i = 0; i < RateLimits::CLASS_COUNT; ++i) {
+        const TokenBucket& bucket = connection.buckets[i];
+        if (i > 0) response << ",";
+        response << "\"" << RateLimits::class_name(static_cast<RateLimits::Class>(i)) << "\":{"
+                 << "\"rate\":" << bucket.rate()
+                 << ",\"burst\":" << bucket.burst()
+                 << ",\"tokens\":" << static_cast<int>(bucket.tokens())
+                 << ",\"throttled\":" << connection.throttled[i] << "}";
+    }
+    response << "},\"connections\":" << server_.active_connections()
+             << ",\"max_connections\":" << server_.limits().max_connections
+             << ",\"rejected_connections\":" << server_.rejected_connections()
+             << ",\"throttled_total\":" << server_.throttled_commands() << "}}";
+    return response.str();
+}
+
+const ServerShard::StatusFrames& ServerShard::current_status_frames() {
+    auto snapshot = server_.snapshot();
+    if (status_frames_.snapshot == snapshot) {
+        return status_frames_;
+    }
+
+    const Generator::GeneratorStatus& status = snapshot->status;
+    std::string json = StatusEncoder::to_json(status);
+    std::string binary = StatusEncoder::to_binary(status, static_cast<uint32_t>(snapshot->tick));
+    status_frames_.snapshot = snapshot;
+    status_frames_.text_json = std::make_shared<const std::string>(json + "\n");
+    status_frames_.websocket_json = std::make_shared<const std::string>(
+        WebSocket::encode_frame(WebSocket::Opcode::TEXT, json));
+    status_frames_.websocket_binary = std::make_shared<const std::string>(
+        WebSocket::encode_frame(WebSocket::Opcode::BINARY, binary));
+    return status_frames_;
+}
+
+void ServerShard::stream_status() {
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto& connection : connections_) {
+        if (!connection.streaming || connection.closed || connection.closing || now < connection.next_stream) {
+            continue;
+        }
+
+        const StatusFrames& frames = current_status_frames();
+        if (connection.delta) {
+            stream_delta(connection, frames);
+        } else if (connection.protocol == Protocol::WEBSOCKET) {
+            send_frame(connection,
+                       connection.encoding == StreamEncoding::BINARY ? frames.websocket_binary : frames.websocket_json,
+                       OutputQueue::Kind::STATUS);
+        } else {
+            send_frame(connection, frames.text_json, OutputQueue::Kind::STATUS);
+        }
+
+        // Skip missed slots rather than bursting to catch up
+        connection.next_stream += connection.stream_interval;
+        if (connection.next_stream < now) {
+            connection.next_stream = now + connection.stream_interval;
+        }
+    }
+}
+
+void ServerShard::stream_delta(Connection& connection, const StatusFrames& frames) {
+    // Deltas are relative to what the client has received, so a dropped
+    // frame forces a keyframe and a still-queued one defers the next delta
+    // instead of being conflated away
+    if (connection.output.dropped() != connection.delta_drops_seen) {
+        connection.delta_drops_seen = connection.output.dropped();
+        connection.delta_encoder.reset();
+    }
+    if (connection.output.has_pending_status()) {
+        return;
+    }
+
+    uint8_t frame_type;
+    uint16_t field_mask;
+    bool state_changed;
+    bool alarms_changed;
+    const Generator::GeneratorStatus& status = frames.snapshot->status;
+    if (!connection.delta_encoder.next_frame(status, frame_type, field_mask, state_changed, alarms_changed)) {
+        return;
+    }
+
+    uint32_t sequence = static_cast<uint32_t>(frames.snapshot->tick);
+    std::string frame;
+    if (connection.encoding == StreamEncoding::BINARY) {
+        frame = WebSocket::encode_frame(WebSocket::Opcode::BINARY,
+                                        StatusEncoder::to_binary_frame(status, frame_type, field_mask, sequence));
+    } else {
+        std::string json =
+            StatusEncoder::to_json_frame(status, frame_type, field_mask, state_changed, alarms_changed, sequence);
+        frame = connection.protocol == Protocol::WEBSOCKET ? WebSocket::encode_frame(WebSocket::Opcode::TEXT, json)
+                                                           : json + "\n";
+    }
+
+    send_frame(connection, std::make_shared<const std::string>(std::move(frame)), OutputQueue::Kind::STATUS);
+    connection.delta_encoder.commit(status, frame_type, field_mask);
+}
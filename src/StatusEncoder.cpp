@@ -0,0 +1,262 @@
+#include "StatusEncoder.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+static void append_u16(std::string& out, uint16_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>((value >> 8) & 0xFF);
+}
+
+static void append_u32(std::string& out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out += static_cast<char>((value >> shift) & 0xFF);
+    }
+}
+
+static void append_f64(std::string& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int shift = 0; shift < 64; shift += 8) {
+        out += static_cast<char>((bits >> shift) & 0xFF);
+    }
+}
+
+// ISO 8601 UTC with milliseconds
+static std::string format_timestamp(std::chrono::system_clock::time_point time) {
+    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    std::time_t seconds = static_cast<std::time_t>(milliseconds / 1000);
+    std::tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    char text[64];
+    std::snprintf(text, sizeof(text), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", utc.tm_year + 1900, utc.tm_mon + 1,
+                  utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, static_cast<int>(milliseconds % 1000));
+    return text;
+}
+
+static std::string alarms_json(const Generator::GeneratorStatus& status) {
+    std::string out = "[";
+    for (const auto& alarm : status.active_alarms) {
+        if (out.size() > 1) {
+            out += ",";
+        }
+        out += "{\"type\":\"";
+        out += alarm_type_name(alarm.type);
+        out += "\",\"message\":\"";
+        for (char c : alarm.message) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        out += "\",\"timestamp\":\"" + format_timestamp(alarm.timestamp) + "\"}";
+    }
+    return out + "]";
+}
+
+std::string StatusEncoder::to_json(const Generator::GeneratorStatus& status) {
+    return "{\"status\":\"success\",\"data\":{\"state\":" +
+           std::to_string(static_cast<int>(status.state)) +
+           ",\"rpm\":" + std::to_string(status.rpm) +
+           ",\"voltage\":" + std::to_string(status.voltage) +
+           ",\"frequency\":" + std::to_string(status.frequency) +
+           ",\"load\":" + std::to_string(status.load_percentage) +
+           ",\"fuel_level\":" + std::to_string(status.fuel_level) +
+           ",\"oil_pressure\":" + std::to_string(status.oil_pressure) +
+           ",\"cooling_temp\":" + std::to_string(status.cooling_temp) +
+           ",\"voltage_ab\":" + std::to_string(status.electrical.line_voltage[0]) +
+           ",\"voltage_bc\":" + std::to_string(status.electrical.line_voltage[1]) +
+           ",\"voltage_ca\":" + std::to_string(status.electrical.line_voltage[2]) +
+           ",\"current_a\":" + std::to_string(status.electrical.current[0]) +
+           ",\"current_b\":" + std::to_string(status.electrical.current[1]) +
+           ",\"current_c\":" + std::to_string(status.electrical.current[2]) +
+           ",\"active_power\":" + std::to_string(status.electrical.active_power) +
+           ",\"reactive_power\":" + std::to_string(status.electrical.reactive_power) +
+           ",\"apparent_power\":" + std::to_string(status.electrical.apparent_power) +
+           ",\"power_factor\":" + std::to_string(status.electrical.power_factor) +
+           ",\"alarms\":" + alarms_json(status) + "}}";
+}
+
+std::string StatusEncoder::to_binary(const Generator::GeneratorStatus& status, uint32_t sequence) {
+    return to_binary_frame(status, FRAME_FULL, ALL_FIELDS, sequence);
+}
+
+std::string StatusEncoder::to_json_frame(const Generator::GeneratorStatus& status, uint8_t frame_type,
+                                         uint16_t field_mask, bool include_state, bool include_alarms,
+                                         uint32_t sequence) {
+    std::string out = "{\"status\":\"success\",\"type\":\"";
+    out += frame_type == FRAME_DELTA ? "delta" : "keyframe";
+    out += "\",\"seq\":" + std::to_string(sequence) + ",\"data\":{";
+
+    bool first = true;
+    if (include_state) {
+        out += "\"state\":" + std::to_string(static_cast<int>(status.state));
+        first = false;
+    }
+    for (int i = 0; i < static_cast<int>(Field::COUNT); ++i) {
+        if (field_mask & (1u << i)) {
+            if (!first) out += ",";
+            out += "\"";
+            out += field_name(static_cast<Field>(i));
+            out += "\":" + std::to_string(field_value(status, static_cast<Field>(i)));
+            first = false;
+        }
+    }
+    if (include_alarms) {
+        if (!first) out += ",";
+        out += "\"alarms\":" + alarms_json(status);
+    }
+    out += "}}";
+    return out;
+}
+
+std::string StatusEncoder::to_binary_frame(const Generator::GeneratorStatus& status, uint8_t frame_type,
+                                           uint16_t field_mask, uint32_t sequence) {
+    constexpr int field_count = static_cast<int>(Field::COUNT);
+
+    std::string out;
+    out.reserve(BINARY_HEADER_SIZE + field_count * sizeof(double));
+    out += static_cast<char>(frame_type);
+    out += static_cast<char>(static_cast<uint8_t>(status.state));
+    append_u16(out, field_mask);
+    append_u16(out, alarm_mask(status));
+    append_u16(out, 0);
+    append_u32(out, sequence);
+
+    for (int i = 0; i < field_count; ++i) {
+        if (field_mask & (1u << i)) {
+            append_f64(out, field_value(status, static_cast<Field>(i)));
+        }
+    }
+    return out;
+}
+
+double StatusEncoder::field_value(const Generator::GeneratorStatus& status, Field field) {
+    switch (field) {
+        case Field::RPM: return status.rpm;
+        case Field::VOLTAGE: return status.voltage;
+        case Field::FREQUENCY: return status.frequency;
+        case Field::LOAD: return status.load_percentage;
+        case Field::FUEL_LEVEL: return status.fuel_level;
+        case Field::OIL_PRESSURE: return status.oil_pressure;
+        case Field::COOLING_TEMP: return status.cooling_temp;
+        case Field::COUNT: break;
+    }
+    return 0.0;
+}
+
+const char* StatusEncoder::field_name(Field field) {
+    // Same keys as the JSON status reply
+    switch (field) {
+        case Field::RPM: return "rpm";
+        case Field::VOLTAGE: return "voltage";
+        case Field::FREQUENCY: return "frequency";
+        case Field::LOAD: return "load";
+        case Field::FUEL_LEVEL: return "fuel_level";
+        case Field::OIL_PRESSURE: return "oil_pressure";
+        case Field::COOLING_TEMP: return "cooling_temp";
+        case Field::COUNT: break;
+    }
+    return "";
+}
+
+bool StatusEncoder::parse_field(const std::string& name, Field& field) {
+    for (int i = 0; i < static_cast<int>(Field::COUNT); ++i) {
+        if (name == field_name(static_cast<Field>(i))) {
+            field = static_cast<Field>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint16_t StatusEncoder::alarm_mask(const Generator::GeneratorStatus& status) {
+    uint16_t mask = 0;
+    for (const auto& alarm : status.active_alarms) {
+        mask |= static_cast<uint16_t>(1u << static_cast<int>(alarm.type));
+    }
+    return mask;
+}
+
+DeltaEncoder::DeltaEncoder()
+    : last_state_(Generator::State::STOPPED)
+    , last_alarm_mask_(0)
+    , keyframe_interval_(DEFAULT_KEYFRAME_INTERVAL)
+    , slots_since_keyframe_(0)
+    , keyframe_pending_(true)
+{
+    // Default deadbands sit just above the simulated sensor noise
+    deadbands_[static_cast<int>(StatusEncoder::Field::RPM)] = 2.0;           // RPM
+    deadbands_[static_cast<int>(StatusEncoder::Field::VOLTAGE)] = 1.0;       // V
+    deadbands_[static_cast<int>(StatusEncoder::Field::FREQUENCY)] = 0.05;    // Hz
+    deadbands_[static_cast<int>(StatusEncoder::Field::LOAD)] = 0.5;          // %
+    deadbands_[static_cast<int>(StatusEncoder::Field::FUEL_LEVEL)] = 0.5;    // %
+    deadbands_[static_cast<int>(StatusEncoder::Field::OIL_PRESSURE)] = 0.05; // bar
+    deadbands_[static_cast<int>(StatusEncoder::Field::COOLING_TEMP)] = 0.5;  // Celsius
+
+    for (double& value : last_sent_) {
+        value = 0.0;
+    }
+}
+
+void DeltaEncoder::set_deadband(StatusEncoder::Field field, double deadband) {
+    deadbands_[static_cast<int>(field)] = deadband;
+}
+
+void DeltaEncoder::set_keyframe_interval(uint32_t frames) {
+    keyframe_interval_ = frames;
+}
+
+double DeltaEncoder::deadband(StatusEncoder::Field field) const {
+    return deadbands_[static_cast<int>(field)];
+}
+
+bool DeltaEncoder::next_frame(const Generator::GeneratorStatus& status, uint8_t& frame_type,
+                              uint16_t& field_mask, bool& state_changed, bool& alarms_changed) {
+    // Keyframes are paced by stream slots so a quiet stream still resyncs
+    ++slots_since_keyframe_;
+    if (keyframe_pending_ || slots_since_keyframe_ >= keyframe_interval_) {
+        frame_type = StatusEncoder::FRAME_FULL;
+        field_mask = StatusEncoder::ALL_FIELDS;
+        state_changed = true;
+        alarms_changed = true;
+        return true;
+    }
+
+    field_mask = 0;
+    for (int i = 0; i < static_cast<int>(StatusEncoder::Field::COUNT); ++i) {
+        double value = StatusEncoder::field_value(status, static_cast<StatusEncoder::Field>(i));
+        if (std::abs(value - last_sent_[i]) > deadbands_[i]) {
+            field_mask |= static_cast<uint16_t>(1u << i);
+        }
+    }
+
+    frame_type = StatusEncoder::FRAME_DELTA;
+    state_changed = status.state != last_state_;
+    alarms_changed = StatusEncoder::alarm_mask(status) != last_alarm_mask_;
+    return field_mask != 0 || state_changed || alarms_changed;
+}
+
+void DeltaEncoder::commit(const Generator::GeneratorStatus& status, uint8_t frame_type, uint16_t field_mask) {
+    for (int i = 0; i < static_cast<int>(StatusEncoder::Field::COUNT); ++i) {
+        if (field_mask & (1u << i)) {
+            last_sent_[i] = StatusEncoder::field_value(status, static_cast<StatusEncoder::Field>(i));
+        }
+    }
+    last_state_ = status.state;
+    last_alarm_mask_ = StatusEncoder::alarm_mask(status);
+
+    if (frame_type == StatusEncoder::FRAME_FULL) {
+        slots_since_keyframe_ = 0;
+        keyframe_pending_ = false;
+    }
+}
+
+void DeltaEncoder::reset() {
+    keyframe_pending_ = true;
+}
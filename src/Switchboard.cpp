@@ -0,0 +1,255 @@
+#include "Switchboard.h"
+#include <algorithm>
+#include <cmath>
+
+Switchboard::UnitConfig::UnitConfig()
+    : rated_kw(1000.0)
+    , rated_kvar(750.0)
+    , mode(Mode::DROOP)
+    , speed_droop(0.04)
+    , voltage_droop(0.04)
+    , speed_setpoint(1.02)   // Nominal frequency at half load
+    , voltage_setpoint(1.0)
+{
+}
+
+size_t Switchboard::add_bus(double nominal_frequency, double nominal_voltage) {
+    Bus bus;
+    bus.nominal_frequency = nominal_frequency;
+    bus.nominal_voltage = nominal_voltage;
+    bus.demand_kw = 0.0;
+    bus.demand_kvar = 0.0;
+    bus.disturbance = 0.0;
+    bus.shed_kw = 0.0;
+    bus.unit_count = 0;
+    bus.frequency = 0.0;
+    bus.voltage = 0.0;
+    bus.unserved_kw = 0.0;
+    for (size_t i = 0; i < MAX_UNITS; ++i) {
+        bus.running[i] = false;
+        bus.breaker_closed[i] = false;
+        bus.unit_kw[i] = 0.0;
+        bus.unit_kvar[i] = 0.0;
+    }
+    buses_.push_back(bus);
+    return buses_.size() - 1;
+}
+
+bool Switchboard::add_unit(size_t bus, const UnitConfig& config) {
+    Bus& target = buses_[bus];
+    if (target.unit_count == MAX_UNITS || !(config.rated_kw > 0.0) || !(config.rated_kvar > 0.0)) {
+        return false;
+    }
+    size_t unit = target.unit_count++;
+    target.units[unit] = config;
+    target.units[unit].speed_droop = std::min(std::max(config.speed_droop, MIN_DROOP), MAX_DROOP);
+    target.units[unit].voltage_droop = std::min(std::max(config.voltage_droop, MIN_DROOP), MAX_DROOP);
+    target.running[unit] = false;
+    target.breaker_closed[unit] = true;
+    return true;
+}
+
+bool Switchboard::configure_unit(Bus& bus, size_t unit, Mode mode, double speed_droop) {
+    if (unit >= bus.unit_count || !(speed_droop >= MIN_DROOP && speed_droop <= MAX_DROOP)) {
+        return false;
+    }
+    // Keep nominal frequency at half load
+    bus.units[unit].mode = mode;
+    bus.units[unit].speed_droop = speed_droop;
+    bus.units[unit].speed_setpoint = 1.0 + speed_droop / 2.0;
+    return true;
+}
+
+bool Switchboard::rate_unit(Bus& bus, size_t unit, double rated_kw, double rated_kvar) {
+    // As add_unit: both droop lines need a gain
+    if (unit >= bus.unit_count || !(rated_kw > 0.0) || !(rated_kvar > 0.0)) {
+        return false;
+    }
+    bus.units[unit].rated_kw = rated_kw;
+    bus.units[unit].rated_kvar = rated_kvar;
+    return true;
+}
+
+void Switchboard::solve() {
+    for (auto& bus : buses_) {
+        solve(bus);
+    }
+}
+
+void Switchboard::solve(Bus& bus) {
+    Lines active;
+    Lines reactive;
+    size_t slots[MAX_UNITS];
+    size_t count = 0;
+
+    for (size_t i = 0; i < bus.unit_count; ++i) {
+        bus.unit_kw[i] = 0.0;
+        bus.unit_kvar[i] = 0.0;
+        if (!bus.connected(i)) {
+            continue;
+        }
+
+        const UnitConfig& unit = bus.units[i];
+        bool isochronous = unit.mode == Mode::ISOCHRONOUS;
+        active.gain[count] = unit.rated_kw / unit.speed_droop;
+        active.setpoint[count] = unit.speed_setpoint;
+        active.low[count] = 0.0;
+        active.high[count] = unit.rated_kw;
+        active.isochronous[count] = isochronous;
+        reactive.gain[count] = unit.rated_kvar / unit.voltage_droop;
+        reactive.setpoint[count] = unit.voltage_setpoint;
+        reactive.low[count] = -unit.rated_kvar;
+        reactive.high[count] = unit.rated_kvar;
+        reactive.isochronous[count] = isochronous;
+        slots[count++] = i;
+    }
+
+    double demand_kw = std::max(bus.load_kw() - bus.shed_kw, 0.0);
+    double demand_kvar = bus.demand_kw > 0.0 ? bus.demand_kvar * demand_kw / bus.demand_kw : 0.0;
+    if (count == 0) {
+        // Dead bus
+        bus.frequency = 0.0;
+        bus.voltage = 0.0;
+        bus.unserved_kw = demand_kw;
+        return;
+    }
+    active.count = count;
+    reactive.count = count;
+
+    // The last solution is the starting point; demand rarely jumps between ticks
+    double kw[MAX_UNITS];
+    double kvar[MAX_UNITS];
+    double unserved_kvar;
+    bus.frequency = share(active, demand_kw, bus.frequency / bus.nominal_frequency, kw, bus.unserved_kw) *
+                    bus.nominal_frequency;
+    bus.voltage = share(reactive, demand_kvar, bus.voltage / bus.nominal_voltage, kvar, unserved_kvar) *
+                  bus.nominal_voltage;
+    for (size_t i = 0; i < count; ++i) {
+        bus.unit_kw[slots[i]] = kw[i];
+        bus.unit_kvar[slots[i]] = kvar[i];
+    }
+}
+
+double Switchboard::share(const Lines& lines, double demand, double guess, double* output, double& unserved) {
+    // Isochronous units absorb whatever the droop units leave at nominal
+    double droop_at_nominal = 0.0;
+    double iso_low = 0.0;
+    double iso_high = 0.0;
+    bool any_isochronous = false;
+    bool any_droop = false;
+    for (size_t i = 0; i < lines.count; ++i) {
+        if (lines.isochronous[i]) {
+            iso_low += lines.low[i];
+            iso_high += lines.high[i];
+            any_isochronous = true;
+        } else {
+            output[i] = std::min(std::max(lines.gain[i] * (lines.setpoint[i] - 1.0), lines.low[i]), lines.high[i]);
+            droop_at_nominal += output[i];
+            any_droop = true;
+        }
+    }
+
+    unserved = 0.0;
+    double remainder = demand - droop_at_nominal;
+    if (any_isochronous && remainder >= iso_low && remainder <= iso_high) {
+        for (size_t i = 0; i < lines.count; ++i) {
+            if (lines.isochronous[i]) {
+                output[i] = remainder * lines.high[i] / iso_high;
+            }
+        }
+        return 1.0;
+    }
+
+    // Saturated isochronous units are fixed sources; the droop units set the bus
+    double fixed = 0.0;
+    for (size_t i = 0; i < lines.count; ++i) {
+        if (lines.isochronous[i]) {
+            output[i] = remainder > iso_high ? lines.high[i] : lines.low[i];
+            fixed += output[i];
+        }
+    }
+    if (!any_droop) {
+        unserved = demand - fixed;
+        return 1.0;
+    }
+
+    // The droop supply curve is piecewise linear and falls as the bus
+    // rises; bracket the answer between its flat ends
+    double target = demand - fixed;
+    double bracket_low = 1.0;
+    double bracket_high = 1.0;
+    double supply_min = 0.0;
+    double supply_max = 0.0;
+    for (size_t i = 0; i < lines.count; ++i) {
+        if (!lines.isochronous[i]) {
+            bracket_low = std::min(bracket_low, lines.setpoint[i] - lines.high[i] / lines.gain[i]);
+            bracket_high = std::max(bracket_high, lines.setpoint[i] - lines.low[i] / lines.gain[i]);
+            supply_min += lines.low[i];
+            supply_max += lines.high[i];
+        }
+    }
+    if (target >= supply_max || target <= supply_min) {
+        double limit = target >= supply_max ? supply_max : supply_min;
+        for (size_t i = 0; i < lines.count; ++i) {
+            if (!lines.isochronous[i]) {
+                output[i] = target >= supply_max ? lines.high[i] : lines.low[i];
+            }
+        }
+        unserved = target - limit;
+        return target >= supply_max ? bracket_low : bracket_high;
+    }
+
+    // Safeguarded Newton: exact as soon as it lands on the right segment
+    double tolerance = 1e-9 * (supply_max - supply_min);
+    double x = guess > bracket_low && guess < bracket_high ? guess : 1.0;
+    for (int iteration = 0;; ++iteration) {
+        double supply = 0.0;
+        double slope = 0.0;
+        for (size_t i = 0; i < lines.count; ++i) {
+            if (lines.isochronous[i]) {
+                continue;
+            }
+            double value = lines.gain[i] * (lines.setpoint[i] - x);
+            if (value >= lines.high[i]) {
+                value = lines.high[i];
+            } else if (value <= lines.low[i]) {
+                value = lines.low[i];
+            } else {
+                slope += lines.gain[i];
+            }
+            output[i] = value;
+            supply += value;
+        }
+
+        double error = supply - target;
+        if (std::abs(error) <= tolerance || iteration == MAX_SOLVER_ITERATIONS) {
+            return x;
+        }
+        if (error > 0.0) {
+            bracket_low = x;
+        } else {
+            bracket_high = x;
+        }
+        double next = slope > 0.0 ? x + error / slope : 0.5 * (bracket_low + bracket_high);
+        x = next > bracket_low && next < bracket_high ? next : 0.5 * (bracket_low + bracket_high);
+    }
+}
+
+const char* Switchboard::mode_name(Mode mode) {
+    switch (mode) {
+        case Mode::DROOP: return "droop";
+        case Mode::ISOCHRONOUS: return "isochronous";
+    }
+    return "unknown";
+}
+
+bool Switchboard::parse_mode(const std::string& name, Mode& mode) {
+    if (name == "droop") {
+        mode = Mode::DROOP;
+    } else if (name == "isochronous") {
+        mode = Mode::ISOCHRONOUS;
+    } else {
+        return false;
+    }
+    return true;
+}
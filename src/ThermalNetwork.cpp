@@ -0,0 +1,148 @@
+#include "ThermalNetwork.h"
+#include <algorithm>
+#include <cmath>
+
+ThermalCoefficients ThermalCoefficients::from(const ThermalSpec& spec, double alarm_temp) {
+    ThermalCoefficients coefficients;
+    coefficients.jacket_rate = spec.jacket_heat / spec.jacket_capacity;
+    coefficients.oil_rate = spec.oil_heat / spec.oil_capacity;
+    coefficients.exhaust_rate = spec.exhaust_heat / spec.exhaust_capacity;
+    coefficients.oil_to_jacket = spec.oil_conductance / spec.jacket_capacity;
+    coefficients.jacket_to_oil = spec.oil_conductance / spec.oil_capacity;
+    coefficients.cooling = spec.cooler_conductance / spec.jacket_capacity;
+    coefficients.ambient_loss = spec.ambient_conductance / spec.jacket_capacity;
+    coefficients.exhaust_loss = spec.exhaust_conductance / spec.exhaust_capacity;
+    coefficients.sea_temp = spec.sea_temp;
+    coefficients.thermostat_open = spec.thermostat_open;
+    coefficients.thermostat_scale = 1.0 / (spec.thermostat_full - spec.thermostat_open);
+    coefficients.alarm_temp = alarm_temp;
+    return coefficients;
+}
+
+size_t ThermalNetwork::add(const ThermalCoefficients& coefficients) {
+    for (auto* column : {&jacket_rate_, &oil_rate_, &exhaust_rate_, &oil_to_jacket_, &jacket_to_oil_, &cooling_,
+                         &ambient_loss_, &exhaust_loss_, &sea_temp_, &thermostat_open_, &thermostat_scale_,
+                         &alarm_temp_}) {
+        column->push_back(0.0);
+    }
+    set(size() - 1, coefficients);
+    return size() - 1;
+}
+
+void ThermalNetwork::set(size_t engine, const ThermalCoefficients& coefficients) {
+    jacket_rate_[engine] = coefficients.jacket_rate;
+    oil_rate_[engine] = coefficients.oil_rate;
+    exhaust_rate_[engine] = coefficients.exhaust_rate;
+    oil_to_jacket_[engine] = coefficients.oil_to_jacket;
+    jacket_to_oil_[engine] = coefficients.jacket_to_oil;
+    cooling_[engine] = coefficients.cooling;
+    ambient_loss_[engine] = coefficients.ambient_loss;
+    exhaust_loss_[engine] = coefficients.exhaust_loss;
+    sea_temp_[engine] = coefficients.sea_temp;
+    thermostat_open_[engine] = coefficients.thermostat_open;
+    thermostat_scale_[engine] = coefficients.thermostat_scale;
+    alarm_temp_[engine] = coefficients.alarm_temp;
+}
+
+void ThermalNetwork::integrate(const double* delta_time, const double* heat, const double* ambient, double* jacket,
+                               double* oil, double* exhaust, double* crossing) const {
+    Columns columns = {jacket_rate_.data(), oil_rate_.data(), exhaust_rate_.data(), oil_to_jacket_.data(),
+                       jacket_to_oil_.data(), cooling_.data(), ambient_loss_.data(), exhaust_loss_.data(),
+                       sea_temp_.data(), thermostat_open_.data(), thermostat_scale_.data(), alarm_temp_.data()};
+    integrate(columns, size(), delta_time, heat, ambient, jacket, oil, exhaust, crossing);
+}
+
+void ThermalNetwork::integrate(const ThermalCoefficients& coefficients, double delta_time, double heat,
+                               double ambient, State& state, double& crossing) {
+    const ThermalCoefficients& c = coefficients;
+    Columns columns = {&c.jacket_rate, &c.oil_rate, &c.exhaust_rate, &c.oil_to_jacket, &c.jacket_to_oil,
+                       &c.cooling, &c.ambient_loss, &c.exhaust_loss, &c.sea_temp, &c.thermostat_open,
+                       &c.thermostat_scale, &c.alarm_temp};
+    integrate(columns, 1, &delta_time, &heat, &ambient, &state.jacket, &state.oil, &state.exhaust, &crossing);
+}
+
+void ThermalNetwork::integrate(const Columns& c, size_t count, const double* delta_time, const double* heat,
+                               const double* ambient, double* jacket, double* oil, double* exhaust,
+                               double* crossing) {
+    // Engines a block at a time, so the stages of a block stay in L1
+    constexpr size_t BLOCK = 64;
+
+    for (size_t i = 0; i < count; ++i) {
+        crossing[i] = jacket[i] > c.alarm_temp[i] ? 0.0 : -1.0;
+    }
+
+    for (size_t first = 0; first < count; first += BLOCK) {
+        const size_t last = std::min(first + BLOCK, count);
+
+        // As many steps as the longest interval of the block needs, each
+        // engine's interval split evenly over them
+        double longest = 0.0;
+        for (size_t i = first; i < last; ++i) {
+            longest = std::max(longest, delta_time[i]);
+        }
+        if (!(longest > 0.0)) {
+            continue;
+        }
+        const long steps = static_cast<long>(std::ceil(longest / MAX_STEP));
+        double h[BLOCK];
+        for (size_t i = first; i < last; ++i) {
+            h[i - first] = std::max(delta_time[i], 0.0) / steps;
+        }
+
+        double k_jacket[4][BLOCK];
+        double k_oil[4][BLOCK];
+        double k_exhaust[4][BLOCK];
+
+        // Rates at the state offset by weight times h times the previous stage
+        auto stage = [&](int k, const double* d_jacket, const double* d_oil, const double* d_exhaust,
+                         size_t base, double weight) {
+            for (size_t i = first; i < last; ++i) {
+                size_t s = i - base;
+                double w = weight * h[i - first];
+                double t_jacket = jacket[i] + w * d_jacket[s];
+                double t_oil = oil[i] + w * d_oil[s];
+                double t_exhaust = exhaust[i] + w * d_exhaust[s];
+                double valve = std::min(std::max((t_jacket - c.thermostat_open[i]) * c.thermostat_scale[i], 0.0), 1.0);
+                k_jacket[k][i - first] = c.jacket_rate[i] * heat[i] + c.oil_to_jacket[i] * (t_oil - t_jacket) -
+                                         valve * c.cooling[i] * (t_jacket - c.sea_temp[i]) -
+                                         c.ambient_loss[i] * (t_jacket - ambient[i]);
+                k_oil[k][i - first] = c.oil_rate[i] * heat[i] - c.jacket_to_oil[i] * (t_oil - t_jacket);
+                k_exhaust[k][i - first] = c.exhaust_rate[i] * heat[i] - c.exhaust_loss[i] * (t_exhaust - ambient[i]);
+            }
+        };
+
+        for (long step = 0; step < steps; ++step) {
+            // The first stage reads the state itself with no offset
+            stage(0, jacket, oil, exhaust, 0, 0.0);
+            stage(1, k_jacket[0], k_oil[0], k_exhaust[0], first, 0.5);
+            stage(2, k_jacket[1], k_oil[1], k_exhaust[1], first, 0.5);
+            stage(3, k_jacket[2], k_oil[2], k_exhaust[2], first, 1.0);
+
+            for (size_t i = first; i < last; ++i) {
+                size_t s = i - first;
+                double before = jacket[i];
+                jacket[i] += h[s] / 6.0 *
+                             (k_jacket[0][s] + 2.0 * k_jacket[1][s] + 2.0 * k_jacket[2][s] + k_jacket[3][s]);
+                oil[i] += h[s] / 6.0 * (k_oil[0][s] + 2.0 * k_oil[1][s] + 2.0 * k_oil[2][s] + k_oil[3][s]);
+                exhaust[i] += h[s] / 6.0 *
+                              (k_exhaust[0][s] + 2.0 * k_exhaust[1][s] + 2.0 * k_exhaust[2][s] + k_exhaust[3][s]);
+
+                // Interpolated linearly within the RK4 step
+                double limit = c.alarm_temp[i];
+                double time = h[s] * (step + (limit - before) / (jacket[i] - before));
+                crossing[i] = crossing[i] < 0.0 && jacket[i] > limit ? time : crossing[i];
+            }
+
+            if ((step + 1) % SETTLE_CHECK_STEPS == 0) {
+                double fastest = 0.0;
+                for (size_t s = 0; s < last - first; ++s) {
+                    fastest = std::max({fastest, std::abs(k_jacket[0][s]), std::abs(k_oil[0][s]),
+                                        std::abs(k_exhaust[0][s])});
+                }
+                if (fastest < SETTLED_RATE) {
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,237 @@
+#include "WebSocket.h"
+#include <algorithm>
+#include <cctype>
+
+// GUID appended to the client key, fixed by RFC 6455 section 1.3
+static const char* const WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+static std::string to_lower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+bool WebSocket::is_upgrade_request(const std::string& request) {
+    if (request.compare(0, 4, "GET ") != 0) {
+        return false;
+    }
+    return to_lower(header_value(request, "upgrade")) == "websocket" &&
+           to_lower(header_value(request, "connection")).find("upgrade") != std::string::npos &&
+           !header_value(request, "sec-websocket-key").empty();
+}
+
+std::string WebSocket::handshake_response(const std::string& request) {
+    if (!is_upgrade_request(request)) {
+        return "";
+    }
+
+    return "HTTP/1.1 101 Switching Protocols\r\n"
+           "Upgrade: websocket\r\n"
+           "Connection: Upgrade\r\n"
+           "Sec-WebSocket-Accept: " + accept_key(header_value(request, "sec-websocket-key")) + "\r\n"
+           "\r\n";
+}
+
+std::string WebSocket::encode_frame(Opcode opcode, const std::string& payload) {
+    std::string frame;
+    frame.reserve(payload.size() + 10);
+    frame += static_cast<char>(0x80 | static_cast<uint8_t>(opcode));
+
+    uint64_t length = payload.size();
+    if (length < 126) {
+        frame += static_cast<char>(length);
+    } else if (length <= 0xFFFF) {
+        frame += static_cast<char>(126);
+        frame += static_cast<char>((length >> 8) & 0xFF);
+        frame += static_cast<char>(length & 0xFF);
+    } else {
+        frame += static_cast<char>(127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            frame += static_cast<char>((length >> shift) & 0xFF);
+        }
+    }
+
+    frame += payload;
+    return frame;
+}
+
+WebSocket::DecodeResult WebSocket::decode_frame(const std::string& buffer, size_t& consumed, Frame& frame) {
+    if (buffer.size() < 2) {
+        return DecodeResult::INCOMPLETE;
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(buffer.data());
+    bool final = (bytes[0] & 0x80) != 0;
+    uint8_t opcode = bytes[0] & 0x0F;
+    bool masked = (bytes[1] & 0x80) != 0;
+    uint64_t length = bytes[1] & 0x7F;
+    size_t offset = 2;
+
+    // Reserved bits are only valid with negotiated extensions, and clients must mask
+    if ((bytes[0] & 0x70) != 0 || !masked) {
+        return DecodeResult::INVALID;
+    }
+
+    if (length == 126) {
+        if (buffer.size() < offset + 2) return DecodeResult::INCOMPLETE;
+        length = (static_cast<uint64_t>(bytes[2]) << 8) | bytes[3];
+        offset += 2;
+    } else if (length == 127) {
+        if (buffer.size() < offset + 8) return DecodeResult::INCOMPLETE;
+        length = 0;
+        for (int i = 0; i < 8; ++i) {
+            length = (length << 8) | bytes[offset + i];
+        }
+        offset += 8;
+    }
+
+    if (length > MAX_PAYLOAD_SIZE) {
+        return DecodeResult::INVALID;
+    }
+
+    // Control frames are never fragmented and carry at most 125 bytes
+    if ((opcode & 0x08) != 0 && (!final || length > MAX_CONTROL_PAYLOAD)) {
+        return DecodeResult::INVALID;
+    }
+
+    if (buffer.size() < offset + 4 + length) {
+        return DecodeResult::INCOMPLETE;
+    }
+
+    const unsigned char* mask = bytes + offset;
+    offset += 4;
+
+    frame.opcode = static_cast<Opcode>(opcode);
+    frame.final = final;
+    frame.payload.assign(buffer, offset, static_cast<size_t>(length));
+    for (size_t i = 0; i < frame.payload.size(); ++i) {
+        frame.payload[i] = static_cast<char>(frame.payload[i] ^ mask[i % 4]);
+    }
+
+    consumed = offset + static_cast<size_t>(length);
+    return DecodeResult::COMPLETE;
+}
+
+std::string WebSocket::header_value(const std::string& request, const std::string& name) {
+    std::string lowered = to_lower(request);
+    std::string needle = "\r\n" + name + ":";
+    size_t pos = lowered.find(needle);
+    if (pos == std::string::npos) {
+        return "";
+    }
+
+    size_t start = pos + needle.size();
+    size_t end = request.find("\r\n", start);
+    if (end == std::string::npos) {
+        end = request.size();
+    }
+
+    std::string value = request.substr(start, end - start);
+    size_t first = value.find_first_not_of(" \t");
+    size_t last = value.find_last_not_of(" \t");
+    return first == std::string::npos ? "" : value.substr(first, last - first + 1);
+}
+
+std::string WebSocket::accept_key(const std::string& client_key) {
+    return base64_encode(sha1(client_key + WEBSOCKET_GUID));
+}
+
+std::string WebSocket::sha1(const std::string& data) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string message = data;
+    uint64_t bit_length = static_cast<uint64_t>(data.size()) * 8;
+    message += static_cast<char>(0x80);
+    while (message.size() % 64 != 56) {
+        message += static_cast<char>(0x00);
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        message += static_cast<char>((bit_length >> shift) & 0xFF);
+    }
+
+    auto rotl = [](uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); };
+
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto* p = reinterpret_cast<const unsigned char*>(message.data() + chunk + i * 4);
+            w[i] = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                   (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::string digest;
+    for (uint32_t word : h) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            digest += static_cast<char>((word >> shift) & 0xFF);
+        }
+    }
+    return digest;
+}
+
+std::string WebSocket::base64_encode(const std::string& data) {
+    static const char* const alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string encoded;
+    size_t i = 0;
+    while (i + 2 < data.size()) {
+        uint32_t triple = (static_cast<uint8_t>(data[i]) << 16) |
+                          (static_cast<uint8_t>(data[i + 1]) << 8) |
+                          static_cast<uint8_t>(data[i + 2]);
+        encoded += alphabet[(triple >> 18) & 0x3F];
+        encoded += alphabet[(triple >> 12) & 0x3F];
+        encoded += alphabet[(triple >> 6) & 0x3F];
+        encoded += alphabet[triple & 0x3F];
+        i += 3;
+    }
+
+    size_t remaining = data.size() - i;
+    if (remaining == 1) {
+        uint32_t triple = static_cast<uint8_t>(data[i]) << 16;
+        encoded += alphabet[(triple >> 18) & 0x3F];
+        encoded += alphabet[(triple >> 12) & 0x3F];
+        encoded += "==";
+    } else if (remaining == 2) {
+        uint32_t triple = (static_cast<uint8_t>(data[i]) << 16) |
+                          (static_cast<uint8_t>(data[i + 1]) << 8);
+        encoded += alphabet[(triple >> 18) & 0x3F];
+        encoded += alphabet[(triple >> 12) & 0x3F];
+        encoded += alphabet[(triple >> 6) & 0x3F];
+        encoded += '=';
+    }
+    return encoded;
+}
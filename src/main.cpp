@@ -1,239 +1,158 @@
-#include "Generator.h"
+#include "GeneratorServer.h"
 #include <iostream>
-#include <thread>
-#include <chrono>
-#include <string>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
 #include <cstring>
+#include <string>
 #ifdef _WIN32
     #include <winsock2.h>
-    #include <ws2tcpip.h>
-    #pragma comment(lib, "ws2_32.lib")
-    #define close closesocket
-#else
-    #include <sys/socket.h>
-    #include <netinet/in.h>
-    #include <arpa/inet.h>
-    #include <unistd.h>
 #endif
 
-class GeneratorServer {
-private:
-    Generator generator_;
-    int server_socket_;
-    int client_socket_;
-    bool running_;
-    std::thread simulation_thread_;
-    
-    static constexpr int PORT = 8081;
-    static constexpr int BUFFER_SIZE = 1024;
-    static constexpr double UPDATE_RATE = 200.0; // 200ms update rate
-
-public:
-    GeneratorServer() : server_socket_(-1), client_socket_(-1), running_(false) {}
-    
-    ~GeneratorServer() {
-        stop();
-    }
-    
-    bool initialize() {
-        // Create socket
-        server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_socket_ < 0) {
-            std::cerr << "Failed to create socket" << std::endl;
-            return false;
-        }
-        
-        // Set socket options
-        int opt = 1;
-#ifdef _WIN32
-        if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt)) < 0) {
-#else
-        if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-#endif
-            std::cerr << "Failed to set socket options" << std::endl;
-            return false;
-        }
-        
-        // Bind socket
-        struct sockaddr_in server_addr;
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_addr.s_addr = INADDR_ANY;
-        server_addr.sin_port = htons(PORT);
-        
-        if (bind(server_socket_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-            std::cerr << "Failed to bind socket" << std::endl;
-            return false;
-        }
-        
-        // Listen for connections
-        if (listen(server_socket_, 1) < 0) {
-            std::cerr << "Failed to listen on socket" << std::endl;
-            return false;
-        }
-        
-        std::cout << "Generator server listening on port " << PORT << std::endl;
-        return true;
+// The whole text as a finite number; inf, nan and trailing text fail
+static bool parse_number(const std::string& text, double& value) {
+    size_t used = 0;
+    try {
+        value = std::stod(text, &used);
+    } catch (const std::exception& e) {
+        return false;
     }
+    return used == text.size() && std::isfinite(value);
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "Marine Generator Simulator - C++ Engine" << std::endl;
+    std::cout << "======================================" << std::endl;
     
-    void run() {
-        running_ = true;
-        
-        // Start simulation thread
-        simulation_thread_ = std::thread([this]() {
-            simulation_loop();
-        });
-        
-        // Accept client connections
-        while (running_) {
-            std::cout << "Waiting for client connection..." << std::endl;
-            
-            struct sockaddr_in client_addr;
-#ifdef _WIN32
-            int client_len = sizeof(client_addr);
-#else
-            socklen_t client_len = sizeof(client_addr);
-#endif
-            client_socket_ = accept(server_socket_, (struct sockaddr*)&client_addr, &client_len);
-            
-            if (client_socket_ < 0) {
-                std::cerr << "Failed to accept connection" << std::endl;
-                continue;
+    // Command line options
+    int server_threads = 1;
+    int modbus_port = 0;
+    NmeaOutput::Config nmea;
+    RateLimits limits;
+    std::string hot_restart_path;
+    int bus_units = 0;
+    EngineType engine = EngineType::DIESEL;
+    std::string spec_path;
+    std::string profile_paths[PROFILE_TARGET_COUNT];
+    std::string bus_disturbance;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            try {
+                server_threads = std::stoi(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                return 1;
             }
-            
-#ifdef _WIN32
-            char client_ip[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-            std::cout << "Client connected from " << client_ip << std::endl;
-#else
-            std::cout << "Client connected from " << inet_ntoa(client_addr.sin_addr) << std::endl;
-#endif
-            handle_client();
-            
-            // Client socket is closed in handle_client when it returns
-            client_socket_ = -1;
-        }
-    }
-    
-    void stop() {
-        running_ = false;
-        
-        if (simulation_thread_.joinable()) {
-            simulation_thread_.join();
-        }
-        
-        if (client_socket_ >= 0) {
-            close(client_socket_);
-            client_socket_ = -1;
-        }
-        
-        if (server_socket_ >= 0) {
-            close(server_socket_);
-            server_socket_ = -1;
-        }
-    }
-
-private:
-    void simulation_loop() {
-        auto last_update = std::chrono::high_resolution_clock::now();
-        
-        while (running_) {
-            auto now = std::chrono::high_resolution_clock::now();
-            auto delta_time = std::chrono::duration<double>(now - last_update).count();
-            
-            if (delta_time >= 1.0 / UPDATE_RATE) {
-                generator_.update(delta_time);
-                last_update = now;
+        } else if (std::strcmp(argv[i], "--modbus-port") == 0 && i + 1 < argc) {
+            try {
+                modbus_port = std::stoi(argv[++i]);
+            } catch (const std::exception& e) {
+                modbus_port = -1;
             }
-            
-            std::this_thread::sleep_for(std::chrono::milliseconds(5)); // 5ms sleep
-        }
-    }
-    
-    void handle_client() {
-        char buffer[BUFFER_SIZE];
-        int bytes_received;
-        
-        std::cout << "Client connected, waiting for commands..." << std::endl;
-        
-        while (running_) {
-            bytes_received = recv(client_socket_, buffer, BUFFER_SIZE - 1, 0);
-            
-            if (bytes_received <= 0) {
-                if (bytes_received == 0) {
-                    std::cout << "Client disconnected" << std::endl;
-                } else {
-                    std::cout << "Error receiving data" << std::endl;
-                }
-                break;
+            if (modbus_port < 1 || modbus_port > 65535) {
+                std::cerr << "Invalid Modbus port: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--nmea-tcp") == 0 && i + 1 < argc) {
+            nmea.tcp_port = std::atoi(argv[++i]);
+            if (nmea.tcp_port < 1 || nmea.tcp_port > 65535) {
+                std::cerr << "Invalid NMEA TCP port: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--nmea-udp") == 0 && i + 1 < argc) {
+            // <host>:<port>
+            std::string destination = argv[++i];
+            size_t colon = destination.rfind(':');
+            nmea.udp_port = colon == std::string::npos ? 0 : std::atoi(destination.c_str() + colon + 1);
+            if (colon == 0 || nmea.udp_port < 1 || nmea.udp_port > 65535) {
+                std::cerr << "Invalid NMEA UDP destination: " << destination << std::endl;
+                return 1;
+            }
+            nmea.udp_host = destination.substr(0, colon);
+        } else if (std::strcmp(argv[i], "--nmea-pty") == 0) {
+            nmea.pty = true;
+        } else if (std::strcmp(argv[i], "--nmea-rate") == 0 && i + 1 < argc) {
+            // <sentence>=<hz>
+            std::string setting = argv[++i];
+            size_t equals = setting.find('=');
+            NmeaOutput::Sentence sentence;
+            double rate = 0.0;
+            if (equals == std::string::npos || !NmeaOutput::parse_sentence(setting.substr(0, equals), sentence) ||
+                !parse_number(setting.substr(equals + 1), rate) || rate < 0.0 || rate > NmeaOutput::MAX_RATE) {
+                std::cerr << "Invalid NMEA rate: " << setting << std::endl;
+                return 1;
+            }
+            nmea.rates[static_cast<size_t>(sentence)] = rate;
+        } else if (std::strcmp(argv[i], "--max-connections") == 0 && i + 1 < argc) {
+            limits.max_connections = std::atoi(argv[++i]);
+            if (limits.max_connections < 0) {
+                std::cerr << "Invalid connection limit: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--rate-limit") == 0 && i + 1 < argc) {
+            // <class>=<rate>[/<burst>]
+            std::string setting = argv[++i];
+            size_t equals = setting.find('=');
+            size_t slash = setting.find('/', equals);
+            RateLimits::Class command_class;
+            if (equals == std::string::npos || !RateLimits::parse_class(setting.substr(0, equals), command_class)) {
+                std::cerr << "Invalid rate limit: " << setting << std::endl;
+                return 1;
+            }
+            double& rate = limits.rate[static_cast<size_t>(command_class)];
+            double& burst = limits.burst[static_cast<size_t>(command_class)];
+            bool valid = slash == std::string::npos
+                             ? parse_number(setting.substr(equals + 1), rate)
+                             : parse_number(setting.substr(equals + 1, slash - equals - 1), rate) &&
+                                   parse_number(setting.substr(slash + 1), burst);
+            if (valid && slash == std::string::npos) {
+                burst = 2.0 * rate;
+            }
+            if (!valid || rate < 0.0 || burst < 0.0) {
+                std::cerr << "Invalid rate limit: " << setting << std::endl;
+                return 1;
             }
-            
-            buffer[bytes_received] = '\0';
-            std::cout << "Received: " << buffer << std::endl;
-            
-            // Simple command processing for now
-            std::string command(buffer);
-            std::string response;
-            
-            if (command.find("start") != std::string::npos) {
-                generator_.start();
-                response = "{\"status\":\"success\",\"message\":\"Generator started\"}";
-            } else if (command.find("stop") != std::string::npos) {
-                generator_.stop();
-                response = "{\"status\":\"success\",\"message\":\"Generator stopped\"}";
-            } else if (command.find("set_load") != std::string::npos) {
-                // Parse load value from command (e.g., "set_load 75")
-                size_t space_pos = command.find(' ');
-                if (space_pos != std::string::npos) {
-                    std::string load_str = command.substr(space_pos + 1);
-                    try {
-                        double load_value = std::stod(load_str);
-                        if (load_value >= 0.0 && load_value <= 100.0) {
-                            generator_.set_load(load_value);
-                            response = "{\"status\":\"success\",\"message\":\"Load set to " + std::to_string(static_cast<int>(load_value)) + "%\"}";
-                        } else {
-                            response = "{\"status\":\"error\",\"message\":\"Load must be between 0 and 100\"}";
-                        }
-                    } catch (const std::exception& e) {
-                        response = "{\"status\":\"error\",\"message\":\"Invalid load value\"}";
-                    }
-                } else {
-                    response = "{\"status\":\"error\",\"message\":\"Missing load value\"}";
-                }
-            } else if (command.find("status") != std::string::npos) {
-                auto status = generator_.get_status();
-                response = "{\"status\":\"success\",\"data\":{\"state\":" + 
-                          std::to_string(static_cast<int>(status.state)) + 
-                          ",\"rpm\":" + std::to_string(status.rpm) + 
-                          ",\"voltage\":" + std::to_string(status.voltage) + 
-                          ",\"frequency\":" + std::to_string(status.frequency) + 
-                          ",\"load\":" + std::to_string(status.load_percentage) + 
-                          ",\"fuel_level\":" + std::to_string(status.fuel_level) + 
-                          ",\"oil_pressure\":" + std::to_string(status.oil_pressure) + 
-                          ",\"cooling_temp\":" + std::to_string(status.cooling_temp) + 
-                          ",\"alarms\":[]}}";
-            } else {
-                response = "{\"status\":\"error\",\"message\":\"Unknown command\"}";
+        } else if (std::strcmp(argv[i], "--bus-units") == 0 && i + 1 < argc) {
+            bus_units = std::atoi(argv[++i]);
+            if (bus_units < 1 || bus_units > static_cast<int>(Switchboard::MAX_UNITS)) {
+                std::cerr << "Bus units must be between 1 and " << Switchboard::MAX_UNITS << std::endl;
+                return 1;
             }
-            
-            std::cout << "Sending response: " << response << std::endl;
-            
-            // Send response back to client
-            int bytes_sent = send(client_socket_, response.c_str(), response.length(), 0);
-            if (bytes_sent < 0) {
-                std::cout << "Error sending response" << std::endl;
-                break;
+        } else if (std::strcmp(argv[i], "--bus-disturbance") == 0 && i + 1 < argc) {
+            // <key>=<value>[,...], checked once the engine is known
+            bus_disturbance = argv[++i];
+        } else if (std::strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            if (!parse_engine_type(argv[++i], engine)) {
+                std::cerr << "Unknown engine type: " << argv[i] << std::endl;
+                return 1;
             }
+        } else if (std::strcmp(argv[i], "--spec") == 0 && i + 1 < argc) {
+            spec_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            // --profile <generator|bus>=<file>
+            std::string setting = argv[++i];
+            size_t equals = setting.find('=');
+            ProfileTarget target;
+            if (equals == std::string::npos || !parse_profile_target(setting.substr(0, equals), target)) {
+                std::cerr << "Invalid profile: " << setting << std::endl;
+                return 1;
+            }
+            profile_paths[static_cast<size_t>(target)] = setting.substr(equals + 1);
+        } else if (std::strcmp(argv[i], "--hot-restart") == 0 && i + 1 < argc) {
+            hot_restart_path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--threads <count>] [--modbus-port <port>]"
+                      << " [--nmea-tcp <port>] [--nmea-udp <host:port>] [--nmea-pty]"
+                      << " [--nmea-rate <rpm|electrical|engine|alarms>=<hz>]"
+                      << " [--max-connections <n>] [--rate-limit <query|control|config>=<rate>[/<burst>]]"
+                      << " [--hot-restart <socket path>] [--bus-units <count>]"
+                      << " [--bus-disturbance <key>=<value>[,...]]"
+                      << " [--engine <diesel|gas|dual-fuel>] [--spec <file>]"
+                      << " [--profile <generator|bus>=<file>]"
+                      << std::endl;
+            return 1;
         }
-        
-        // Close client socket when done
-        close(client_socket_);
-        std::cout << "Client connection closed" << std::endl;
     }
-};
-
-int main() {
-    std::cout << "Marine Generator Simulator - C++ Engine" << std::endl;
-    std::cout << "======================================" << std::endl;
     
 #ifdef _WIN32
     // Initialize Windows Sockets
@@ -246,9 +165,56 @@ int main() {
     std::cout << "Windows Sockets initialized" << std::endl;
 #endif
     
-    GeneratorServer server;
+    // The first unit of a spec file is the simulated generator, and its
+    // engine takes the place of --engine
+    GeneratorSpec spec = GeneratorSpec::defaults(engine);
+    std::vector<GeneratorSpec> specs;
+    if (!spec_path.empty()) {
+        std::string error;
+        if (!GeneratorSpec::load(spec_path, specs, error)) {
+            std::cerr << "Invalid spec file: " << error << std::endl;
+            return 1;
+        }
+        spec = specs.front();
+        std::cout << "Spec: " << spec.name << " from " << spec_path << std::endl;
+    }
+
+    std::cout << "Engine: " << engine_type_name(spec.engine) << std::endl;
+    GeneratorServer server(spec);
+    server.set_spec_path(spec_path);
+    server.set_limits(limits);
+    server.set_hot_restart_path(hot_restart_path);
+    server.set_bus_units(bus_units);
+    {
+        // Later units of the spec file rate the other gensets on the bus
+        std::string error;
+        if (!server.set_unit_specs(specs, error)) {
+            std::cerr << "Invalid spec file: " << spec_path << ": " << error << std::endl;
+            return 1;
+        }
+    }
+    if (!bus_disturbance.empty()) {
+        // Same keys and defaults as a unit's disturbance, in % of the demand
+        DisturbanceSpec disturbance = GeneratorSpec::defaults(spec.engine).disturbance;
+        std::string error;
+        if (!GeneratorSpec::parse_disturbance(bus_disturbance, disturbance, error)) {
+            std::cerr << "Invalid bus disturbance: " << error << std::endl;
+            return 1;
+        }
+        if (!server.set_bus_disturbance(disturbance)) {
+            std::cerr << "A bus disturbance needs --bus-units" << std::endl;
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < PROFILE_TARGET_COUNT; ++i) {
+        std::string error;
+        if (!profile_paths[i].empty() && !server.set_profile(static_cast<ProfileTarget>(i), profile_paths[i], error)) {
+            std::cerr << "Invalid profile: " << error << std::endl;
+            return 1;
+        }
+    }
     
-    if (!server.initialize()) {
+    if (!server.initialize(server_threads, modbus_port, nmea)) {
         std::cerr << "Failed to initialize server" << std::endl;
 #ifdef _WIN32
         WSACleanup();
@@ -261,6 +227,8 @@ int main() {
     // Windows doesn't have SIGINT, we'll handle Ctrl+C differently
     std::cout << "Press Ctrl+C to stop the server..." << std::endl;
 #else
+    // A client vanishing mid-write must not kill the server
+    signal(SIGPIPE, SIG_IGN);
     signal(SIGINT, [](int) {
         std::cout << "\nShutting down server..." << std::endl;
         exit(0);